@@ -14,9 +14,14 @@
 // Derived from http://cma.gforge.inria.fr/cmaes.m which follows
 // https://www.researchgate.net/publication/227050324_The_CMA_Evolution_Strategy_A_Comparing_Review
 
+// Memory: only the covariance matrix C, of which just the lower triangle is
+// maintained, and BD = B * diag(D) are stored, 2 * dim^2 doubles. The eigen
+// decomposition is computed in place in BD, B is derived from BD when needed.
+// All other buffers are O(dim * popsize), so the peak memory is about
+// 16 * dim^2 bytes, 1 GB for dim = 8000.
+
 // Requires Eigen version >= 3.4 because new slicing capabilities are used, see
 // https://eigen.tuxfamily.org/dox-devel/group__TutorialSlicingIndexing.html
-// requires https://github.com/bab2min/EigenRand for random number generation.
 
 #include <Eigen/Core>
 #include <Eigen/Eigenvalues>
@@ -25,8 +30,10 @@
 #include <float.h>
 #include <stdint.h>
 #include <ctime>
-#include <EigenRand/EigenRand>
 #include "evaluator.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "surrogate.h"
 
 using namespace std;
 
@@ -145,15 +152,13 @@ public:
         ps = zeros(dim);
         // norm of ps, stored for efficiency.
         normps = ps.norm();
-        // coordinate system.
-        B = Eigen::MatrixXd::Identity(dim, dim);
         // diagonal of sqrt(D), stored for efficiency.
         diagD = inputSigma / sigma;
         diagC = diagD.cwiseProduct(diagD);
-        // B*D, stored for efficiency.
-        BD = B.cwiseProduct(diagD.transpose().replicate(dim, 1));
-        // covariance matrix.
-        C = B * (Eigen::MatrixXd::Identity(dim, dim) * B.transpose());
+        // B*D, the coordinate system B is the identity.
+        BD = diagD.asDiagonal();
+        // covariance matrix, only the lower triangle is used.
+        C = Eigen::MatrixXd::Identity(dim, dim);
         // number of iterations.
         iterations = 1;
         // size of history queue of best values.
@@ -167,11 +172,7 @@ public:
         // history queue of best values.
         fitnessHistory = vec::Constant(historySize, DBL_MAX);
         fitnessHistory(0) = bestValue;
-        rs = new Eigen::Rand::P8_mt19937_64(seed);
-    }
-
-    ~AcmaesOptimizer() {
-        delete rs;
+        rs = philox(seed);
     }
 
     // param zmean weighted row matrix of the gaussian random numbers generating the current offspring
@@ -179,7 +180,9 @@ public:
     // return hsig flag indicating a small correction
 
     bool updateEvolutionPaths(const vec &zmean, const vec &xold) {
-        ps = ps * (1. - cs) + ((B * zmean) * sqrt(cs * (2. - cs) * mueff));
+        // B * zmean = BD * D^-1 * zmean
+        ps = ps * (1. - cs)
+                + ((BD * zmean.cwiseQuotient(diagD)) * sqrt(cs * (2. - cs) * mueff));
         normps = ps.norm();
         bool hsig = normps / sqrt(1. - pow(1. - cs, 2. * iterations)) / chiN
                 < 1.4 + 2. / (dim + 1.);
@@ -200,7 +203,6 @@ public:
         double negccov = 0;
         if (ccov1 + ccovmu > 0) {
             mat arpos = (bestArx - xold.replicate(1, mu)) * (1. / sigma); // mu difference vectors
-            mat roneu = pc * pc.transpose() * ccov1;
             // minor correction if hsig==false
             double oldFac = hsig ? 0 : ccov1 * cc * (2. - cc);
             oldFac += 1. - ccov1 - ccovmu;
@@ -228,17 +230,23 @@ public:
             arzneg = arzneg.cwiseProduct(
                     arnormsInv.transpose().replicate(dim, 1));
             mat artmp = BD * arzneg;
-            mat Cneg = artmp * weights.asDiagonal() * artmp.transpose();
             oldFac += negalphaold * negccov;
-            C = (C * oldFac) + roneu
-                    + (arpos * (ccovmu + (1. - negalphaold) * negccov)
-                            * weights.replicate(1, dim).cwiseProduct(
-                                    arpos.transpose())) - (Cneg * negccov);
+            // C = C * oldFac + pc * pc^T * ccov1 + arpos * W * arpos^T * cpos
+            //     - artmp * W * artmp^T * negccov, W = diag(weights)
+            double cpos = ccovmu + (1. - negalphaold) * negccov;
+            mat vecs(dim, 1 + 2 * mu);
+            vecs << pc, arpos, artmp;
+            vec facs(1 + 2 * mu);
+            facs << ccov1, weights * cpos, weights * -negccov;
+            kernels::rankUpdate(dim, 1 + 2 * mu, C.data(), oldFac, vecs.data(),
+                    facs.data());
         }
         return negccov;
     }
 
-    // Update B and diagD from C
+    // Update BD and diagD from the lower triangle of C. The eigen decomposition
+    // is computed in place in BD, as SelfAdjointEigenSolver::compute does it
+    // in a matrix of its own.
     // param negccov Negative covariance factor.
 
     void updateBD(double negccov) {
@@ -246,46 +254,76 @@ public:
         if (ccov1 + ccovmu + negccov > 0
                 && (std::fmod(iterations,
                         1. / (ccov1 + ccovmu + negccov) / dim / 10.)) < 1.) {
-            // to achieve O(N^2) enforce symmetry to prevent complex numbers
-            mat triC = C.triangularView<Eigen::Upper>();
-            mat triC1 = C.triangularView<Eigen::StrictlyUpper>();
-            C = triC + triC1.transpose();
-            Eigen::SelfAdjointEigenSolver<mat> sades;
-            sades.compute(C);
-            // diagD defines the scaling
-            diagD = sades.eigenvalues();
-            B = sades.eigenvectors();
+            // map the coefficients to [-1:1] to avoid over- and underflow.
+            double scale = 0;
+            for (int j = 0; j < dim; j++) {
+                BD.col(j).tail(dim - j) = C.col(j).tail(dim - j);
+                scale = max(scale, BD.col(j).tail(dim - j).cwiseAbs().maxCoeff());
+            }
+            if (scale == 0)
+                scale = 1;
+            for (int j = 0; j < dim; j++)
+                BD.col(j).tail(dim - j) /= scale;
+            vec eigenvalues(dim), subdiag(dim - 1), hcoeffs(dim - 1);
+            Eigen::internal::tridiagonalization_inplace(BD, eigenvalues, subdiag,
+                    hcoeffs, true);
+            Eigen::internal::computeFromTridiagonal_impl(eigenvalues, subdiag,
+                    Eigen::SelfAdjointEigenSolver<mat>::m_maxIterations, true, BD);
+            // diagD defines the scaling, BD holds B now
+            diagD = eigenvalues * scale;
             if (diagD.minCoeff() <= 0) {
                 for (int i = 0; i < dim; i++)
                     if (diagD(i, 0) < 0)
                         diagD(i, 0) = 0.;
                 double tfac = diagD.maxCoeff() / 1e14;
-                C += Eigen::MatrixXd::Identity(dim, dim) * tfac;
+                C.diagonal().array() += tfac;
                 diagD += vec::Constant(dim, 1.0) * tfac;
             }
             if (diagD.maxCoeff() > 1e14 * diagD.minCoeff()) {
                 double tfac = diagD.maxCoeff() / 1e14 - diagD.minCoeff();
-                C += Eigen::MatrixXd::Identity(dim, dim) * tfac;
+                C.diagonal().array() += tfac;
                 diagD += vec::Constant(dim, 1.0) * tfac;
             }
             diagC = C.diagonal();
             diagD = diagD.cwiseSqrt(); // D contains standard deviations now
-            BD = B.cwiseProduct(diagD.transpose().replicate(dim, 1));
+            for (int j = 0; j < dim; j++)
+                BD.col(j) *= diagD(j);
         }
     }
 
     mat ask_all() { // undecoded
-        // generate popsize offspring.
-        mat xz = normal(dim, popsize, *rs);
-        mat xs(dim, popsize);
-        for (int k = 0; k < popsize; k++) {
-            vec delta = (BD * xz.col(k)) * sigma;
-            xs.col(k) = fitfun->getClosestFeasibleNormed(xmean + delta);
+        // generate popsize offspring, screenFactor * popsize if pre-screened.
+        int n = popsize;
+        if (screen) {
+            screen->setCoordinates(xmean, sigma * diagC.cwiseSqrt());
+            if (screen->ready())
+                n *= screenFactor;
         }
-        return xs;
+        mat xz = normal(dim, n, rs);
+        mat xs(dim, n);
+        kernels::affineSample(dim, n, BD.data(), xz.data(), sigma,
+                xmean.data(), xs.data());
+        for (int k = 0; k < n; k++)
+            xs.col(k) = fitfun->getClosestFeasibleNormed(xs.col(k));
+        if (n == popsize)
+            return xs;
+        std::vector<int> sel = screen->select(xs, popsize);
+        mat best(dim, popsize);
+        for (int k = 0; k < popsize; k++)
+            best.col(k) = xs.col(sel[k]);
+        return best;
     }
 
-    int tell_all(mat ys, mat xs) {
+    // pre-screen factor * popsize samples by a quadratic surrogate model of
+    // the told function values, see surrogate.h.
+    void enableScreening(int factor, double forgetting) {
+        screenFactor = std::max(1, factor);
+        screen.reset(
+                screenFactor > 1 ?
+                        new surrogate(dim, 1, 0, forgetting) : nullptr);
+    }
+
+    int tell_all(const Eigen::Ref<const vec> &ys, const mat &xs) {
        told = 0;
        for (int p = 0; p < popsize; p++)
            tell(ys(p), xs.col(p));
@@ -301,7 +339,7 @@ public:
 
     vec ask() {
         // ask for one new argument vector.
-        vec arz1 = normalVec(dim, *rs);
+        vec arz1 = normalVec(dim, rs);
         vec delta = (BD * arz1) * sigma;
         vec arx1 = fitfun->getClosestFeasibleNormed(xmean + delta);
         return arx1;
@@ -316,15 +354,19 @@ public:
         }
         fitness[told] = isfinite(y) ? y : DBL_MAX;
         arx.col(told) = x;
+        if (screen)
+            screen->update(x, vec::Constant(1, y));
         told++;
 
         if (told >= popsize) {
             xmean = fitfun->getClosestFeasibleNormed(xmean);
             try {
-                arz = (BD.inverse()
-                        * ((arx - xmean.replicate(1, popsize)) / sigma));
+                // BD^-1 = D^-1 * B^T = D^-2 * BD^T
+                arz.noalias() = BD.transpose()
+                        * ((arx - xmean.replicate(1, popsize)) / sigma);
+                arz = diagD.cwiseProduct(diagD).cwiseInverse().asDiagonal() * arz;
             } catch (std::exception &e) {
-                arz = normal(dim, popsize, *rs);
+                arz = normal(dim, popsize, rs);
             }
             updateCMA();
             told = 0;
@@ -490,6 +532,8 @@ public:
     }
 
     mat popX;
+    // population buffer shared with the caller, see pop_buffer
+    pop_buffer buffer;
 
 private:
     long runid;
@@ -522,7 +566,6 @@ private:
     vec pc;
     vec ps;
     double normps;
-    mat B;
     mat BD;
     mat diagD;
     mat C;
@@ -538,7 +581,9 @@ private:
     vec bestX;
     int stop;
     int told = 0;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox rs;
+    std::unique_ptr<surrogate> screen;
+    int screenFactor = 1;
 };
 }
 
@@ -566,6 +611,7 @@ void optimizeACMA_C(long runid, callback_type func, callback_parallel func_par,
         normalize = false;
     }
     Fitness fitfun(func, func_par, n, 1, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     fitfun.setNormalize(normalize);
 
     AcmaesOptimizer opt(runid, &fitfun, popsize, mu, guess, inputSigma,
@@ -630,23 +676,80 @@ void askACMA_C(uintptr_t ptr, double* xs) {
     int popsize = opt->getPopsize();
     opt->popX = opt->ask_all();
     Fitness* fitfun = opt->getFitfun();
-    for (int p = 0; p < popsize; p++) {
-        vec x = fitfun->decode(opt->popX.col(p));
-        for (int i = 0; i < n; i++)
-            xs[p * n + i] = x[i];
-    }
+    Eigen::Map<mat> X(xs, n, popsize);
+    for (int p = 0; p < popsize; p++)
+        X.col(p) = fitfun->decode(opt->popX.col(p));
+}
+
+// activates surrogate pre-screening for ask/tell: askACMA_C samples
+// factor * popsize candidates and returns the popsize with the best
+// predicted values. Useful for expensive objectives, factor <= 1 disables it.
+// forgetting in (0, 1] down weights older evaluations.
+void enableScreeningACMA_C(uintptr_t ptr, int factor, double forgetting) {
+    AcmaesOptimizer *opt = (AcmaesOptimizer*) ptr;
+    opt->enableScreening(factor, forgetting);
 }
 
 int tellACMA_C(uintptr_t ptr, double* ys) {
     AcmaesOptimizer *opt = (AcmaesOptimizer*) ptr;
     int popsize = opt->getPopsize();
-    vec vals(popsize);
-    for (int i = 0; i < popsize; i++)
-        vals[i] = ys[i];
-    opt->tell_all(vals, opt->popX);
+    opt->tell_all(Eigen::Map<const vec>(ys, popsize), opt->popX);
     return opt->getStop();
 }
 
+// maps the population buffer of the optimizer, see pop_buffer. askBufferACMA_C
+// writes the next population to xs, tellBufferACMA_C reads the function
+// values from ys, so the caller maps the buffer once and passes no data.
+void bufferACMA_C(uintptr_t ptr, double** xs, double** ys) {
+    AcmaesOptimizer *opt = (AcmaesOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    *xs = opt->buffer.xs();
+    *ys = opt->buffer.ys();
+}
+
+void askBufferACMA_C(uintptr_t ptr) {
+    AcmaesOptimizer *opt = (AcmaesOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    askACMA_C(ptr, opt->buffer.xs());
+}
+
+int tellBufferACMA_C(uintptr_t ptr) {
+    AcmaesOptimizer *opt = (AcmaesOptimizer*) ptr;
+    return tellACMA_C(ptr, opt->buffer.ys());
+}
+
+// Batched ask for n optimizers, saves the per instance call overhead if many
+// instances are driven from Python. Instance i writes its popsize x dim
+// population to xs behind the populations of the instances before it. The
+// instances are processed in parallel using at most workers threads,
+// workers <= 0 means all cores.
+void askManyACMA_C(uintptr_t* ptrs, int n, double* xs, int workers) {
+    vector<long> offsets(n);
+    long offset = 0;
+    for (int i = 0; i < n; i++) {
+        AcmaesOptimizer *opt = (AcmaesOptimizer*) ptrs[i];
+        offsets[i] = offset;
+        offset += (long) opt->getPopsize() * opt->getDim();
+    }
+    thread_pool::instance().parallel_for(n, workers, [&](int i) {
+        askACMA_C(ptrs[i], xs + offsets[i]);
+    });
+}
+
+// Batched tell, ys holds popsize values per instance in the order of the
+// instances, the stop criteria of instance i is written to stops[i].
+void tellManyACMA_C(uintptr_t* ptrs, int n, double* ys, int* stops, int workers) {
+    vector<long> offsets(n);
+    long offset = 0;
+    for (int i = 0; i < n; i++) {
+        offsets[i] = offset;
+        offset += ((AcmaesOptimizer*) ptrs[i])->getPopsize();
+    }
+    thread_pool::instance().parallel_for(n, workers, [&](int i) {
+        stops[i] = tellACMA_C(ptrs[i], ys + offsets[i]);
+    });
+}
+
 int tellXACMA_C(uintptr_t ptr, double* ys, double* xs) {
     AcmaesOptimizer *opt = (AcmaesOptimizer*) ptr;
     int popsize = opt->getPopsize();
@@ -0,0 +1,92 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// C interface of the concurrent advanced retry store, see advstore.h and
+// fcmaes/advretry.py. A store is created with createAdvStore_C, worker
+// processes inherit the returned pointer if forked, spawned workers map the
+// store by name via attachAdvStore_C.
+
+#include "advstore.h"
+
+extern "C" {
+
+uintptr_t createAdvStore_C(const char *name, int dim, int capacity, int slots,
+        double *lower, double *upper, long seed) {
+    return (uintptr_t) adv_store::create(name, dim, capacity, slots, lower,
+            upper, seed);
+}
+
+uintptr_t attachAdvStore_C(const char *name) {
+    return (uintptr_t) adv_store::attach(name);
+}
+
+void closeAdvStore_C(uintptr_t ptr, bool unlink) {
+    adv_store *store = (adv_store*) ptr;
+    store->unmap(unlink);
+    delete store;
+}
+
+// insertion buffer of the calling process.
+int slotAdvStore_C(uintptr_t ptr) {
+    return ((adv_store*) ptr)->claimSlot();
+}
+
+// returns 1 if y is the new best value.
+int addAdvStore_C(uintptr_t ptr, int slot, double y, double *x, long evals,
+        double limit) {
+    return ((adv_store*) ptr)->add(slot, y, x, evals, limit) ? 1 : 0;
+}
+
+// merges the buffered results, returns the number of sorted entries.
+int sortAdvStore_C(uintptr_t ptr) {
+    return ((adv_store*) ptr)->compact(true);
+}
+
+int nextRunAdvStore_C(uintptr_t ptr, int limit, int checkInterval,
+        double maxFac, double facIncr) {
+    return ((adv_store*) ptr)->nextRun(limit, checkInterval, maxFac, facIncr) ?
+            1 : 0;
+}
+
+double evalFacAdvStore_C(uintptr_t ptr) {
+    return ((adv_store*) ptr)->evalFac();
+}
+
+long evalsAdvStore_C(uintptr_t ptr) {
+    return ((adv_store*) ptr)->evals();
+}
+
+int runsAdvStore_C(uintptr_t ptr) {
+    return ((adv_store*) ptr)->runs();
+}
+
+// best value, its argument is written to x.
+double bestAdvStore_C(uintptr_t ptr, double *x) {
+    return ((adv_store*) ptr)->bestY(x);
+}
+
+// copies the sorted entries, xs needs room for capacity * dim values.
+int dataAdvStore_C(uintptr_t ptr, double *xs, double *ys) {
+    return ((adv_store*) ptr)->data(ys, xs);
+}
+
+void setDataAdvStore_C(uintptr_t ptr, int n, double *xs, double *ys,
+        double *bestX, double bestY) {
+    ((adv_store*) ptr)->setData(n, ys, xs, bestX, bestY);
+}
+
+// indices of two sorted entries for crossover, returns 0 if there are too few.
+int crossoverAdvStore_C(uintptr_t ptr, int *ij) {
+    return ((adv_store*) ptr)->crossover(ij[0], ij[1]) ? 1 : 0;
+}
+
+// crossover parent x1 and the boundaries and step sizes around the other
+// parent, returns its value or DBL_MAX if the store has too few entries.
+double limitsAdvStore_C(uintptr_t ptr, double *x1, double *lower,
+        double *upper, double *sdev) {
+    return ((adv_store*) ptr)->limits(x1, lower, upper, sdev);
+}
+
+}
@@ -0,0 +1,80 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// C interface of the native CVT MAP-Elites archive, see archive.h and
+// fcmaes/mapelites.py. Each process creates its own qd_archive from the
+// shared niche centers and binds the shared arrays mapped in this process.
+
+#include "archive.h"
+
+extern "C" {
+
+uintptr_t initArchive_C(int dim, int qdim, int capacity, double *centers,
+        double *lower, double *scale) {
+    return (uintptr_t) new qd_archive(dim, qdim, capacity, centers, lower,
+            scale);
+}
+
+void destroyArchive_C(uintptr_t ptr) {
+    delete (qd_archive*) ptr;
+}
+
+void bindArchive_C(uintptr_t ptr, double *xs, double *ds, double *ys,
+        long *counts, long *occupied, double *stats, int *locks) {
+    ((qd_archive*) ptr)->bind(xs, ds, ys, counts, occupied, stats, locks);
+}
+
+// niches of the n descriptors ds (n x qdim).
+void nichesArchive_C(uintptr_t ptr, int n, int qdim, double *ds,
+        int *niches) {
+    qd_archive *archive = (qd_archive*) ptr;
+    for (int i = 0; i < n; i++)
+        niches[i] = archive->niche(ds + (long) i * qdim);
+}
+
+// n SBX offspring of parents drawn from the bestN best niches, si holds the
+// niches sorted by value or is null. Offspring are written to xs (n x dim).
+void sbxArchive_C(uintptr_t ptr, int n, int bestN, int *si, double *lower,
+        double *upper, double disC, double disM, long seed, double *xs) {
+    philox rs(seed);
+    ((qd_archive*) ptr)->sbx(n, bestN, si, lower, upper, disC, disM, rs, xs);
+}
+
+// n Iso+LineDD offspring, parents drawn as for sbxArchive_C.
+void isoDDArchive_C(uintptr_t ptr, int n, int bestN, int *si, double *lower,
+        double *upper, double isoSigma, double lineSigma, long seed,
+        double *xs) {
+    philox rs(seed);
+    ((qd_archive*) ptr)->isoDD(n, bestN, si, lower, upper, isoSigma,
+            lineSigma, rs, xs);
+}
+
+// adds candidate x with value y and descriptor d to niche i if it improves
+// the niche.
+void setArchive_C(uintptr_t ptr, int i, double *x, double y, double *d) {
+    ((qd_archive*) ptr)->update(i, x, y, d);
+}
+
+// adds n candidates xs (n x dim) with values ys and descriptors ds
+// (n x qdim) to their niches. niches receives the niche of each candidate,
+// improvement the difference of its value to the previous value of the
+// niche, negative if it was stored. Returns the number of stored candidates.
+int updateArchive_C(uintptr_t ptr, int n, int dim, int qdim, double *xs,
+        double *ys, double *ds, int *niches, double *improvement) {
+    qd_archive *archive = (qd_archive*) ptr;
+    int stored = 0;
+    for (int i = 0; i < n; i++) {
+        const double *d = ds + (long) i * qdim;
+        int k = archive->niche(d);
+        double old = archive->update(k, xs + (long) i * dim, ys[i], d);
+        niches[i] = k;
+        improvement[i] = ys[i] - old;
+        if (ys[i] < old)
+            stored++;
+    }
+    return stored;
+}
+
+}
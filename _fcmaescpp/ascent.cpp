@@ -3,6 +3,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <array>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include "parallel.h"
+#include "dopri.h"
 #include "keplerian_toolbox/core_functions/propagate_lagrangian.hpp"
 #include "keplerian_toolbox/core_functions/propagate_taylor.hpp"
 #include "keplerian_toolbox/core_functions/propagate_taylor_J2.hpp"
@@ -16,12 +24,106 @@
 #include "keplerian_toolbox/lambert_problem.hpp"
 
 using namespace asc;
+using namespace ode;
+
+// fixed size states of the built in models
+typedef std::array<double, 2> state2_t;
+typedef std::array<double, 3> state3_t;
+typedef std::array<double, 6> state6_t;
+
+// classical Runge Kutta for fixed size states. All stage buffers live on the
+// stack and the loops over the state can be unrolled. Performs the same
+// arithmetic as asc::RK4, so results don't depend on the state type.
+template<size_t N>
+struct RK4N {
+
+    template<class System>
+    void operator()(System &sys, std::array<double, N> &x, double &t,
+            const double dt) {
+        std::array<double, N> xd;
+        step(sys, x, t, dt, xd);
+    }
+
+    // as above, xd receives the weighted sum k1 + 2 k2 + 2 k3 of the first
+    // three stage derivatives.
+    template<class System>
+    static void step(System &sys, std::array<double, N> &x, double &t,
+            const double dt, std::array<double, N> &xd) {
+        std::array<double, N> x0 = x, xdt;
+        const double t0 = t;
+        const double dt_2 = 0.5 * dt;
+        const double dt_6 = (1.0 / 6.0) * dt;
+        sys(x0, xd, t);
+        for (size_t i = 0; i < N; i++)
+            x[i] = x0[i] + dt_2 * xd[i];
+        t += dt_2;
+        sys(x, xdt, t);
+        for (size_t i = 0; i < N; i++) {
+            xd[i] += 2 * xdt[i];
+            x[i] = x0[i] + dt_2 * xdt[i];
+        }
+        sys(x, xdt, t);
+        for (size_t i = 0; i < N; i++) {
+            xd[i] += 2 * xdt[i];
+            x[i] = x0[i] + dt * xdt[i];
+        }
+        t = t0 + dt;
+        sys(x, xdt, t);
+        for (size_t i = 0; i < N; i++)
+            x[i] = x0[i] + dt_6 * (xd[i] + xdt[i]);
+    }
+};
+
+// 3rd order predictor corrector for fixed size states, performs the same
+// arithmetic as asc::PC233: the first step is a RK4N step, the following
+// steps evaluate at t + dt/3 and t + 2dt/3 extrapolating the derivative
+// of the previous step. Keeps this derivative, so use a new instance for
+// each independent integration.
+template<size_t N>
+struct PC233N {
+
+    PC233N() :
+            _initialized(false) {
+    }
+
+    template<class System>
+    void operator()(System &sys, std::array<double, N> &x, double &t,
+            const double dt) {
+        if (!_initialized) {
+            RK4N<N>::step(sys, x, t, dt, _xdPrev);
+            _initialized = true;
+            return;
+        }
+        std::array<double, N> x0 = x, xd0, xd1;
+        const double t0 = t;
+        const double dt_4 = 0.25 * dt;
+        const double dt_18 = (1.0 / 18.0) * dt;
+        const double dt_54 = (1.0 / 54.0) * dt;
+        sys(x0, xd0, t);
+        for (size_t i = 0; i < N; i++)
+            x[i] = x0[i] + dt_18 * (7 * xd0[i] - _xdPrev[i]);
+        t = t0 + (1.0 / 3.0) * dt;
+        sys(x, xd1, t);
+        for (size_t i = 0; i < N; i++)
+            x[i] = x0[i] + dt_54 * (39 * xd1[i] - 4 * xd0[i] + _xdPrev[i]);
+        t = t0 + (2.0 / 3.0) * dt;
+        sys(x, xd1, t);
+        for (size_t i = 0; i < N; i++)
+            x[i] = x0[i] + dt_4 * (xd0[i] + 3 * xd1[i]);
+        t = t0 + dt;
+        _xdPrev = xd0;
+    }
+
+    bool _initialized;
+    std::array<double, N> _xdPrev;
+};
 
 struct Damp {
 
     double alpha;
 
-    void operator()(const state_t &y, state_t &yDot, const double) {
+    template<class State>
+    void operator()(const State &y, State &yDot, const double) {
 
         double x1 = y[0];
         double x2 = y[1];
@@ -30,36 +132,100 @@ struct Damp {
     }
 };
 
-extern "C" {
-double* integrateDamp_C(double *yd, double alpha, double dt, double step) {
-
-    state_t y(2);
-    for (int i = 0; i < 2; i++)
-        y[i] = yd[i];
-
-//    RK4 integrator;
-//    DOPRI45 integrator;
-//    ABM4 integrator;
-    PC233 integrator;
-//    VABM integrator;
-    Damp damp;
-    damp.alpha = alpha;
+// integrates y from t to tN using a fixed step, the last step is shortened.
+// tN < t integrates backwards.
+template<class Integrator, class System, class State>
+static int integrateFixed(Integrator &integrator, System &sys, State &y,
+        double t, double tN, double step) {
     int steps = 0;
-    double t = 0.0;
-    while (t < dt) {
+    double dir = tN >= t ? 1 : -1;
+    step = dir * fabs(step);
+    while (dir * (tN - t) > 0) {
         steps++;
-        if (t + step >= dt) {
-            integrator(damp, y, t, dt - t);
+        if (dir * (t + step - tN) >= 0) {
+            integrator(sys, y, t, tN - t);
             break;
         } else
-            integrator(damp, y, t, step);
+            integrator(sys, y, t, step);
+    }
+    return steps;
+}
+
+// integrates y from 0 to dt using a fixed step, the last step is shortened.
+template<class Integrator, class System, class State>
+static int integrateFixed(Integrator &integrator, System &sys, State &y,
+        double dt, double step) {
+    return integrateFixed(integrator, sys, y, 0.0, dt, step);
+}
+
+// number of small ODE problems integrated by a batch job.
+static const int ODE_CHUNK = 16;
+
+// integrates y from t to tN using step size control, stats receives the
+// number of accepted steps, rejected steps and right hand side evaluations.
+// Returns the number of accepted steps or -1 if the step size fell below hmin.
+template<class System, class State>
+static int integrateAdaptive(System &sys, State &y, double t, double tN,
+        double atol, double rtol, double hmin, double hmax, int *stats) {
+    Dopri45<State> integrator(y.size(), atol, rtol, hmin, hmax, 0);
+    bool ok = integrator.integrate(sys, y, t, tN);
+    if (stats != NULL) {
+        stats[0] = integrator.steps();
+        stats[1] = integrator.rejected();
+        stats[2] = integrator.evaluations();
     }
+    return ok ? integrator.steps() : -1;
+}
+
+extern "C" {
+double* integrateDamp_C(double *yd, double alpha, double dt, double step) {
+
+    state2_t y = {{ yd[0], yd[1] }};
+//    RK4N<2> integrator;
+    PC233N<2> integrator;
+    Damp damp;
+    damp.alpha = alpha;
+    integrateFixed(integrator, damp, y, dt, step);
     double *res = new double[2];
     for (int i = 0; i < 2; i++)
         res[i] = y[i];
     return res;
 }
 ;
+
+// Integrates count independent (y, alpha, dt) tuples in parallel using at
+// most workers threads (<= 0: all cores). ys holds count initial states of
+// size 2, res (caller owned, may be ys) receives the final states.
+void integrateDampBatch_C(int count, double *ys, double *alphas, double *dts,
+        double step, int workers, double *res) {
+    int chunks = (count + ODE_CHUNK - 1) / ODE_CHUNK;
+    thread_pool::instance().parallel_for(chunks, workers, [&](int c) {
+        Damp damp;
+        state2_t y;
+        int end = std::min(count, (c + 1) * ODE_CHUNK);
+        for (int j = c * ODE_CHUNK; j < end; j++) {
+            PC233N<2> integrator;
+            for (int i = 0; i < 2; i++)
+                y[i] = ys[2 * j + i];
+            damp.alpha = alphas[j];
+            integrateFixed(integrator, damp, y, dts[j], step);
+            for (int i = 0; i < 2; i++)
+                res[2 * j + i] = y[i];
+        }
+    });
+}
+
+// adaptive step size version, yd is updated in place.
+int integrateDampAdaptive_C(double *yd, double alpha, double dt, double atol,
+        double rtol, double hmin, double hmax, int *stats) {
+    state2_t y = {{ yd[0], yd[1] }};
+    Damp damp;
+    damp.alpha = alpha;
+    int steps = integrateAdaptive(damp, y, 0, dt, atol, rtol, hmin, hmax, stats);
+    for (int i = 0; i < 2; i++)
+        yd[i] = y[i];
+    return steps;
+}
 }
 
 struct F8 {
@@ -69,7 +235,8 @@ struct F8 {
     static constexpr double ksi_3 = ksi * ksi_2;
     double w;
 
-    void operator()(const state_t &y, state_t &yDot, const double) {
+    template<class State>
+    void operator()(const State &y, State &yDot, const double) {
 
         double y0 = y[0];
         double y0_2 = y0 * y0;
@@ -98,33 +265,52 @@ struct F8 {
 extern "C" {
 double* integrateF8_C(double *yd, double w, double dt, double step) {
 
-    state_t y(3);
-    for (int i = 0; i < 3; i++)
-        y[i] = yd[i];
-
-//    RK4 integrator;
-//    DOPRI45 integrator;
-//    ABM4 integrator;
-    PC233 integrator;
-//    VABM integrator;
+    state3_t y = {{ yd[0], yd[1], yd[2] }};
+//    RK4N<3> integrator;
+    PC233N<3> integrator;
     F8 f8;
     f8.w = w;
-    int steps = 0;
-    double t = 0.0;
-    while (t < dt) {
-        steps++;
-        if (t + step >= dt) {
-            integrator(f8, y, t, dt - t);
-            break;
-        } else
-            integrator(f8, y, t, step);
-    }
+    integrateFixed(integrator, f8, y, dt, step);
     double *res = new double[3];
     for (int i = 0; i < 3; i++)
         res[i] = y[i];
     return res;
 }
 ;
+
+// Integrates count independent (y, w, dt) tuples in parallel using at
+// most workers threads (<= 0: all cores). ys holds count initial states of
+// size 3, res (caller owned, may be ys) receives the final states.
+void integrateF8Batch_C(int count, double *ys, double *ws, double *dts,
+        double step, int workers, double *res) {
+    int chunks = (count + ODE_CHUNK - 1) / ODE_CHUNK;
+    thread_pool::instance().parallel_for(chunks, workers, [&](int c) {
+        F8 f8;
+        state3_t y;
+        int end = std::min(count, (c + 1) * ODE_CHUNK);
+        for (int j = c * ODE_CHUNK; j < end; j++) {
+            PC233N<3> integrator;
+            for (int i = 0; i < 3; i++)
+                y[i] = ys[3 * j + i];
+            f8.w = ws[j];
+            integrateFixed(integrator, f8, y, dts[j], step);
+            for (int i = 0; i < 3; i++)
+                res[3 * j + i] = y[i];
+        }
+    });
+}
+
+// adaptive step size version, yd is updated in place.
+int integrateF8Adaptive_C(double *yd, double w, double dt, double atol,
+        double rtol, double hmin, double hmax, int *stats) {
+    state3_t y = {{ yd[0], yd[1], yd[2] }};
+    F8 f8;
+    f8.w = w;
+    int steps = integrateAdaptive(f8, y, 0, dt, atol, rtol, hmin, hmax, stats);
+    for (int i = 0; i < 3; i++)
+        yd[i] = y[i];
+    return steps;
+}
 }
 
 void wic2par(state_t rv, double* kep, double mu) {
@@ -137,6 +323,149 @@ void wic2par(state_t rv, double* kep, double mu) {
 	kep_toolbox::ic2par(rk, vk, mu, kep);
 }
 
+// number of states converted together by ic2parBatch
+static const int KEP_CHUNK = 64;
+
+// Cartesian state to keplerian elements (a, e, i, Omega, omega, eccentric
+// anomaly or gudermannian) as computed by kep_toolbox::ic2par, for n states.
+// Coordinate k of state j is read from rv[j * rs + k * cs], element k is
+// written to kep[j * ks + k * kcs]. States are gathered into chunks in
+// structure of arrays layout, the arithmetic is separated from the acos / atan
+// calls so it vectorizes. The true anomaly is derived from its cosine and the
+// sign of r.v, which saves the acos and tan calls of ic2par.
+static void ic2parBatch(int n, const double *rv, int rs, int cs, double mu,
+		double *kep, int ks, int kcs) {
+	double st[6][KEP_CHUNK]; // r, v
+	double el[6][KEP_CHUNK]; // elements
+	double ca[4][KEP_CHUNK]; // acos / atan arguments
+	bool flip[2][KEP_CHUNK];
+	for (int j0 = 0; j0 < n; j0 += KEP_CHUNK) {
+		int m = std::min(KEP_CHUNK, n - j0);
+		for (int k = 0; k < 6; k++)
+			for (int j = 0; j < m; j++)
+				st[k][j] = rv[(j0 + j) * rs + k * cs];
+		for (int j = 0; j < m; j++) {
+			double x = st[0][j], y = st[1][j], z = st[2][j];
+			double vx = st[3][j], vy = st[4][j], vz = st[5][j];
+			// orbital angular momentum
+			double hx = y * vz - z * vy;
+			double hy = z * vx - x * vz;
+			double hz = x * vy - y * vx;
+			double h2 = hx * hx + hy * hy + hz * hz;
+			double p = h2 / mu;
+			// node line k x h
+			double nx = -hy;
+			double ny = hx;
+			double nn = sqrt(nx * nx + ny * ny);
+			double R = sqrt(x * x + y * y + z * z);
+			// eccentricity vector
+			double ex = (vy * hz - vz * hy) / mu - x / R;
+			double ey = (vz * hx - vx * hz) / mu - y / R;
+			double ez = (vx * hy - vy * hx) / mu - z / R;
+			double e = sqrt(ex * ex + ey * ey + ez * ez);
+			el[0][j] = p / (1 - e * e);
+			el[1][j] = e;
+			ca[0][j] = hz / sqrt(h2);
+			ca[1][j] = nx / nn;
+			ca[2][j] = (nx * ex + ny * ey) / nn / e;
+			flip[0][j] = ny < 0;
+			flip[1][j] = ez < 0;
+			// true anomaly
+			double cosni = (ex * x + ey * y + ez * z) / e / R;
+			double sinni = sqrt(std::max(0.0, 1 - cosni * cosni));
+			if (x * vx + y * vy + z * vz < 0.0)
+				sinni = -sinni;
+			ca[3][j] = sqrt(fabs(1 - e) / (1 + e)) * sinni / (1 + cosni);
+		}
+		for (int j = 0; j < m; j++) {
+			el[2][j] = acos(ca[0][j]);
+			el[3][j] = acos(ca[1][j]);
+			el[4][j] = acos(ca[2][j]);
+			el[5][j] = 2.0 * atan(ca[3][j]);
+		}
+		for (int j = 0; j < m; j++) {
+			if (flip[0][j])
+				el[3][j] = 2 * M_PI - el[3][j];
+			if (flip[1][j])
+				el[4][j] = 2 * M_PI - el[4][j];
+		}
+		for (int k = 0; k < 6; k++)
+			for (int j = 0; j < m; j++)
+				kep[(j0 + j) * ks + k * kcs] = el[k][j];
+	}
+}
+
+// Piecewise Chebyshev approximation of the analytic sun and moon series used
+// by PVTwaste, disabled by default (see useEphemeris_C) since it slightly
+// changes the propagation results. Segments are aligned to a fixed time grid
+// so the shared cache can be extended without refitting existing segments.
+// Instances are immutable after construction, the shared cache is replaced
+// copy on write, so they can be read from many threads without locking.
+// The cache holds at most MAX_SEGMENTS segments, a request not fitting
+// together with the cached ones replaces them.
+
+class Ephemeris {
+
+public:
+
+	static constexpr double SEGMENT = 86400.0; // segment length in seconds
+	static const int NCOEFF = 13; // Chebyshev degree 12
+	static const long MAX_SEGMENTS = 8192; // about 22 years, 5 MB
+
+	// fits all segments covering [t0, t1], reuses the segments of old
+	// if the union of both spans has at most MAX_SEGMENTS segments.
+	Ephemeris(double t0, double t1, const Ephemeris *old);
+
+	bool covers(double t0, double t1) const {
+		return std::min(t0, t1) >= _i0 * SEGMENT
+				&& std::max(t0, t1) < _i1 * SEGMENT;
+	}
+
+	void sun(double t, double &x, double &y, double &z) const {
+		eval(t, 0, x, y, z);
+	}
+
+	void moon(double t, double &x, double &y, double &z) const {
+		eval(t, 3, x, y, z);
+	}
+
+	// maximal position deviation in km from the analytic series at samples
+	// equally spaced points in [t0, t1]: err[0] sun, err[1] moon.
+	void validate(double t0, double t1, int samples, double *err) const;
+
+	// shared cache covering [t0, t1], extended if necessary. Null if [t0, t1]
+	// spans more than MAX_SEGMENTS segments.
+	static std::shared_ptr<const Ephemeris> get(double t0, double t1);
+
+	static std::atomic<bool> enabled;
+
+private:
+
+	void eval(double t, int coord, double &x, double &y, double &z) const {
+		long i = std::max(_i0, std::min(_i1 - 1, (long) floor(t / SEGMENT)));
+		double u = 2.0 * (t / SEGMENT - i) - 1.0; // [-1, 1]
+		const double *c = &_coeffs[((i - _i0) * 6 + coord) * NCOEFF];
+		x = clenshaw(c, u);
+		y = clenshaw(c + NCOEFF, u);
+		z = clenshaw(c + 2 * NCOEFF, u);
+	}
+
+	static double clenshaw(const double *c, double u) {
+		double u2 = 2 * u;
+		double b1 = 0, b2 = 0;
+		for (int j = NCOEFF - 1; j > 0; j--) {
+			double b = u2 * b1 - b2 + c[j];
+			b2 = b1;
+			b1 = b;
+		}
+		return u * b1 - b2 + c[0];
+	}
+
+	long _i0;
+	long _i1;
+	std::vector<double> _coeffs; // per segment: sun x,y,z, moon x,y,z
+};
+
 struct PVTwaste {
 
 	static constexpr double muE = 3.986004407799724E5;
@@ -169,8 +498,29 @@ struct PVTwaste {
 	static constexpr double sinep = sin(ep);
 
     double _cram;
+    std::shared_ptr<const Ephemeris> _eph;
+
+    // use the shared Chebyshev cache for sun and moon in [t0, t1].
+    void ephemeris(double t0, double t1) {
+    	if (Ephemeris::enabled)
+    		_eph = Ephemeris::get(t0, t1);
+    }
+
+    void sun(double t, double& xsun, double& ysun, double& zsun) {
+    	if (_eph)
+    		_eph->sun(t, xsun, ysun, zsun);
+    	else
+    		sunr(t, xsun, ysun, zsun);
+    }
+
+    void moon(double t, double& xM, double& yM, double& zM) {
+    	if (_eph)
+    		_eph->moon(t, xM, yM, zM);
+    	else
+    		moonr(t, xM, yM, zM);
+    }
 
-    void sunr(double t, double& xsun, double& ysun, double& zsun) {
+    static void sunr(double t, double& xsun, double& ysun, double& zsun) {
 		double lsun = phiS + vS * t;
 		double rsun = 1E6 * (149.619 - 2.499*cos(lsun)
 								- 0.021*cos(2*lsun));
@@ -182,7 +532,7 @@ struct PVTwaste {
 		zsun = rsun * sin(lambdas) * sinep;
     }
 
-    void moonr(double t, double& xM, double& yM, double& zM) {
+    static void moonr(double t, double& xM, double& yM, double& zM) {
 		double phiM = vS * t;
 		double phiMa = vMa * t;
 		double phiMp = vMp * t;
@@ -226,7 +576,8 @@ struct PVTwaste {
 		zM = sinep * M2 + cosep * M3;
     }
 
-    void operator()(const state_t &pv, state_t &yDot, const double t) {
+    template<class State>
+    void operator()(const State &pv, State &yDot, const double t) {
 
 		// position
 		double x = pv[0];
@@ -260,7 +611,7 @@ struct PVTwaste {
 
 		// solar radiation pressure
 		double xsun, ysun, zsun;
-		sunr(t, xsun, ysun, zsun);
+		sun(t, xsun, ysun, zsun);
 
 		double rsun = sqrt(xsun * xsun + ysun * ysun + zsun * zsun);
 		double rsun3 = rsun*rsun*rsun;
@@ -315,7 +666,7 @@ struct PVTwaste {
 		// lunar gravity
 		// solar radiation pressure
 		double xmoo, ymoo, zmoo;
-		moonr(t, xmoo, ymoo, zmoo);
+		moon(t, xmoo, ymoo, zmoo);
 
 		double rmoo = sqrt(xmoo * xmoo + ymoo * ymoo + zmoo * zmoo);
 		double rmoo3 = rmoo*rmoo*rmoo;
@@ -336,74 +687,531 @@ struct PVTwaste {
 		yDot[4] = fkepY + fJ2Y + fSRPY + fc22Y + fs22Y + fsunY + fmooY;
 		yDot[5] = fkepZ + fJ2Z + fSRPZ + fc22Z + fs22Z + fsunZ + fmooZ;
     }
+
+    // right hand side for m states in structure of arrays layout: pv and yDot
+    // hold 6 rows of length m (x, y, z, vx, vy, vz). All states share time t,
+    // so sun, moon and earth rotation are computed once and the loop over the
+    // states vectorizes.
+    void operator()(int m, const double *__restrict pv, double *__restrict yDot,
+    		const double *__restrict cram, const double t) {
+
+		double xsun, ysun, zsun;
+		sun(t, xsun, ysun, zsun);
+		double rsun = sqrt(xsun * xsun + ysun * ysun + zsun * zsun);
+		double rsun3 = rsun*rsun*rsun;
+
+		double xmoo, ymoo, zmoo;
+		moon(t, xmoo, ymoo, zmoo);
+		double rmoo = sqrt(xmoo * xmoo + ymoo * ymoo + zmoo * zmoo);
+		double rmoo3 = rmoo*rmoo*rmoo;
+
+		double tGvEt = thetaG + vE * t;
+		double costGvEt = cos(tGvEt);
+		double sintGvEt = sin(tGvEt);
+
+		const double *px = pv, *py = pv + m, *pz = pv + 2*m;
+		for (int i = 0; i < 3*m; i++)
+			yDot[i] = pv[3*m + i];
+		double *ax = yDot + 3*m, *ay = yDot + 4*m, *az = yDot + 5*m;
+
+		for (int i = 0; i < m; i++) {
+			double x = px[i];
+			double y = py[i];
+			double z = pz[i];
+
+			double rq = x * x + y * y + z * z;
+			double r = sqrt(rq);
+			double rq2 = rq * rq;
+			double rq3 = rq2 * rq;
+			double rrr = r*r*r;
+
+			double z15 = 15.0*z*z / rq3;
+			double rq23 = 3.0 / rq2;
+			double muERe2V5C20q2r = muERe2V5C20 / (2*r);
+
+			double xsd = x - xsun;
+			double ysd = y - ysun;
+			double zsd = z - zsun;
+			double rsd = sqrt(xsd * xsd + ysd * ysd + zsd * zsd);
+			double rsd3 = rsd*rsd*rsd;
+			double srp = cram[i] * Psrpas2 / rsd3;
+
+			double xc = x * costGvEt + y * sintGvEt;
+			double yc = -x * sintGvEt + y * costGvEt;
+			double zc = z;
+
+			double xcq = xc*xc;
+			double ycq = yc*yc;
+			double zcq = zc*zc;
+
+			double rc = xcq + ycq + zcq;
+			double rc5 = rc*rc*rc*rc*rc;
+			double rc5s = sqrt(rc5);
+			double rc7s = sqrt(rc5*rc*rc);
+
+			double fc22x = 5*muERe2V15C22*xc*(ycq-xcq) / (2*rc7s) + muERe2V15C22*x / rc5s;
+			double fc22y = 5*muERe2V15C22*yc*(ycq-xcq) / (2*rc7s) + muERe2V15C22*y / rc5s;
+			double fc22Z = 5*muERe2V15C22*zc*(ycq-xcq) / (2*rc7s);
+			double fs22x = -5*muERe2V15S22*xcq*y / rc7s + muERe2V15S22*y / rc5s;
+			double fs22y = -5*muERe2V15S22*xc*ycq / rc7s + muERe2V15S22*x / rc5s;
+			double fs22Z = -5*muERe2V15S22*zc*(ycq-xcq) / rc7s;
+
+			double xmd = x - xmoo;
+			double ymd = y - ymoo;
+			double zmd = z - zmoo;
+			double rmd = sqrt(xmd * xmd + ymd * ymd + zmd * zmd);
+			double rmd3 = rmd*rmd*rmd;
+
+			ax[i] = -muE * x / rrr + muERe2V5C20q2r * x * (rq23 - z15)
+					+ srp * xsd
+					+ fc22x * costGvEt - fc22y * sintGvEt
+					+ fs22x * costGvEt - fs22y * sintGvEt
+					- muS * (xsd / rsd3 + xsun / rsun3)
+					- muM * (xmd / rmd3 + xmoo / rmoo3);
+			ay[i] = -muE * y / rrr + muERe2V5C20q2r * y * (rq23 - z15)
+					+ srp * ysd
+					+ fc22x * sintGvEt - fc22y * costGvEt
+					+ fs22x * sintGvEt - fs22y * costGvEt
+					- muS * (ysd / rsd3 + ysun / rsun3)
+					- muM * (ymd / rmd3 + ymoo / rmoo3);
+			az[i] = -muE * z / rrr + muERe2V5C20q2r * z * (3*rq23 - z15)
+					+ srp * zsd + fc22Z + fs22Z
+					- muS * (zsd / rsd3 + zsun / rsun3)
+					- muM * (zmd / rmd3 + zmoo / rmoo3);
+		}
+    }
 };
 
-using namespace std;
+std::atomic<bool> Ephemeris::enabled(false);
 
-extern "C" {
+Ephemeris::Ephemeris(double t0, double t1, const Ephemeris *old) {
+	_i0 = (long) floor(std::min(t0, t1) / SEGMENT);
+	_i1 = (long) floor(std::max(t0, t1) / SEGMENT) + 1;
+	if (old != NULL && std::max(_i1, old->_i1) - std::min(_i0, old->_i0)
+			<= MAX_SEGMENTS) {
+		_i0 = std::min(_i0, old->_i0);
+		_i1 = std::max(_i1, old->_i1);
+	}
+	int stride = 6 * NCOEFF;
+	_coeffs.resize((_i1 - _i0) * stride);
+	double cosk[NCOEFF][NCOEFF];
+	for (int k = 0; k < NCOEFF; k++)
+		for (int j = 0; j < NCOEFF; j++)
+			cosk[k][j] = cos(M_PI * j * (k + 0.5) / NCOEFF);
+	for (long i = _i0; i < _i1; i++) {
+		double *c = &_coeffs[(i - _i0) * stride];
+		if (old != NULL && i >= old->_i0 && i < old->_i1) {
+			const double *oc = &old->_coeffs[(i - old->_i0) * stride];
+			std::copy(oc, oc + stride, c);
+			continue;
+		}
+		// values at the Chebyshev nodes
+		double f[6][NCOEFF];
+		for (int k = 0; k < NCOEFF; k++) {
+			double t = (i + 0.5 * (cosk[k][1] + 1.0)) * SEGMENT;
+			PVTwaste::sunr(t, f[0][k], f[1][k], f[2][k]);
+			PVTwaste::moonr(t, f[3][k], f[4][k], f[5][k]);
+		}
+		for (int d = 0; d < 6; d++)
+			for (int j = 0; j < NCOEFF; j++) {
+				double sum = 0;
+				for (int k = 0; k < NCOEFF; k++)
+					sum += f[d][k] * cosk[k][j];
+				c[d * NCOEFF + j] = (j == 0 ? 1.0 : 2.0) * sum / NCOEFF;
+			}
+	}
+}
 
-int integratePVTwaste_C(double *rvt, double dt, double step,
-		double cram, bool dopri) {
+void Ephemeris::validate(double t0, double t1, int samples, double *err) const {
+	err[0] = err[1] = 0;
+	for (int i = 0; i < samples; i++) {
+		double t = samples > 1 ? t0 + (t1 - t0) * i / (samples - 1) : t0;
+		if (!covers(t, t))
+			continue;
+		double x, y, z, xa, ya, za;
+		sun(t, x, y, z);
+		PVTwaste::sunr(t, xa, ya, za);
+		err[0] = std::max(err[0],
+				sqrt((x-xa)*(x-xa) + (y-ya)*(y-ya) + (z-za)*(z-za)));
+		moon(t, x, y, z);
+		PVTwaste::moonr(t, xa, ya, za);
+		err[1] = std::max(err[1],
+				sqrt((x-xa)*(x-xa) + (y-ya)*(y-ya) + (z-za)*(z-za)));
+	}
+}
 
-    state_t y(6);
-    for (int i = 0; i < 6; i++) // r, v
-        y[i] = rvt[i];
+static std::mutex ephemerisMutex;
+static std::shared_ptr<const Ephemeris> ephemerisCache;
+
+std::shared_ptr<const Ephemeris> Ephemeris::get(double t0, double t1) {
+	std::shared_ptr<const Ephemeris> eph = std::atomic_load(&ephemerisCache);
+	if (eph && eph->covers(t0, t1))
+		return eph;
+	if (floor(std::max(t0, t1) / SEGMENT) - floor(std::min(t0, t1) / SEGMENT)
+			>= MAX_SEGMENTS)
+		return nullptr;
+	// only writers lock, concurrent misses fit the extension once
+	std::unique_lock<std::mutex> lock(ephemerisMutex);
+	eph = std::atomic_load(&ephemerisCache);
+	if (!eph || !eph->covers(t0, t1)) {
+		eph = std::make_shared<const Ephemeris>(t0, t1, eph.get());
+		std::atomic_store(&ephemerisCache, eph);
+	}
+	return eph;
+}
 
-    PVTwaste pvt;
-    pvt._cram = cram;
+// Butcher tableaus of the fixed step integrators used for batch propagation.
+// DOPRI45 uses the first 6 stages of ode::DOPRI_A, the 7th stage is only
+// needed for the error estimate.
+
+static const int RK4_STAGES = 4;
+static const double RK4_C[4] = { 0, 0.5, 0.5, 1 };
+static const double RK4_A[4][6] = { { 0 }, { 0.5 }, { 0, 0.5 }, { 0, 0, 1 } };
+static const double RK4_B[4] = { 1.0/6, 1.0/3, 1.0/3, 1.0/6 };
+
+// number of states propagated together, stage buffers of a chunk fit into L1.
+static const int BATCH_CHUNK = 64;
+
+// one explicit Runge Kutta step for m states in structure of arrays layout.
+static void stepSoA(PVTwaste &pvt, int m, double *y, const double *cram,
+		double t, double h, int stages, const double *c, const double (*a)[6],
+		const double *b, double *k, double *yt) {
+	int n = 6 * m;
+	for (int s = 0; s < stages; s++) {
+		double *ks = k + s * n;
+		if (s == 0)
+			pvt(m, y, ks, cram, t);
+		else {
+			for (int i = 0; i < n; i++)
+				yt[i] = y[i];
+			for (int j = 0; j < s; j++) {
+				double ha = h * a[s][j];
+				if (ha == 0)
+					continue;
+				const double *kj = k + j * n;
+				for (int i = 0; i < n; i++)
+					yt[i] += ha * kj[i];
+			}
+			pvt(m, yt, ks, cram, t + c[s] * h);
+		}
+	}
+	for (int s = 0; s < stages; s++) {
+		double hb = h * b[s];
+		if (hb == 0)
+			continue;
+		const double *ks = k + s * n;
+		for (int i = 0; i < n; i++)
+			y[i] += hb * ks[i];
+	}
+}
 
-    int steps = 0;
-    double t = rvt[7];
-    double tN = t + dt;
+// propagates m states in structure of arrays layout from t to tN using the
+// same fixed step sequence as integratePVTwaste_C. Returns the number of steps.
+static int propagateSoA(PVTwaste &pvt, int m, double *y, const double *cram,
+		double t, double tN, double step, bool dopri) {
+	int stages = dopri ? DOPRI_STAGES - 1 : RK4_STAGES;
+	std::vector<double> k(stages * 6 * m);
+	std::vector<double> yt(6 * m);
+	const double *c = dopri ? DOPRI_C : RK4_C;
+	const double (*a)[6] = dopri ? DOPRI_A : RK4_A;
+	const double *b = dopri ? DOPRI_B : RK4_B;
+	bool forward = tN >= t;
+	step = forward ? fabs(step) : -fabs(step);
+	int steps = 0;
+	while (forward ? t < tN : t > tN) {
+		steps++;
+		bool last = forward ? t + step >= tN : t + step <= tN;
+		double h = last ? tN - t : step;
+		stepSoA(pvt, m, y, cram, t, h, stages, c, a, b, k.data(), yt.data());
+		if (last)
+			break;
+		t += h;
+	}
+	return steps;
+}
 
-    if (dt > 0) {
-		if (dopri) {
-			DOPRI45 integrator;
-			while (t < tN) {
-				steps++;
-				if (t + step >= tN) {
-					integrator(pvt, y, t, tN - t);
+// propagates an object and a target with the same force model,
+// the state holds r, v of the object followed by r, v of the target.
+struct PVTwastePair {
+
+	PVTwaste _obj;
+	PVTwaste _target;
+	state_t _y = state_t(6);
+	state_t _yDot = state_t(6);
+
+	void operator()(const state_t &y, state_t &yDot, const double t) {
+		for (int k = 0; k < 2; k++) {
+			for (int i = 0; i < 6; i++)
+				_y[i] = y[6*k + i];
+			if (k == 0)
+				_obj(_y, _yDot, t);
+			else
+				_target(_y, _yDot, t);
+			for (int i = 0; i < 6; i++)
+				yDot[6*k + i] = _yDot[i];
+		}
+	}
+};
+
+// writes N+1 equally spaced samples: time, r, v, keplerian elements,
+// interpolated from the dense output of the integrator. The elements are
+// computed for all samples at once by elements().
+struct SampleObserver {
+
+	SampleObserver(double *res, int N, double t0, double tN, double mu) :
+			_res(res), _N(N), _t0(t0), _tN(tN), _mu(mu), _next(1), _y(6) {
+	}
+
+	void sample(int i, double t, const state_t &y) {
+		double *res = _res + 13 * i;
+		res[0] = t;
+		for (int k = 0; k < 6; k++)
+			res[1 + k] = y[k];
+	}
+
+	// keplerian elements of all samples written so far
+	void elements() {
+		ic2parBatch(_next, _res + 1, 13, 1, _mu, _res + 7, 13, 1);
+	}
+
+	void operator()(Dopri45<> &integrator, double t0, double t1) {
+		for (; _next <= _N; _next++) {
+			double t = _next == _N ? _tN : _t0 + (_tN - _t0) * _next / _N;
+			if (fabs(t - _t0) > fabs(t1 - _t0))
+				break;
+			integrator.interpolate(t, _y);
+			sample(_next, t, _y);
+		}
+	}
+
+	double *_res;
+	int _N;
+	double _t0;
+	double _tN;
+	double _mu;
+	int _next;
+	state_t _y;
+};
+
+enum {
+	EVENT_ALTITUDE = 1, EVENT_APSIS = 2, EVENT_DISTANCE = 4, EVENT_APPROACH = 8
+};
+
+static const int EVENT_TYPES = 4;
+static const int EVENT_SIZE = 9; // type, direction, time, r[3], v[3]
+
+// detects sign changes of the event functions between accepted steps and
+// locates the event time on the dense output.
+struct EventObserver {
+
+	EventObserver(int mask, double radius, double dist, int maxEvents,
+			double *events) :
+			_mask(mask), _radius(radius), _dist(dist), _maxEvents(maxEvents),
+			_events(events), _count(0), _integrator(NULL), _type(0) {
+	}
+
+	double g(int type, const state_t &y) {
+		switch (type) {
+		case 0: // altitude
+			return sqrt(y[0]*y[0] + y[1]*y[1] + y[2]*y[2]) - _radius;
+		case 1: // apsis, r.v rising at periapsis
+			return y[0]*y[3] + y[1]*y[4] + y[2]*y[5];
+		case 2: { // target distance
+			double dx = y[0] - y[6], dy = y[1] - y[7], dz = y[2] - y[8];
+			return sqrt(dx*dx + dy*dy + dz*dz) - _dist;
+		}
+		default: // close approach, relative r.v rising at minimal distance
+			return (y[0] - y[6]) * (y[3] - y[9]) + (y[1] - y[7]) * (y[4] - y[10])
+					+ (y[2] - y[8]) * (y[5] - y[11]);
+		}
+	}
+
+	void init(double t, const state_t &y) {
+		_y = y;
+		for (int type = 0; type < EVENT_TYPES; type++)
+			if (_mask & (1 << type))
+				_g[type] = g(type, y);
+	}
+
+	// event function at time t on the dense output of the current step
+	double operator()(double t) {
+		_integrator->interpolate(t, _y);
+		return g(_type, _y);
+	}
+
+	void operator()(Dopri45<> &integrator, double t0, double t1) {
+		_integrator = &integrator;
+		for (int type = 0; type < EVENT_TYPES; type++) {
+			if (!(_mask & (1 << type)))
+				continue;
+			_type = type;
+			double g0 = _g[type];
+			double g1 = (*this)(t1);
+			if ((g0 < 0 && g1 >= 0) || (g0 > 0 && g1 <= 0)) {
+				double t = findRoot(*this, t0, t1, g0, g1,
+						1E-9 * std::max(1.0, fabs(t1)));
+				_integrator->interpolate(t, _y);
+				if (_count < _maxEvents) {
+					double *ev = _events + EVENT_SIZE * _count;
+					ev[0] = 1 << type;
+					ev[1] = g1 > g0 ? 1 : -1;
+					ev[2] = t;
+					for (int i = 0; i < 6; i++)
+						ev[3 + i] = _y[i];
+				}
+				_count++;
+			}
+			_g[type] = g1;
+		}
+	}
+
+	int _mask;
+	double _radius;
+	double _dist;
+	int _maxEvents;
+	double *_events;
+	int _count;
+	Dopri45<> *_integrator;
+	int _type;
+	double _g[EVENT_TYPES];
+	state_t _y;
+};
+
+// keeps the compiler from removing benchmark integrations
+static volatile double benchmarkSink = 0;
+
+// fixed step integration steps per second measured for about seconds.
+template<class Integrator, class System, class State>
+static double stepsPerSecond(Integrator &integrator, System &sys, State y,
+		double step, double seconds) {
+	State y0 = y;
+	auto t0 = std::chrono::steady_clock::now();
+	long steps = 0;
+	double elapsed = 0;
+	while (elapsed < seconds) {
+		y = y0;
+		steps += integrateFixed(integrator, sys, y, 1000 * step, step);
+		benchmarkSink = benchmarkSink + y[0];
+		elapsed = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - t0).count();
+	}
+	return steps / elapsed;
+}
+
+// adaptive integration steps per second measured for about seconds.
+template<class System, class State>
+static double adaptiveStepsPerSecond(System &sys, State y, double seconds) {
+	State y0 = y;
+	auto t0 = std::chrono::steady_clock::now();
+	long steps = 0;
+	double elapsed = 0;
+	while (elapsed < seconds) {
+		y = y0;
+		steps += integrateAdaptive(sys, y, 0, 86400, 1E-9, 1E-12, 0, 0, NULL);
+		benchmarkSink = benchmarkSink + y[0];
+		elapsed = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - t0).count();
+	}
+	return steps / elapsed;
+}
+
+// fixed step propagation of y (r, v) from t to t + dt as performed by
+// integratePVTwaste_C, dt < 0 propagates backwards. Returns the number of
+// steps.
+template<class Integrator, class State>
+static int propagatePVTwaste(Integrator &integrator, PVTwaste &pvt, State &y,
+		double t, double dt, double step) {
+	int steps = 0;
+	double tN = t + dt;
+	if (dt > 0) {
+		while (t < tN) {
+			steps++;
+			if (t + step >= tN) {
+				integrator(pvt, y, t, tN - t);
+				break;
+			} else
+				integrator(pvt, y, t, step);
+		}
+	} else {
+		step = -fabs(step); // step negative
+		while (t > dt) {
+			steps++;
+			if (t + step <= tN) {
+				integrator(pvt, y, t, tN - t);
+				break;
+			} else
+				integrator(pvt, y, t, step);
+		}
+	}
+	return steps;
+}
+
+// N + 1 equally spaced samples of the fixed step propagation of y from t to
+// t + dtN as performed by integratePVTwasteN_C. res receives time, r, v of
+// each sample, the keplerian elements are skipped.
+template<class Integrator, class State>
+static void samplePVTwaste(Integrator &integrator, PVTwaste &pvt, State &y,
+		double t, double dtN, double step, int N, double *res) {
+	double tN = t + dtN;
+	double dt = (tN - t) / N;
+	if (dtN < 0)
+		step = -fabs(step); // step negative
+	int j = 0;
+	for (int i = 0; i < N+1; i++) {
+		res[j++] = t;
+		for (int k = 0; k < 6; k++)
+			res[j++] = y[k];
+		j += 6; // keplerian elements, see below
+		if (i == N) break;
+		double nextT = t + dt;
+		if (dtN > 0) {
+			while (t < nextT) {
+				if (t + step >= nextT) {
+					integrator(pvt, y, t, nextT - t);
 					break;
 				} else
 					integrator(pvt, y, t, step);
 			}
 		} else {
-			RK4 integrator;
-			while (t < tN) {
-				steps++;
-				if (t + step >= tN) {
-					integrator(pvt, y, t, tN - t);
+			while (t > nextT) {
+				if (t + step <= nextT) {
+					integrator(pvt, y, t, nextT - t);
 					break;
 				} else
 					integrator(pvt, y, t, step);
 			}
 		}
+	}
+}
+
+using namespace std;
+
+extern "C" {
+
+// fixed step propagation, the RK4 integrator uses a fixed size state.
+int integratePVTwaste_C(double *rvt, double dt, double step,
+		double cram, bool dopri) {
+
+    PVTwaste pvt;
+    pvt._cram = cram;
+
+    int steps = 0;
+    double t = rvt[7];
+    double tN = t + dt;
+    pvt.ephemeris(t, tN);
+
+    if (dopri) {
+    	DOPRI45 integrator;
+    	state_t y(rvt, rvt + 6); // r, v
+    	steps = propagatePVTwaste(integrator, pvt, y, t, dt, step);
+    	std::copy(y.begin(), y.end(), rvt);
     } else {
-    	step = -abs(step); // step negative
-        if (dopri) {
-            DOPRI45 integrator;
-            while (t > dt) {
-                steps++;
-                if (t + step <= tN) {
-                    integrator(pvt, y, t, tN - t);
-                    break;
-                } else
-                    integrator(pvt, y, t, step);
-            }
-        } else {
-            RK4 integrator;
-            while (t > dt) {
-                steps++;
-                if (t + step <= tN) {
-                    integrator(pvt, y, t, tN - t);
-                    break;
-                } else
-                    integrator(pvt, y, t, step);
-            }
-        }
+    	RK4N<6> integrator;
+    	state6_t y;
+    	std::copy(rvt, rvt + 6, y.begin());
+    	steps = propagatePVTwaste(integrator, pvt, y, t, dt, step);
+    	std::copy(y.begin(), y.end(), rvt);
     }
-    for (int i = 0; i < 6; i++)
-        rvt[i] = y[i];
     rvt[7] = tN;
     return steps;
 };
@@ -411,115 +1219,305 @@ int integratePVTwaste_C(double *rvt, double dt, double step,
 void integratePVTwasteN_C(double *rvt, double dtN, double step,
 		double cram, int N, bool dopri, double* res) {
     try {
-		state_t y(6);
-		for (int i = 0; i < 6; i++) // r, v
-			y[i] = rvt[i];
-
 		PVTwaste pvt;
 		pvt._cram = cram;
 
 		// time[1], r[3], v[3], kep[6]
 	    double t = rvt[7];
 	    double tN = t + dtN;
-		double dt = (tN - t) / N;
+	    pvt.ephemeris(t, tN);
 
-	    if (dtN > 0) {
-			if (dopri) {
-				DOPRI45 integrator;
-				int j = 0;
-				for (int i = 0; i < N+1; i++) {
-					res[j++] = t;
-					for (int k = 0; k < 6; k++)
-						res[j++] = y[k];
-					double kep[6];
-					wic2par(y, kep, pvt.muE);
-					for (int k = 0; k < 6; k++)
-						res[j++] = kep[k];
-					if (i == N) break;
-					double nextT = t + dt;
-					while (t < nextT) {
-						if (t + step >= nextT) {
-							integrator(pvt, y, t, nextT - t);
-							break;
-						} else
-							integrator(pvt, y, t, step);
-					}
-				}
-			} else {
-				RK4 integrator;
-				int j = 0;
-				for (int i = 0; i < N+1; i++) {
-					res[j++] = t;
-					for (int k = 0; k < 6; k++)
-						res[j++] = y[k];
-					double kep[6];
-					wic2par(y, kep, pvt.muE);
-					for (int k = 0; k < 6; k++)
-						res[j++] = kep[k];
-					if (i == N) break;
-					double nextT = t + dt;
-					while (t < nextT) {
-						if (t + step >= nextT) {
-							integrator(pvt, y, t, nextT - t);
-							break;
-						} else
-							integrator(pvt, y, t, step);
-					}
-				}
-			}
-	    } else {
-			step = -abs(step); // step negative
+		if (dopri) {
+			DOPRI45 integrator;
+			state_t y(rvt, rvt + 6); // r, v
+			samplePVTwaste(integrator, pvt, y, t, dtN, step, N, res);
+			std::copy(y.begin(), y.end(), rvt);
+		} else {
+			RK4N<6> integrator;
+			state6_t y;
+			std::copy(rvt, rvt + 6, y.begin());
+			samplePVTwaste(integrator, pvt, y, t, dtN, step, N, res);
+			std::copy(y.begin(), y.end(), rvt);
+		}
+		ic2parBatch(N+1, res + 1, 13, 1, pvt.muE, res + 7, 13, 1);
+		rvt[7] = tN;
+     } catch (std::exception &e) {
+         cout << e.what() << endl;
+     }
+};
+
+// Propagates count states in structure of arrays layout: rv holds 6 rows
+// of length count (x, y, z, vx, vy, vz), results are written back into rv.
+// All states start at epoch t0, cram holds the area to mass ratio of each
+// object. Chunks of states are propagated in parallel on the shared thread
+// pool using at most workers threads (<= 0: all cores).
+// Returns the number of steps performed for each state.
+
+int integratePVTwasteBatch_C(double *rv, int count, double t0, double dt,
+		double step, double *cram, bool dopri, int workers) {
+	int chunks = (count + BATCH_CHUNK - 1) / BATCH_CHUNK;
+	std::atomic<int> steps(0);
+	PVTwaste proto;
+	proto.ephemeris(t0, t0 + dt);
+	thread_pool::instance().parallel_for(chunks, workers, [&](int c) {
+		int i0 = c * BATCH_CHUNK;
+		int m = std::min(BATCH_CHUNK, count - i0);
+		std::vector<double> y(6 * m);
+		for (int k = 0; k < 6; k++)
+			for (int i = 0; i < m; i++)
+				y[k * m + i] = rv[k * count + i0 + i];
+		PVTwaste pvt = proto;
+		int st = propagateSoA(pvt, m, y.data(), cram + i0, t0, t0 + dt, step, dopri);
+		for (int k = 0; k < 6; k++)
+			for (int i = 0; i < m; i++)
+				rv[k * count + i0 + i] = y[k * m + i];
+		steps = st;
+	});
+	return steps;
+};
+
+// Propagates count independent trajectories like integratePVTwaste_C.
+// rvt holds count states of size 8 (r, v, -, time) updated in place, dt and
+// cram the propagation time and area to mass ratio of each trajectory. The
+// trajectories are distributed dynamically over at most workers threads
+// (<= 0: all cores), each thread uses its own PVTwaste and integrator.
+// Called from a pool thread, for instance from a parallel objective function,
+// all trajectories are propagated by the calling thread.
+// steps (optional) receives the number of steps of each trajectory,
+// the total number of steps is returned.
+
+int integratePVTwasteParallel_C(int count, double *rvt, double *dt,
+		double *cram, double step, bool dopri, int workers, int *steps) {
+	if (count <= 0)
+		return 0;
+	double tmin = HUGE_VAL, tmax = -HUGE_VAL;
+	for (int j = 0; j < count; j++) {
+		double t = rvt[8 * j + 7];
+		tmin = std::min(tmin, std::min(t, t + dt[j]));
+		tmax = std::max(tmax, std::max(t, t + dt[j]));
+	}
+	PVTwaste proto;
+	proto.ephemeris(tmin, tmax);
+	thread_pool &pool = thread_pool::instance();
+	int threads = workers <= 0 ? pool.size() + 1 : workers;
+	threads = std::min(threads, count);
+	std::atomic<int> next(0);
+	std::atomic<int> total(0);
+	pool.parallel_for(threads, threads, [&](int) {
+		PVTwaste pvt = proto;
+		RK4N<6> rk4;
+		DOPRI45 dopri45;
+		state_t y(6);
+		state6_t y6;
+		int sum = 0;
+		int j;
+		while ((j = next++) < count) {
+			double *rvtj = rvt + 8 * j;
+			pvt._cram = cram[j];
+			double t = rvtj[7];
+			double tN = t + dt[j];
+			int st;
 			if (dopri) {
-				DOPRI45 integrator;
-				int j = 0;
-				for (int i = 0; i < N+1; i++) {
-					res[j++] = t;
-					for (int k = 0; k < 6; k++)
-						res[j++] = y[k];
-					double kep[6];
-					wic2par(y, kep, pvt.muE);
-					for (int k = 0; k < 6; k++)
-						res[j++] = kep[k];
-					if (i == N) break;
-					double nextT = t + dt;
-					while (t > nextT) {
-						if (t + step <= nextT) {
-							integrator(pvt, y, t, nextT - t);
-							break;
-						} else
-							integrator(pvt, y, t, step);
-					}
-				}
+				std::copy(rvtj, rvtj + 6, y.begin());
+				st = integrateFixed(dopri45, pvt, y, t, tN, step);
+				std::copy(y.begin(), y.end(), rvtj);
 			} else {
-				RK4 integrator;
-				int j = 0;
-				for (int i = 0; i < N+1; i++) {
-					res[j++] = t;
-					for (int k = 0; k < 6; k++)
-						res[j++] = y[k];
-					double kep[6];
-					wic2par(y, kep, pvt.muE);
-					for (int k = 0; k < 6; k++)
-						res[j++] = kep[k];
-					if (i == N) break;
-					double nextT = t + dt;
-					while (t > nextT) {
-						if (t + step <= nextT) {
-							integrator(pvt, y, t, nextT - t);
-							break;
-						} else
-							integrator(pvt, y, t, step);
-					}
-				}
+				std::copy(rvtj, rvtj + 6, y6.begin());
+				st = integrateFixed(rk4, pvt, y6, t, tN, step);
+				std::copy(y6.begin(), y6.end(), rvtj);
 			}
+			rvtj[7] = tN;
+			if (steps != NULL)
+				steps[j] = st;
+			sum += st;
 		}
+		total += sum;
+	});
+	return total;
+};
+
+// Adaptive step size versions of integratePVTwaste_C and integratePVTwasteN_C.
+// Instead of a fixed step the Dormand Prince 5(4) error estimate controls the
+// step size: atol / rtol are the local error tolerances, hmin / hmax limit
+// the step size. stats receives the number of accepted steps, rejected steps
+// and right hand side evaluations. Return -1 / stats[0] = -1 if the step size
+// fell below hmin.
+
+int integratePVTwasteAdaptive_C(double *rvt, double dt, double cram,
+		double atol, double rtol, double hmin, double hmax, int *stats) {
+	state6_t y;
+	std::copy(rvt, rvt + 6, y.begin());
+	PVTwaste pvt;
+	pvt._cram = cram;
+	double t = rvt[7];
+	double tN = t + dt;
+	pvt.ephemeris(t, tN);
+	int steps = integrateAdaptive(pvt, y, t, tN, atol, rtol, hmin, hmax, stats);
+	for (int i = 0; i < 6; i++)
+		rvt[i] = y[i];
+	rvt[7] = tN;
+	return steps;
+};
+
+void integratePVTwasteNAdaptive_C(double *rvt, double dtN, double cram, int N,
+		double atol, double rtol, double hmin, double hmax, double *res,
+		int *stats) {
+	try {
+		state_t y(rvt, rvt + 6);
+		PVTwaste pvt;
+		pvt._cram = cram;
+		// time[1], r[3], v[3], kep[6]
+		double t = rvt[7];
+		double tN = t + dtN;
+		pvt.ephemeris(t, tN);
+		// samples are interpolated, the integration is not restarted
+		Dopri45<> integrator(6, atol, rtol, hmin, hmax, 0);
+		SampleObserver samples(res, N, t, tN, pvt.muE);
+		samples.sample(0, t, y);
+		bool ok = integrator.integrate(pvt, y, t, tN, samples);
+		samples.elements();
 		for (int i = 0; i < 6; i++)
 			rvt[i] = y[i];
-		rvt[7] = tN;
-     } catch (std::exception &e) {
-         cout << e.what() << endl;
-     }
+		rvt[7] = t;
+		if (stats != NULL) {
+			stats[0] = ok ? integrator.steps() : -1;
+			stats[1] = integrator.rejected();
+			stats[2] = integrator.evaluations();
+		}
+	} catch (std::exception &e) {
+		cout << e.what() << endl;
+	}
 };
 
-}
+// Adaptive propagation with event detection. Events are located on the dense
+// output of the integrator, so no fine sampling of the trajectory is needed.
+// mask selects the events (see EVENT_ALTITUDE ...):
+// - altitude: the distance to the earth center crosses Re + alt
+// - apsis: periapsis (direction 1) and apoapsis (direction -1)
+// - distance: the distance to the target crosses dist
+// - approach: local minimum of the distance to the target
+// target (r, v at the same epoch, area to mass ratio targetCram) is only used
+// for distance / approach events and is propagated together with the object,
+// its final state is written back. events receives up to maxEvents records of
+// EVENT_SIZE doubles: type, direction, time, r[3], v[3].
+// Returns the number of events detected or -1 if the step size fell below
+// hmin, stats as for integratePVTwasteAdaptive_C.
+
+int integratePVTwasteEvents_C(double *rvt, double dt, double cram,
+		double atol, double rtol, double hmin, double hmax, int mask,
+		double alt, double *target, double targetCram, double dist,
+		int maxEvents, double *events, int *stats) {
+	try {
+		double t = rvt[7];
+		double tN = t + dt;
+		bool withTarget = (mask & (EVENT_DISTANCE | EVENT_APPROACH)) != 0;
+		int n = withTarget ? 12 : 6;
+		state_t y(n);
+		for (int i = 0; i < 6; i++) {
+			y[i] = rvt[i];
+			if (withTarget)
+				y[i + 6] = target[i];
+		}
+		EventObserver observer(mask, PVTwaste::Re + alt, dist, maxEvents, events);
+		observer.init(t, y);
+		Dopri45<> integrator(n, atol, rtol, hmin, hmax, 0);
+		bool ok;
+		if (withTarget) {
+			PVTwastePair pair;
+			pair._obj._cram = cram;
+			pair._target._cram = targetCram;
+			pair._obj.ephemeris(t, tN);
+			pair._target._eph = pair._obj._eph;
+			ok = integrator.integrate(pair, y, t, tN, observer);
+		} else {
+			PVTwaste pvt;
+			pvt._cram = cram;
+			pvt.ephemeris(t, tN);
+			ok = integrator.integrate(pvt, y, t, tN, observer);
+		}
+		for (int i = 0; i < 6; i++) {
+			rvt[i] = y[i];
+			if (withTarget)
+				target[i] = y[i + 6];
+		}
+		rvt[7] = t;
+		if (stats != NULL) {
+			stats[0] = ok ? integrator.steps() : -1;
+			stats[1] = integrator.rejected();
+			stats[2] = integrator.evaluations();
+		}
+		return ok ? observer._count : -1;
+	} catch (std::exception &e) {
+		cout << e.what() << endl;
+		return -1;
+	}
+};
+
+// Fits the shared Chebyshev sun / moon cache for [t0, t1] in advance. If
+// enabled, PVTwaste integrations extend the cache on demand anyway.
+// err receives the maximal position error in km of sun and moon compared to
+// the analytic series at samples equally spaced times, 0 if [t0, t1] exceeds
+// the cache size.
+void fitEphemeris_C(double t0, double t1, int samples, double *err) {
+	std::shared_ptr<const Ephemeris> eph = Ephemeris::get(t0, t1);
+	if (err != NULL) {
+		err[0] = err[1] = 0;
+		if (eph)
+			eph->validate(t0, t1, samples, err);
+	}
+};
+
+// enable / disable the Chebyshev cache, disabled (the default) uses the
+// analytic series.
+void useEphemeris_C(bool use) {
+	Ephemeris::enabled = use;
+};
+
+// Measures integration steps per second of the dynamic size (state_t) and
+// fixed size (std::array) integrators for the built in models, each measured
+// for about seconds. res receives 8 values: RK4 Damp dynamic / fixed,
+// RK4 F8 dynamic / fixed, RK4 PVTwaste dynamic / fixed,
+// Dopri45 PVTwaste dynamic / fixed.
+void benchmarkAscent_C(double seconds, double *res) {
+	Damp damp;
+	damp.alpha = 0.05;
+	F8 f8;
+	f8.w = 1;
+	PVTwaste pvt;
+	pvt._cram = 0.01;
+	double r = 7000;
+	double v = sqrt(PVTwaste::muE / r);
+	double y2[] = { 1, 0 };
+	double y3[] = { 0.4655, 0, 0 };
+	double y6[] = { r, 0, 0, 0, v, 0 };
+	state_t d2(y2, y2 + 2), d3(y3, y3 + 3), d6(y6, y6 + 6);
+	state2_t f2 = {{ y2[0], y2[1] }};
+	state3_t f3 = {{ y3[0], y3[1], y3[2] }};
+	state6_t f6;
+	std::copy(y6, y6 + 6, f6.begin());
+	RK4 rk4;
+	res[0] = stepsPerSecond(rk4, damp, d2, 0.01, seconds);
+	RK4N<2> rk4_2;
+	res[1] = stepsPerSecond(rk4_2, damp, f2, 0.01, seconds);
+	res[2] = stepsPerSecond(rk4, f8, d3, 0.01, seconds);
+	RK4N<3> rk4_3;
+	res[3] = stepsPerSecond(rk4_3, f8, f3, 0.01, seconds);
+	pvt.ephemeris(0, 86400);
+	res[4] = stepsPerSecond(rk4, pvt, d6, 1, seconds);
+	RK4N<6> rk4_6;
+	res[5] = stepsPerSecond(rk4_6, pvt, f6, 1, seconds);
+	res[6] = adaptiveStepsPerSecond(pvt, d6, seconds);
+	res[7] = adaptiveStepsPerSecond(pvt, f6, seconds);
+};
+
+// Cartesian to keplerian elements for n states, see kep_toolbox::ic2par.
+// Coordinate k (x, y, z, vx, vy, vz) of state j is read from
+// rv[j * rs + k * cs], element k (a, e, i, Omega, omega, eccentric anomaly)
+// is written to kep[j * ks + k * kcs]. Use rs = 1, cs = n for structure of
+// arrays layout, rs = 6, cs = 1 for consecutive states.
+void ic2parBatch_C(int n, double *rv, int rs, int cs, double mu, double *kep,
+		int ks, int kcs) {
+	ic2parBatch(n, rv, rs, cs, mu, kep, ks, kcs);
+};
 
+}
@@ -8,8 +8,6 @@
 #include <float.h>
 #include <ctime>
 #include <random>
-#define EIGEN_VECTORIZE_SSE2
-#include <EigenRand/EigenRand>
 #include "biteopt.h"
 #include "evaluator.h"
 
@@ -38,8 +36,6 @@ public:
         // Number of iterations already performed.
         // Limit for fitness value.
         stopfitness = stopfitness_;
-        //std::random_device rd;
-        rs = new Eigen::Rand::P8_mt19937_64(seed_);
         // stop criteria
         stop = 0;
 
@@ -50,10 +46,6 @@ public:
         init(rnd, init_);
     }
 
-    ~BiteOptimizer() {
-        delete rs;
-    }
-
     virtual void getMinValues(double *const p) const {
         fitfun->getMinValues(p);
     }
@@ -115,7 +107,6 @@ private:
     double bestY;
     int stop;
     vec bestX;
-    Eigen::Rand::P8_mt19937_64 *rs;
     CBiteRnd rnd;
 };
 
@@ -141,6 +132,7 @@ void optimizeBite_C(long runid, callback_type func, int dim, int seed,
         upper_limit.resize(0);
     }
     Fitness fitfun(func, noop_callback_par,  n, 1, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     BiteOptimizer opt(runid, &fitfun, dim, init, seed, M, popsize, stall_iterations, maxEvals,
             stopfitness);
 
@@ -9,7 +9,6 @@
 //
 // Requires Eigen version >= 3.4 because new slicing capabilities are used, see
 // https://eigen.tuxfamily.org/dox-devel/group__TutorialSlicingIndexing.html
-// requires https://github.com/bab2min/EigenRand for random number generation.
 
 #include <Eigen/Core>
 #include <Eigen/Eigenvalues>
@@ -19,8 +18,8 @@
 #include <stdint.h>
 #include <ctime>
 #include <inttypes.h>
-#include <EigenRand/EigenRand>
 #include "evaluator.h"
+#include "parallel.h"
 
 using namespace std;
 
@@ -56,10 +55,10 @@ public:
         stopfitness = stopfitness_;
         penalty_coef = penalty_coef_ > 0 ? penalty_coef_ : 1e5;
         use_constraint_violation = use_constraint_violation_;
-        rs = new Eigen::Rand::P8_mt19937_64(seed);
+        rs = philox(seed);
 
         stop = 0;
-        v = normalVec(dim, *rs) / sqrt(dim);
+        v = normalVec(dim, rs) / sqrt(dim);
         D = constant(dim, 1);
         w_rank_hat = ((log(sequence(1, lamb, 1).array()) * -1.) + log(mu + 1)).cwiseMax(0);
         w_rank = (w_rank_hat / w_rank_hat.sum()).array() - (1. / lamb);
@@ -86,7 +85,6 @@ public:
     };
 
     virtual ~CrfmnesOptimizer() {
-        delete rs;
     }
 
     void doOptimize() {
@@ -140,7 +138,7 @@ public:
     }
 
     mat ask() {
-        mat zhalf = normal(dim, mu, *rs);
+        mat zhalf = normal(dim, mu, rs);
         for (int i = 0; i < lamb; i++) {
             if (i < mu) z.col(i) = zhalf.col(i);
             else z.col(i) = -zhalf.col(i-mu);
@@ -153,7 +151,7 @@ public:
         return x;
     }
 
-    void tell(vec &evs) {
+    void tell(const Eigen::Ref<const vec> &evs) {
         evals_no_sort = vec(evs);
         for (int k = 0; k < lamb; k++) {
             if (!isfinite(evals_no_sort[k]))
@@ -262,6 +260,9 @@ public:
         sigma = sigma * cexp(eta_sigma / 2 * G_s);
     }
 
+    // population buffer shared with the caller, see pop_buffer
+    pop_buffer buffer;
+
 private:
 
     double cexp(double a) { return exp(min(a, 100.0)); } // avoid overflow
@@ -317,7 +318,7 @@ private:
     int lamb;
     int mu;
     bool use_constraint_violation;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox rs;
     vec v;
     vec D;
     double penalty_coef;
@@ -383,6 +384,7 @@ void optimizeCRFMNES_C(int64_t  runid, callback_parallel func_par, int dim,
     }
 
     Fitness fitfun(noop_callback, func_par, n, 1, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     fitfun.setNormalize(normalize);
 
     CrfmnesOptimizer opt(runid, &fitfun, dim, guess, sigma, popsize,
@@ -444,11 +446,9 @@ void askCRFMNES_C(uintptr_t ptr, double* xs) {
     int lamb = opt->getPopsize();
     mat popX = opt->ask();
     Fitness* fitfun = opt->getFitfun();
-    for (int p = 0; p < lamb; p++) {
-        vec x = fitfun->getClosestFeasible(fitfun->decode(popX.col(p)));
-        for (int i = 0; i < n; i++)
-            xs[p * n + i] = x[i];
-    }
+    Eigen::Map<mat> X(xs, n, lamb);
+    for (int p = 0; p < lamb; p++)
+        X.col(p) = fitfun->getClosestFeasible(fitfun->decode(popX.col(p)));
 }
 
 int tellCRFMNES_C(uintptr_t ptr, double* ys) {//, double* xs) {
@@ -463,13 +463,63 @@ int tellCRFMNES_C(uintptr_t ptr, double* ys) {//, double* xs) {
 //            x[i] = xs[p * dim + i];
 //        popX.col(p) = fitfun->decode(x);
 //    }
-    vec vals(lamb);
-    for (int i = 0; i < lamb; i++)
-        vals[i] = ys[i];
-    opt->tell(vals);
+    opt->tell(Eigen::Map<const vec>(ys, lamb));
     return opt->getStop();
 }
 
+// maps the population buffer of the optimizer, see pop_buffer. askBufferCRFMNES_C
+// writes the next population to xs, tellBufferCRFMNES_C reads the function
+// values from ys, so the caller maps the buffer once and passes no data.
+void bufferCRFMNES_C(uintptr_t ptr, double** xs, double** ys) {
+    CrfmnesOptimizer *opt = (CrfmnesOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    *xs = opt->buffer.xs();
+    *ys = opt->buffer.ys();
+}
+
+void askBufferCRFMNES_C(uintptr_t ptr) {
+    CrfmnesOptimizer *opt = (CrfmnesOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    askCRFMNES_C(ptr, opt->buffer.xs());
+}
+
+int tellBufferCRFMNES_C(uintptr_t ptr) {
+    CrfmnesOptimizer *opt = (CrfmnesOptimizer*) ptr;
+    return tellCRFMNES_C(ptr, opt->buffer.ys());
+}
+
+// Batched ask for n optimizers, saves the per instance call overhead if many
+// instances are driven from Python. Instance i writes its popsize x dim
+// population to xs behind the populations of the instances before it. The
+// instances are processed in parallel using at most workers threads,
+// workers <= 0 means all cores.
+void askManyCRFMNES_C(uintptr_t* ptrs, int n, double* xs, int workers) {
+    vector<long> offsets(n);
+    long offset = 0;
+    for (int i = 0; i < n; i++) {
+        CrfmnesOptimizer *opt = (CrfmnesOptimizer*) ptrs[i];
+        offsets[i] = offset;
+        offset += (long) opt->getPopsize() * opt->getDim();
+    }
+    thread_pool::instance().parallel_for(n, workers, [&](int i) {
+        askCRFMNES_C(ptrs[i], xs + offsets[i]);
+    });
+}
+
+// Batched tell, ys holds popsize values per instance in the order of the
+// instances, the stop criteria of instance i is written to stops[i].
+void tellManyCRFMNES_C(uintptr_t* ptrs, int n, double* ys, int* stops, int workers) {
+    vector<long> offsets(n);
+    long offset = 0;
+    for (int i = 0; i < n; i++) {
+        offsets[i] = offset;
+        offset += ((CrfmnesOptimizer*) ptrs[i])->getPopsize();
+    }
+    thread_pool::instance().parallel_for(n, workers, [&](int i) {
+        stops[i] = tellCRFMNES_C(ptrs[i], ys + offsets[i]);
+    });
+}
+
 int populationCRFMNES_C(uintptr_t ptr, double* xs) {
     CrfmnesOptimizer *opt = (CrfmnesOptimizer*) ptr;
     int dim = opt->getDim();
@@ -8,8 +8,6 @@
 #include <float.h>
 #include <ctime>
 #include <random>
-#define EIGEN_VECTORIZE_SSE2
-#include <EigenRand/EigenRand>
 #include "smaesopt.h"
 #include "evaluator.h"
 
@@ -37,8 +35,6 @@ public:
         // Number of iterations already performed.
         // Limit for fitness value.
         stopfitness = stopfitness_;
-        //std::random_device rd;
-        rs = new Eigen::Rand::P8_mt19937_64(seed_);
         // stop criteria
         stop = 0;
 
@@ -49,10 +45,6 @@ public:
         init(rnd, init_, 1.0, sdev_);
     }
 
-    ~CsmaOptimizer() {
-        delete rs;
-    }
-
     virtual void getMinValues(double *const p) const {
         fitfun->getMinValues(p);
     }
@@ -113,7 +105,6 @@ private:
     double bestY;
     int stop;
     vec bestX;
-    Eigen::Rand::P8_mt19937_64 *rs;
     CBiteRnd rnd;
 };
 
@@ -139,6 +130,7 @@ void optimizeCsma_C(long runid, callback_type func, int dim, int seed,
         upper_limit.resize(0);
     }
     Fitness fitfun(func, noop_callback_par, dim, 1, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     CsmaOptimizer opt(runid, &fitfun, dim, init, sigma, seed, popsize, maxEvals,
             stopfitness);
 
@@ -14,9 +14,7 @@
 #include <float.h>
 #include <math.h>
 #include <ctime>
-#include <random>
-#define EIGEN_VECTORIZE_SSE2
-#include <EigenRand/EigenRand>
+#include "philox.h"
 #include <LBFGSB.h>
 
 using namespace LBFGSpp;
@@ -34,20 +32,20 @@ typedef double (*callback_type)(int, const double*);
 
 class Fitness;
 
-static uniform_real_distribution<> distr_01 = std::uniform_real_distribution<>(
-        0, 1);
-static normal_distribution<> gauss_01 = std::normal_distribution<>(0, 1);
-
 static vec zeros(int n) {
     return Eigen::MatrixXd::Zero(n, 1);
 }
 
-static Eigen::MatrixXd normalVec(int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::normal<vec>(dim, 1, rs);
+static Eigen::MatrixXd normalVec(int dim, philox &rs) {
+    vec v(dim);
+    rs.fillNormal(v.data(), dim);
+    return v;
 }
 
-static Eigen::MatrixXd uniformVec(int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::uniformReal<vec>(dim, 1, rs);
+static Eigen::MatrixXd uniformVec(int dim, philox &rs) {
+    vec v(dim);
+    rs.fillUniform(v.data(), dim);
+    return v;
 }
 
 static vec emptyVec = { };
@@ -237,7 +235,7 @@ class VisitingDistribution {
 
 public:
 
-    VisitingDistribution(int dim, double visiting_param_, Eigen::Rand::P8_mt19937_64 *rs_) {
+    VisitingDistribution(int dim, double visiting_param_, philox *rs_) {
         _visiting_param = visiting_param_;
         rs = rs_;
 
@@ -262,8 +260,8 @@ public:
         int dim = x.size();
         if (step < dim) {
             // Changing all coordinates with a new visiting value
-            double upper_sample = distr_01(*rs);
-            double lower_sample = distr_01(*rs);
+            double upper_sample = rs->uniform();
+            double lower_sample = rs->uniform();
             vec visits = visit_fn(temperature, dim);
             for (int i = 0; i < dim; i++) {
                 if (visits[i] > TAIL_LIMIT)
@@ -288,9 +286,9 @@ public:
             vec x_visit = vec(x);
             double visit = visit_fn(temperature, 1)[0];
             if (visit > TAIL_LIMIT)
-                visit = TAIL_LIMIT * distr_01(*rs);
+                visit = TAIL_LIMIT * rs->uniform();
             else if (visit < -TAIL_LIMIT)
-                visit = -TAIL_LIMIT * distr_01(*rs);
+                visit = -TAIL_LIMIT * rs->uniform();
             int index = step - dim;
             x_visit[index] = visit + x[index];
             double a = x_visit[index];
@@ -327,7 +325,7 @@ public:
 
 private:
 
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox *rs;
     double _visiting_param;
     double _factor4_p;
     double _factor6;
@@ -363,7 +361,7 @@ public:
         current_location = { };
     }
 
-    void reset(Fitness *owf, Eigen::Rand::P8_mt19937_64 *rs, const vec &x0) {
+    void reset(Fitness *owf, philox *rs, const vec &x0) {
         if (x0.size() == 0)
             current_location = normalVec(dim, *rs);
         else
@@ -412,7 +410,7 @@ class StrategyChain {
 public:
 
     StrategyChain(double acceptance_param_, VisitingDistribution *vd_,
-            Fitness *ofw_, Eigen::Rand::P8_mt19937_64 *rs_, EnergyState *state_) {
+            Fitness *ofw_, philox *rs_, EnergyState *state_) {
         // Global optimizer state
         state = state_;
         // Local markov chain minimum energy and location
@@ -432,7 +430,7 @@ public:
     }
 
     void accept_reject(int j, double e, const vec &x_visit) {
-        double r = distr_01(*rs);
+        double r = rs->uniform();
         double pqv_temp = (acceptance_param - 1.0) * (e - state->current_energy)
                 / (temperature_step + 1.);
         double pqv = 0;
@@ -507,7 +505,7 @@ public:
             double pls = exp(
                     K * (state->ebest - state->current_energy)
                             / temperature_step);
-            if (pls >= distr_01(*rs))
+            if (pls >= rs->uniform())
                 do_ls = true;
         }
         // Global energy not improved, let's see what LS gives
@@ -537,7 +535,7 @@ private:
     VisitingDistribution *vd;
     int not_improved_idx;
     int not_improved_max_idx;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox *rs;
     Fitness *ofw;
     double temperature_step;
     double K;
@@ -559,19 +557,18 @@ public:
         if (x0_.size() > 0 && x0_.size() != owf->lower.size())
             throw sizeeexc;
         //Initialization of RandomState for reproducible runs if seed provided
-        rs = new Eigen::Rand::P8_mt19937_64(seed_);
+        rs = philox(seed_);
         use_local_search = use_local_search_;
         // Initialization of the energy state
         es = new EnergyState(owf->lower.size());
-        es->reset(owf, rs, x0_);
+        es->reset(owf, &rs, x0_);
         // VisitingDistribution instance
-        vd = new VisitingDistribution(owf->lower.size(), qv, rs);
+        vd = new VisitingDistribution(owf->lower.size(), qv, &rs);
         // Markov chain instance
-        sc = new StrategyChain(qa, vd, owf, rs, es);
+        sc = new StrategyChain(qa, vd, owf, &rs, es);
     }
 
     ~DARunner() {
-        delete rs;
         delete vd;
         delete sc;
         delete es;
@@ -590,7 +587,7 @@ public:
                     return;
                 // Need a re-annealing process?
                 if (temperature < temperature_restart) {
-                    es->reset(owf, rs, emptyVec);
+                    es->reset(owf, &rs, emptyVec);
                     break;
                 }
                 // starting strategy chain
@@ -627,7 +624,7 @@ private:
     // re-annealing temperature_start
     double temperature_restart = 0.1;
     Fitness *owf;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox rs;
     EnergyState *es;
     StrategyChain *sc;
     VisitingDistribution *vd;
@@ -11,7 +11,6 @@
 //
 // Requires Eigen version >= 3.4 because new slicing capabilities are used, see
 // https://eigen.tuxfamily.org/dox-devel/group__TutorialSlicingIndexing.html
-// requires https://github.com/bab2min/EigenRand for random number generation.
 //
 // Supports parallel fitness function evaluation. 
 // 
@@ -37,8 +36,10 @@
 #include <random>
 #include <queue>
 #include <tuple>
-#include <EigenRand/EigenRand>
 #include "evaluator.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "surrogate.h"
 
 using namespace std;
 
@@ -76,7 +77,7 @@ public:
         stop = 0;
         pos = 0;
         //std::random_device rd;
-        rs = new Eigen::Rand::P8_mt19937_64(seed_);
+        rs = philox(seed_);
         // Indicating which parameters are discrete integer values. If defined these parameters will be
         // rounded to the next integer and some additional mutation of discrete parameters are performed.
         isInt = isInt_;
@@ -92,30 +93,26 @@ public:
         init();
     }
 
-    ~DeOptimizer() {
-        delete rs;
-    }
-
     double rnd01() {
-        return distr_01(*rs);
+        return rs.uniform();
     }
 
     int rndInt(int max) {
-        return (int) (max * distr_01(*rs));
+        return (int) (max * rs.uniform());
     }
 
     vec sample() {
         if (useNormal)
-            return fitfun->getClosestFeasible(mean + (normalVec(dim, *rs).array() * sigma.array()).matrix());
+            return fitfun->getClosestFeasible(mean + (normalVec(dim, rs).array() * sigma.array()).matrix());
         else
-            return fitfun->sample(*rs);
+            return fitfun->sample(rs);
     }
 
     double sample_i(int i) {
         if (useNormal)
-            return fitfun->getClosestFeasible_i(i, normreal(*rs, mean[i], sigma[i]));
+            return fitfun->getClosestFeasible_i(i, normreal(rs, mean[i], sigma[i]));
         else
-            return fitfun->sample_i(i, *rs);
+            return fitfun->sample_i(i, rs);
     }
 
     void update_mean() {
@@ -135,6 +132,10 @@ public:
             if (iterations > 2)
                 update_mean();
         }
+        return trial(p, xp, xb);
+    }
+
+    vec trial(int p, const vec &xp, const vec &xb) {
         int r1, r2;
         do {
             r1 = rndInt(popsize);
@@ -142,13 +143,13 @@ public:
         do {
             r2 = rndInt(popsize);
         } while (r2 == p || r2 == bestI || r2 == r1);
-        vec x1 = popX.col(r1);
-        vec x2 = popX.col(r2);
-        vec x = xb + (x1 - x2) * F;
         int r = rndInt(dim);
+        vec u(dim);
         for (int j = 0; j < dim; j++)
-            if (j != r && rnd01() > CR)
-                x[j] = xp[j];
+            u[j] = j == r ? 0 : rnd01();
+        vec x(dim);
+        kernels::deTrial(dim, xb.data(), popX.col(r1).data(),
+                popX.col(r2).data(), xp.data(), F, CR, u.data(), x.data());
         vec nextx = fitfun->getClosestFeasible(x);
         modify(nextx);
         return nextx;
@@ -180,6 +181,14 @@ public:
         if (improvesX.empty()) {
             p = pos;
             vec x = nextX(p, popX.col(p), popX.col(bestI));
+            if (screen && screen->ready()) {
+                // keep the best predicted of screenFactor trials
+                mat xs(dim, screenFactor);
+                xs.col(0) = x;
+                for (int k = 1; k < screenFactor; k++)
+                    xs.col(k) = trial(p, popX.col(p), popX.col(bestI));
+                x = xs.col(screen->select(xs, 1)[0]);
+            }
             pos = (pos + 1) % popsize;
             return x;
         } else {
@@ -193,6 +202,8 @@ public:
 
     int tell(double y, const vec &x, int p) {
         //tell function value for a argument list retrieved by ask_one().
+        if (screen)
+            screen->update(x, vec::Constant(1, y));
         if (isfinite(y) && y < popY[p]) {
             if (iterations > 1) {
                 // temporal locality
@@ -222,7 +233,13 @@ public:
         return stop;
     }
 
-    mat askAll() {
+    const mat& askAll() {
+       if (screen) {
+           // model coordinates: best individual, population standard deviation
+           vec m = popX.rowwise().mean();
+           vec sdev = (popX.colwise() - m).rowwise().norm() / sqrt(popsize);
+           screen->setCoordinates(popX.col(bestI), sdev);
+       }
        for (int i = 0; i < popsize;) {
            int p;
            vec x = ask(p);
@@ -233,7 +250,7 @@ public:
        return askedX;
     }
 
-    int tellAll(vec &ys) {
+    int tellAll(const Eigen::Ref<const vec> &ys) {
        for (int i = 0; i < popsize; i++) {
            tell(ys[i], askedX.col(i), askedP[i]);
        }
@@ -241,6 +258,15 @@ public:
        return stop;
     }
 
+    // each trial vector for ask/tell is the best of factor trials predicted
+    // by a quadratic surrogate model of the told function values, see surrogate.h.
+    void enableScreening(int factor, double forgetting) {
+        screenFactor = std::max(1, factor);
+        screen.reset(
+                screenFactor > 1 ?
+                        new surrogate(dim, 1, 0, forgetting) : nullptr);
+    }
+
     void doOptimize() {
 
         // -------------------- Generation Loop --------------------------------
@@ -392,6 +418,21 @@ public:
         return dim;
     }
 
+    // replaces the first individuals by xs with known function values ys,
+    // used to warm start from the best records of an evaluation log.
+    void setPopulation(const mat &xs, const vec &ys) {
+        int n = std::min((int) xs.cols(), popsize);
+        for (int p = 0; p < n; p++) {
+            popX0.col(p) = popX.col(p) = xs.col(p);
+            popY[p] = ys[p];
+        }
+        bestI = index_min(popY);
+        if (popY[bestI] < bestY) {
+            bestY = popY[bestI];
+            bestX = popX.col(bestI);
+        }
+    }
+
     mat getPopulation() {
          return askedX;
     }
@@ -405,6 +446,9 @@ public:
     }
 
 
+    // population buffer shared with the caller, see pop_buffer
+    pop_buffer buffer;
+
 private:
     long runid;
     Fitness *fitfun;
@@ -422,7 +466,7 @@ private:
     double CR0;
     double F;
     double CR;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox rs;
     mat popX;
     mat popX0;
     mat askedX;
@@ -444,6 +488,8 @@ private:
     double minSigmaVal;
     mat meanHist;
     int meanHistIndex;
+    std::unique_ptr<surrogate> screen;
+    int screenFactor = 1;
 };
 
 }
@@ -478,6 +524,7 @@ void optimizeDE_C(long runid, callback_type func, int dim, int seed,
         upper_limit.resize(0);
     }
     Fitness fitfun(func, noop_callback_par, dim, 1, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     DeOptimizer opt(runid, &fitfun, dim, seed, popsize, maxEvals, keep,
             stopfitness, F, CR, min_mutate, max_mutate,
             useIsInt ? isInt : NULL, guess, inputSigma, minSigma);
@@ -543,25 +590,78 @@ void askDE_C(uintptr_t ptr, double* xs) {
     DeOptimizer *opt = (DeOptimizer*) ptr;
     int n = opt->getDim();
     int lamb = opt->getPopsize();
-    mat popX = opt->askAll();
-    Fitness* fitfun = opt->getFitfun();
-    for (int p = 0; p < lamb; p++) {
-        vec x = popX.col(p);
-        for (int i = 0; i < n; i++)
-            xs[p * n + i] = x[i];
-    }
+    Eigen::Map<mat>(xs, n, lamb) = opt->askAll();
+}
+
+// activates surrogate pre-screening for ask/tell: each trial vector returned
+// by askDE_C is the best predicted of factor trials. Useful for expensive
+// objectives, factor <= 1 disables it. forgetting in (0, 1] down weights
+// older evaluations.
+void enableScreeningDE_C(uintptr_t ptr, int factor, double forgetting) {
+    DeOptimizer *opt = (DeOptimizer*) ptr;
+    opt->enableScreening(factor, forgetting);
 }
 
 int tellDE_C(uintptr_t ptr, double* ys) {
     DeOptimizer *opt = (DeOptimizer*) ptr;
     int lamb = opt->getPopsize();
-    vec vals(lamb);
-    for (int i = 0; i < lamb; i++)
-        vals[i] = ys[i];
-    opt->tellAll(vals);
+    opt->tellAll(Eigen::Map<const vec>(ys, lamb));
     return opt->getStop();
 }
 
+// maps the population buffer of the optimizer, see pop_buffer. askBufferDE_C
+// writes the next population to xs, tellBufferDE_C reads the function
+// values from ys, so the caller maps the buffer once and passes no data.
+void bufferDE_C(uintptr_t ptr, double** xs, double** ys) {
+    DeOptimizer *opt = (DeOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    *xs = opt->buffer.xs();
+    *ys = opt->buffer.ys();
+}
+
+void askBufferDE_C(uintptr_t ptr) {
+    DeOptimizer *opt = (DeOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    askDE_C(ptr, opt->buffer.xs());
+}
+
+int tellBufferDE_C(uintptr_t ptr) {
+    DeOptimizer *opt = (DeOptimizer*) ptr;
+    return tellDE_C(ptr, opt->buffer.ys());
+}
+
+// Batched ask for n optimizers, saves the per instance call overhead if many
+// instances are driven from Python. Instance i writes its popsize x dim
+// population to xs behind the populations of the instances before it. The
+// instances are processed in parallel using at most workers threads,
+// workers <= 0 means all cores.
+void askManyDE_C(uintptr_t* ptrs, int n, double* xs, int workers) {
+    vector<long> offsets(n);
+    long offset = 0;
+    for (int i = 0; i < n; i++) {
+        DeOptimizer *opt = (DeOptimizer*) ptrs[i];
+        offsets[i] = offset;
+        offset += (long) opt->getPopsize() * opt->getDim();
+    }
+    thread_pool::instance().parallel_for(n, workers, [&](int i) {
+        askDE_C(ptrs[i], xs + offsets[i]);
+    });
+}
+
+// Batched tell, ys holds popsize values per instance in the order of the
+// instances, the stop criteria of instance i is written to stops[i].
+void tellManyDE_C(uintptr_t* ptrs, int n, double* ys, int* stops, int workers) {
+    vector<long> offsets(n);
+    long offset = 0;
+    for (int i = 0; i < n; i++) {
+        offsets[i] = offset;
+        offset += ((DeOptimizer*) ptrs[i])->getPopsize();
+    }
+    thread_pool::instance().parallel_for(n, workers, [&](int i) {
+        stops[i] = tellDE_C(ptrs[i], ys + offsets[i]);
+    });
+}
+
 int populationDE_C(uintptr_t ptr, double* xs) {
     DeOptimizer *opt = (DeOptimizer*) ptr;
     int dim = opt->getDim();
@@ -575,6 +675,14 @@ int populationDE_C(uintptr_t ptr, double* xs) {
     return opt->getStop();
 }
 
+// initializes the first n individuals, xs has layout n x dim. Used to warm
+// start from the best records of an evaluation log, see readEvalLog_C.
+void initPopulationDE_C(uintptr_t ptr, int n, double* xs, double* ys) {
+    DeOptimizer *opt = (DeOptimizer*) ptr;
+    opt->setPopulation(Eigen::Map<mat>(xs, opt->getDim(), n),
+            Eigen::Map<vec>(ys, n));
+}
+
 int resultDE_C(uintptr_t ptr, double* res) {
     DeOptimizer *opt = (DeOptimizer*) ptr;
     vec bestX = opt->getBestX();
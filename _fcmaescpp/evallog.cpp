@@ -0,0 +1,224 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// C interface of the native evaluation log, see evallog.h. A log is opened
+// with openEvalLog_C and activated with activateEvalLog_C, all Fitness
+// instances created afterwards - by any optimize*_C call - record their
+// evaluations to it.
+// readEvalLog_C selects the best records of a log to warm start optimizers,
+// see initPopulationDE_C, initPopulationMODE_C and the x0 / sigma parameters of
+// initACMA_C. For multiple objectives the first non-dominated fronts are
+// selected. Records violating constraints come last, ordered by the sum of
+// their constraint values > 0.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "evallog.h"
+
+namespace {
+
+typedef std::shared_ptr<eval_log> log_ptr;
+
+// copy of a log record, slot identifies it in the file.
+struct candidate {
+    double key;
+    int64_t slot;
+    std::vector<double> xy;
+};
+
+bool lessKey(const candidate &a, const candidate &b) {
+    return a.key < b.key;
+}
+
+// keeps the k candidates with the smallest key.
+class best_keeper {
+
+public:
+
+    best_keeper(size_t k) :
+            _k(k) {
+    }
+
+    void offer(double key, int64_t slot, const double *xy, int len) {
+        if (_heap.size() >= _k && !(key < _heap.front().key))
+            return;
+        candidate c = { key, slot, std::vector<double>(xy, xy + len) };
+        if (_heap.size() >= _k) {
+            std::pop_heap(_heap.begin(), _heap.end(), lessKey);
+            _heap.back() = c;
+        } else
+            _heap.push_back(c);
+        std::push_heap(_heap.begin(), _heap.end(), lessKey);
+    }
+
+    std::vector<candidate>& values() {
+        return _heap;
+    }
+
+private:
+    size_t _k;
+    std::vector<candidate> _heap;
+};
+
+bool dominates(const double *a, const double *b, int nobj) {
+    bool better = false;
+    for (int i = 0; i < nobj; i++) {
+        if (a[i] > b[i])
+            return false;
+        better |= a[i] < b[i];
+    }
+    return better;
+}
+
+// appends the first non-dominated fronts of cands to sel until it holds n.
+void selectFronts(std::vector<candidate> &cands, int dim, int nobj, int n,
+        std::vector<candidate> &sel) {
+    std::vector<bool> taken(cands.size(), false);
+    while ((int) sel.size() < n) {
+        std::vector<size_t> front;
+        for (size_t i = 0; i < cands.size(); i++) {
+            if (taken[i])
+                continue;
+            bool dominated = false;
+            for (size_t j = 0; j < cands.size() && !dominated; j++)
+                dominated = !taken[j] && j != i
+                        && dominates(&cands[j].xy[dim], &cands[i].xy[dim],
+                                nobj);
+            if (!dominated)
+                front.push_back(i);
+        }
+        if (front.empty())
+            break;
+        // prefer small objective sum inside a front
+        std::sort(front.begin(), front.end(), [&cands](size_t a, size_t b) {
+            return cands[a].key < cands[b].key;
+        });
+        for (size_t i : front) {
+            taken[i] = true;
+            if ((int) sel.size() < n)
+                sel.push_back(cands[i]);
+        }
+    }
+}
+
+}
+
+extern "C" {
+
+// opens or creates the log at path, returns 0 if this fails.
+uintptr_t openEvalLog_C(const char *path, int dim, int nobj) {
+    log_ptr log = eval_log::create(path, dim, nobj);
+    if (!log)
+        return 0;
+    return (uintptr_t) new log_ptr(log);
+}
+
+// Fitness instances created afterwards record to the log, 0 stops recording.
+void activateEvalLog_C(uintptr_t ptr) {
+    eval_log::setActive(ptr ? *(log_ptr*) ptr : log_ptr());
+}
+
+// number of record slots, including unused ones.
+long slotsEvalLog_C(uintptr_t ptr) {
+    return (*(log_ptr*) ptr)->slots();
+}
+
+// the file is closed after all Fitness instances using it are gone.
+void closeEvalLog_C(uintptr_t ptr) {
+    log_ptr *log = (log_ptr*) ptr;
+    if (eval_log::active() == *log)
+        eval_log::setActive(log_ptr());
+    delete log;
+}
+
+// writes the n best records of the log at path to xs (n x dim) and
+// ys (n x (nobj + ncon)), the last ncon values of a record are constraints,
+// feasible if <= 0. Returns the number of records written, -1 on error.
+int readEvalLog_C(const char *path, int dim, int nobj, int ncon, int n,
+        double *xs, double *ys) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return -1;
+    eval_log_header h;
+    int ny = nobj + ncon;
+    if (fread(&h, sizeof(h), 1, f) != 1
+            || memcmp(h.magic, EVAL_LOG_MAGIC, 8) != 0 || h.dim != dim
+            || h.nobj != ny) {
+        fclose(f);
+        return -1;
+    }
+    int rs = eval_log::recordSize(dim, ny);
+    int len = dim + ny;
+    // for multiple objectives candidates for the fronts are the best records
+    // for each objective and for the objective sum
+    size_t k = nobj == 1 ? n : 4 * (size_t) n;
+    std::vector<best_keeper> byObj(nobj > 1 ? nobj : 0, best_keeper(k));
+    best_keeper bySum(k);
+    best_keeper byViolation(n);
+    const int CHUNK = 4096;
+    std::vector<char> buf((size_t) CHUNK * rs);
+    int64_t slot = 0;
+    size_t read;
+    while ((read = fread(buf.data(), rs, CHUNK, f)) > 0) {
+        for (size_t r = 0; r < read; r++, slot++) {
+            const char *rec = buf.data() + r * rs;
+            int64_t eval;
+            memcpy(&eval, rec, 8);
+            if (eval == 0)
+                continue;
+            double xy[len];
+            memcpy(xy, rec + 16, len * sizeof(double));
+            const double *y = xy + dim;
+            double violation = 0;
+            for (int i = nobj; i < ny; i++)
+                violation += std::max(0.0, y[i]);
+            if (violation > 0) {
+                byViolation.offer(violation, slot, xy, len);
+                continue;
+            }
+            double sum = 0;
+            for (int i = 0; i < nobj; i++)
+                sum += y[i];
+            bySum.offer(sum, slot, xy, len);
+            for (int i = 0; i < (int) byObj.size(); i++)
+                byObj[i].offer(y[i], slot, xy, len);
+        }
+    }
+    fclose(f);
+    std::vector<candidate> cands = bySum.values();
+    for (best_keeper &b : byObj)
+        for (candidate &c : b.values()) {
+            c.key = 0;
+            for (int i = 0; i < nobj; i++)
+                c.key += c.xy[dim + i];
+            cands.push_back(c);
+        }
+    std::sort(cands.begin(), cands.end(),
+            [](const candidate &a, const candidate &b) {
+                return a.slot < b.slot;
+            });
+    cands.erase(std::unique(cands.begin(), cands.end(),
+            [](const candidate &a, const candidate &b) {
+                return a.slot == b.slot;
+            }), cands.end());
+    std::vector<candidate> sel;
+    if (nobj == 1) {
+        std::sort(cands.begin(), cands.end(), lessKey);
+        for (size_t i = 0; i < cands.size() && (int) sel.size() < n; i++)
+            sel.push_back(cands[i]);
+    } else
+        selectFronts(cands, dim, nobj, n, sel);
+    std::vector<candidate> &infeasible = byViolation.values();
+    std::sort(infeasible.begin(), infeasible.end(), lessKey);
+    for (size_t i = 0; i < infeasible.size() && (int) sel.size() < n; i++)
+        sel.push_back(infeasible[i]);
+    for (size_t p = 0; p < sel.size(); p++) {
+        memcpy(xs + p * dim, sel[p].xy.data(), dim * sizeof(double));
+        memcpy(ys + p * ny, sel[p].xy.data() + dim, ny * sizeof(double));
+    }
+    return (int) sel.size();
+}
+}
@@ -0,0 +1,730 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// Benchmark of the optimizer overhead independent from Python and from the
+// cost of the objective function. All engines of acmalib are executed on
+// native, cheap objectives of testfun.h for a grid of dimensions and
+// population sizes. For each case the following is reported:
+//
+// ns_per_ask, ns_per_tell: time spent in ask / tell per generation. Engines
+// only available as optimize call (GCL-DE, LCL-DE, LDE, BiteOpt, CSMA, DA)
+// leave these empty.
+// ns_per_generation: overall time per generation including the objective.
+// allocs_per_generation, bytes_per_generation: heap allocations per
+// generation, counted by wrapping malloc (glibc only).
+// peak_rss_kb: peak resident set size of the case (Linux only, process wide
+// maximum if the peak cannot be reset).
+//
+// Usage: fcmaes_bench [--format csv|json] [--engines acma,de,...]
+//        [--dims 2,10,...] [--popsizes 8,32,...] [--seconds 0.2]
+//        [--objective sphere|rosen|rastrigin|ackley|noise]
+//        [--max-matrix-dim 1000] [--max-cells 16777216] [--output file]
+//
+// Column and engine names are stable, results of different versions can be
+// compared directly. Cases exceeding the limits are reported with status
+// "skipped".
+
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "testfun.h"
+
+typedef bool (*callback_type)(int, const double*, double*);
+typedef void (*callback_parallel)(int, int, double*, double*);
+
+extern "C" {
+
+uintptr_t initACMA_C(long runid, int dim, double *init, double *lower,
+        double *upper, double *sigma, int maxEvals, double stopfitness,
+        double stopTolHistFun, int mu, int popsize, double accuracy, long seed,
+        bool normalize, bool use_delayed_update, int update_gap);
+void destroyACMA_C(uintptr_t ptr);
+void askACMA_C(uintptr_t ptr, double *xs);
+int tellACMA_C(uintptr_t ptr, double *ys);
+
+uintptr_t initCRFMNES_C(int64_t runid, int dim, double *init, double *lower,
+        double *upper, double sigma, int popsize, int64_t seed,
+        double penalty_coef, bool use_constraint_violation, bool normalize);
+void destroyCRFMNES_C(uintptr_t ptr);
+void askCRFMNES_C(uintptr_t ptr, double *xs);
+int tellCRFMNES_C(uintptr_t ptr, double *ys);
+
+uintptr_t initPGPE_C(int64_t runid, int dim, double *init, double *lower,
+        double *upper, double *sigma, int popsize, int64_t seed,
+        int lr_decay_steps, bool use_ranking, double center_learning_rate,
+        double stdev_learning_rate, double stdev_max_change, double b1,
+        double b2, double eps, double decay_coef, bool normalize);
+void destroyPGPE_C(uintptr_t ptr);
+void askPGPE_C(uintptr_t ptr, double *xs);
+int tellPGPE_C(uintptr_t ptr, double *ys);
+
+uintptr_t initDE_C(long runid, int dim, int seed, double *lower, double *upper,
+        double *init, double *sigma, double minSigma, bool *ints, double keep,
+        int popsize, double F, double CR, double min_mutate, double max_mutate);
+void destroyDE_C(uintptr_t ptr);
+void askDE_C(uintptr_t ptr, double *xs);
+int tellDE_C(uintptr_t ptr, double *ys);
+
+uintptr_t initMODE_C(int64_t runid, int dim, int nobj, int ncon, int seed,
+        double *lower, double *upper, bool *ints, int maxEvals, int popsize,
+        double F, double CR, double pro_c, double dis_c, double pro_m,
+        double dis_m, bool nsga_update, double pareto_update,
+        double min_mutate, double max_mutate);
+void destroyMODE_C(uintptr_t ptr);
+void askMODE_C(uintptr_t ptr, double *xs);
+int tellMODE_C(uintptr_t ptr, double *ys);
+
+void optimizeGCLDE_C(long runid, callback_parallel func_par, int dim, int seed,
+        double *lower, double *upper, int maxEvals, double pbest,
+        double stopfitness, int popsize, double F0, double CR0, double *res);
+void optimizeLCLDE_C(long runid, callback_parallel func_par, int dim,
+        double *init, double *sigma, int seed, double *lower, double *upper,
+        int maxEvals, double pbest, double stopfitness, int popsize, double F0,
+        double CR0, double *res);
+void optimizeLDE_C(long runid, callback_type func, int dim, double *init,
+        double *sigma, int seed, double *lower, double *upper, int maxEvals,
+        double keep, double stopfitness, int popsize, double F, double CR,
+        double min_mutate, double max_mutate, bool *ints, double *res);
+void optimizeBite_C(long runid, callback_type func, int dim, int seed,
+        double *init, double *lower, double *upper, int maxEvals,
+        double stopfitness, int M, int popsize, int stall_iterations,
+        double *res);
+void optimizeCsma_C(long runid, callback_type func, int dim, int seed,
+        double *init, double *lower, double *upper, double *sigma,
+        int maxEvals, double stopfitness, int popsize, double *res);
+void optimizeDA_C(long runid, callback_type func, int dim, int seed,
+        double *init, double *lower, double *upper, int maxEvals,
+        bool use_local_search, double *res);
+const char* kernelISA_C();
+}
+
+// allocation counting
+
+static std::atomic<bool> count_allocs(false);
+static std::atomic<long long> alloc_count(0);
+static std::atomic<long long> alloc_bytes(0);
+
+#ifdef __GLIBC__
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+
+// overrides the allocator of the whole process including acmalib.
+void* malloc(size_t size) {
+    if (count_allocs.load(std::memory_order_relaxed)) {
+        alloc_count++;
+        alloc_bytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    if (count_allocs.load(std::memory_order_relaxed)) {
+        alloc_count++;
+        alloc_bytes += n * size;
+    }
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void *p, size_t size) {
+    if (count_allocs.load(std::memory_order_relaxed)) {
+        alloc_count++;
+        alloc_bytes += size;
+    }
+    return __libc_realloc(p, size);
+}
+
+void free(void *p) {
+    __libc_free(p);
+}
+}
+
+static bool allocs_supported() {
+    return true;
+}
+
+#else
+
+static bool allocs_supported() {
+    return false;
+}
+
+#endif
+
+// peak resident set size
+
+static void reset_peak_rss() {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (f != NULL) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+
+static long peak_rss_kb() {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f != NULL) {
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof(line), f) != NULL)
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                kb = atol(line + 6);
+                break;
+            }
+        fclose(f);
+        if (kb >= 0)
+            return kb;
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;
+    return -1;
+}
+
+// objectives
+
+static std::string objective = "sphere";
+
+static double (*objective_fun)(int, const double*) = testfun::sphere;
+
+static inline double shifted_sphere(int dim, const double *x) {
+    double y = 0;
+    for (int i = 0; i < dim; i++)
+        y += (x[i] - 1) * (x[i] - 1);
+    return y;
+}
+
+// deterministic pseudo random value of x, avoids convergence so that the
+// engines keep their steady state.
+static double noise(int dim, const double *x) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < dim; i++) {
+        uint64_t b;
+        memcpy(&b, x + i, sizeof(b));
+        h = (h ^ b) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool set_objective(const std::string &name) {
+    if (name == "sphere")
+        objective_fun = testfun::sphere;
+    else if (name == "rosen")
+        objective_fun = testfun::rosen;
+    else if (name == "rastrigin")
+        objective_fun = testfun::rastrigin;
+    else if (name == "ackley")
+        objective_fun = testfun::ackley;
+    else if (name == "noise")
+        objective_fun = noise;
+    else
+        return false;
+    objective = name;
+    return true;
+}
+
+static inline double value(int dim, const double *x) {
+    return objective_fun(dim, x);
+}
+
+static bool fitness(int dim, const double *x, double *y) {
+    y[0] = value(dim, x);
+    return false;
+}
+
+static void fitness_par(int popsize, int dim, double *xs, double *ys) {
+    for (int p = 0; p < popsize; p++)
+        ys[p] = value(dim, xs + p * dim);
+}
+
+static void fitness_mo(int popsize, int dim, const double *xs, double *ys) {
+    for (int p = 0; p < popsize; p++) {
+        const double *x = xs + p * dim;
+        ys[2 * p] = value(dim, x);
+        ys[2 * p + 1] = objective == "sphere" ? shifted_sphere(dim, x) :
+                value(dim - 1, x + 1);
+    }
+}
+
+// benchmark cases
+
+struct result {
+    std::string engine;
+    int dim;
+    int popsize;
+    long long generations;
+    long long evaluations;
+    double ns_ask; // < 0 means not available
+    double ns_tell;
+    double ns_generation;
+    double allocs_generation;
+    double bytes_generation;
+    long peak_rss_kb;
+    std::string status;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ns(bench_clock::time_point t0, bench_clock::time_point t1) {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            t1 - t0).count();
+}
+
+struct engine {
+    const char *name;
+    bool ask_tell;
+    bool full_matrix; // stores dim x dim matrices
+    bool uses_popsize;
+};
+
+static const engine engines[] = {
+        { "acma", true, true, true },
+        { "crfmnes", true, false, true },
+        { "pgpe", true, false, true },
+        { "de", true, false, true },
+        { "mode", true, false, true },
+        { "gclde", false, false, true },
+        { "lclde", false, false, true },
+        { "lde", false, false, true },
+        { "bite", false, false, true },
+        { "csma", false, false, true },
+        { "da", false, false, false } };
+
+static const int num_engines = sizeof(engines) / sizeof(engines[0]);
+
+struct problem {
+    int dim;
+    std::vector<double> lower;
+    std::vector<double> upper;
+    std::vector<double> init;
+    std::vector<double> sigma;
+    bool *ints;
+
+    problem(int dim_) :
+            dim(dim_), lower(dim_, -5), upper(dim_, 5), init(dim_, 1), sigma(
+                    dim_, 0.3) {
+        ints = new bool[dim];
+        for (int i = 0; i < dim; i++)
+            ints[i] = false;
+    }
+
+    ~problem() {
+        delete[] ints;
+    }
+};
+
+static uintptr_t init_engine(const std::string &name, problem &pb, int popsize,
+        long seed) {
+    int dim = pb.dim;
+    if (name == "acma")
+        return initACMA_C(0, dim, pb.init.data(), pb.lower.data(),
+                pb.upper.data(), pb.sigma.data(), INT_MAX, -DBL_MAX, -1,
+                popsize / 2, popsize, 1.0, seed, true, true, -1);
+    if (name == "crfmnes")
+        return initCRFMNES_C(0, dim, pb.init.data(), pb.lower.data(),
+                pb.upper.data(), 0.3, popsize, seed, 1E5, true, false);
+    if (name == "pgpe")
+        return initPGPE_C(0, dim, pb.init.data(), pb.lower.data(),
+                pb.upper.data(), pb.sigma.data(), popsize, seed, 1000, false,
+                0.15, 0.1, 0.2, 0.9, 0.999, 1E-8, 1.0, true);
+    if (name == "de")
+        return initDE_C(0, dim, (int) seed, pb.lower.data(), pb.upper.data(),
+                pb.init.data(), pb.sigma.data(), 0, pb.ints, 200, popsize, 0.5,
+                0.9, 0.1, 0.5);
+    if (name == "mode")
+        return initMODE_C(0, dim, 2, 0, (int) seed, pb.lower.data(),
+                pb.upper.data(), pb.ints, INT_MAX, popsize, 0.5, 0.9, 1.0, 20.0,
+                1.0, 20.0, true, 0, 0.1, 0.5);
+    return 0;
+}
+
+static void destroy_engine(const std::string &name, uintptr_t ptr) {
+    if (name == "acma")
+        destroyACMA_C(ptr);
+    else if (name == "crfmnes")
+        destroyCRFMNES_C(ptr);
+    else if (name == "pgpe")
+        destroyPGPE_C(ptr);
+    else if (name == "de")
+        destroyDE_C(ptr);
+    else if (name == "mode")
+        destroyMODE_C(ptr);
+}
+
+static void ask_engine(const std::string &name, uintptr_t ptr, double *xs) {
+    if (name == "acma")
+        askACMA_C(ptr, xs);
+    else if (name == "crfmnes")
+        askCRFMNES_C(ptr, xs);
+    else if (name == "pgpe")
+        askPGPE_C(ptr, xs);
+    else if (name == "de")
+        askDE_C(ptr, xs);
+    else if (name == "mode")
+        askMODE_C(ptr, xs);
+}
+
+static void tell_engine(const std::string &name, uintptr_t ptr, double *ys) {
+    if (name == "acma")
+        tellACMA_C(ptr, ys);
+    else if (name == "crfmnes")
+        tellCRFMNES_C(ptr, ys);
+    else if (name == "pgpe")
+        tellPGPE_C(ptr, ys);
+    else if (name == "de")
+        tellDE_C(ptr, ys);
+    else if (name == "mode")
+        tellMODE_C(ptr, ys);
+}
+
+// runs generations of an ask/tell engine until the time budget is used.
+static void run_ask_tell(const std::string &name, problem &pb, int popsize,
+        double seconds, result &res) {
+    int dim = pb.dim;
+    int nobj = name == "mode" ? 2 : 1;
+    uintptr_t ptr = init_engine(name, pb, popsize, 12345);
+    std::vector<double> xs((size_t) popsize * dim);
+    std::vector<double> ys((size_t) popsize * nobj);
+    // warm up, the first generations may allocate lazily
+    for (int g = 0; g < 2; g++) {
+        ask_engine(name, ptr, xs.data());
+        if (nobj == 1)
+            fitness_par(popsize, dim, xs.data(), ys.data());
+        else
+            fitness_mo(popsize, dim, xs.data(), ys.data());
+        tell_engine(name, ptr, ys.data());
+    }
+    double budget = seconds * 1E9;
+    double ask_ns = 0, tell_ns = 0, total_ns = 0;
+    long long gens = 0;
+    alloc_count = 0;
+    alloc_bytes = 0;
+    count_allocs = true;
+    while (gens < 3 || total_ns < budget) {
+        bench_clock::time_point t0 = bench_clock::now();
+        ask_engine(name, ptr, xs.data());
+        bench_clock::time_point t1 = bench_clock::now();
+        if (nobj == 1)
+            fitness_par(popsize, dim, xs.data(), ys.data());
+        else
+            fitness_mo(popsize, dim, xs.data(), ys.data());
+        bench_clock::time_point t2 = bench_clock::now();
+        tell_engine(name, ptr, ys.data());
+        bench_clock::time_point t3 = bench_clock::now();
+        ask_ns += elapsed_ns(t0, t1);
+        tell_ns += elapsed_ns(t2, t3);
+        total_ns += elapsed_ns(t0, t3);
+        gens++;
+    }
+    count_allocs = false;
+    destroy_engine(name, ptr);
+    res.generations = gens;
+    res.evaluations = gens * popsize;
+    res.ns_ask = ask_ns / gens;
+    res.ns_tell = tell_ns / gens;
+    res.ns_generation = total_ns / gens;
+    res.allocs_generation = (double) alloc_count / gens;
+    res.bytes_generation = (double) alloc_bytes / gens;
+}
+
+// executes a complete optimization, returns the number of evaluations.
+static long long optimize_engine(const std::string &name, problem &pb,
+        int popsize, int maxEvals) {
+    int dim = pb.dim;
+    std::vector<double> res(dim + 4, 0);
+    int seed = 12345;
+    if (name == "gclde")
+        optimizeGCLDE_C(0, fitness_par, dim, seed, pb.lower.data(),
+                pb.upper.data(), maxEvals, 0.7, -DBL_MAX, popsize, 0, 0,
+                res.data());
+    else if (name == "lclde")
+        optimizeLCLDE_C(0, fitness_par, dim, pb.init.data(), pb.sigma.data(),
+                seed, pb.lower.data(), pb.upper.data(), maxEvals, 0.7,
+                -DBL_MAX, popsize, 0, 0, res.data());
+    else if (name == "lde")
+        optimizeLDE_C(0, fitness, dim, pb.init.data(), pb.sigma.data(), seed,
+                pb.lower.data(), pb.upper.data(), maxEvals, 200, -DBL_MAX,
+                popsize, 0.5, 0.9, 0.1, 0.5, pb.ints, res.data());
+    else if (name == "bite")
+        optimizeBite_C(0, fitness, dim, seed, pb.init.data(), pb.lower.data(),
+                pb.upper.data(), maxEvals, -DBL_MAX, 1, popsize, 0,
+                res.data());
+    else if (name == "csma")
+        optimizeCsma_C(0, fitness, dim, seed, pb.init.data(), pb.lower.data(),
+                pb.upper.data(), pb.sigma.data(), maxEvals, -DBL_MAX, popsize,
+                res.data());
+    else if (name == "da")
+        optimizeDA_C(0, fitness, dim, seed, pb.init.data(), pb.lower.data(),
+                pb.upper.data(), maxEvals, false, res.data());
+    return (long long) res[dim + 1];
+}
+
+// doubles the evaluation budget of complete optimizations until the time
+// budget is reached, reports the last run. Generations are counted as
+// evaluations / popsize since the engines define iterations differently.
+static void run_optimize(const std::string &name, problem &pb, int popsize,
+        double seconds, result &res) {
+    double budget = seconds * 1E9;
+    long long maxEvals = 4LL * popsize;
+    while (true) {
+        alloc_count = 0;
+        alloc_bytes = 0;
+        count_allocs = true;
+        bench_clock::time_point t0 = bench_clock::now();
+        long long evals = optimize_engine(name, pb, popsize, (int) maxEvals);
+        bench_clock::time_point t1 = bench_clock::now();
+        count_allocs = false;
+        double ns = elapsed_ns(t0, t1);
+        if (ns >= 0.5 * budget || 2 * maxEvals > INT_MAX / 2
+                || evals < maxEvals / 2) {
+            if (evals <= 0)
+                evals = 1;
+            long long gens = std::max(1LL, evals / popsize);
+            res.generations = gens;
+            res.evaluations = evals;
+            res.ns_ask = -1;
+            res.ns_tell = -1;
+            res.ns_generation = ns / gens;
+            res.allocs_generation = (double) alloc_count / gens;
+            res.bytes_generation = (double) alloc_bytes / gens;
+            return;
+        }
+        maxEvals *= 2;
+    }
+}
+
+// command line
+
+struct options {
+    std::string format;
+    std::vector<std::string> engines;
+    std::vector<int> dims;
+    std::vector<int> popsizes;
+    double seconds;
+    int max_matrix_dim;
+    long long max_cells;
+    std::string output;
+
+    options() :
+            format("csv"), seconds(0.2), max_matrix_dim(1000), max_cells(
+                    1LL << 24) {
+        for (int i = 0; i < num_engines; i++)
+            engines.push_back(::engines[i].name);
+        int d[] = { 2, 10, 100, 1000, 10000 };
+        int p[] = { 8, 32, 128, 512, 4096 };
+        dims.assign(d, d + 5);
+        popsizes.assign(p, p + 5);
+    }
+};
+
+static std::vector<std::string> split(const std::string &s) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos)
+            end = s.size();
+        if (end > start)
+            parts.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return parts;
+}
+
+static std::vector<int> split_ints(const std::string &s) {
+    std::vector<int> values;
+    std::vector<std::string> parts = split(s);
+    for (size_t i = 0; i < parts.size(); i++)
+        values.push_back(atoi(parts[i].c_str()));
+    return values;
+}
+
+static const engine* find_engine(const std::string &name) {
+    for (int i = 0; i < num_engines; i++)
+        if (name == engines[i].name)
+            return &engines[i];
+    return NULL;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: fcmaes_bench [--format csv|json] [--engines acma,de,...]\n"
+                    "       [--dims 2,10,...] [--popsizes 8,32,...] [--seconds 0.2]\n"
+                    "       [--objective sphere|rosen|rastrigin|ackley|noise]\n"
+                    "       [--max-matrix-dim 1000] [--max-cells 16777216] [--output file]\n");
+}
+
+static bool parse(int argc, char **argv, options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc)
+            return false;
+        std::string val = argv[++i];
+        if (arg == "--format")
+            opt.format = val;
+        else if (arg == "--engines")
+            opt.engines = split(val);
+        else if (arg == "--dims")
+            opt.dims = split_ints(val);
+        else if (arg == "--popsizes")
+            opt.popsizes = split_ints(val);
+        else if (arg == "--seconds")
+            opt.seconds = atof(val.c_str());
+        else if (arg == "--objective") {
+            if (!set_objective(val))
+                return false;
+        }
+        else if (arg == "--max-matrix-dim")
+            opt.max_matrix_dim = atoi(val.c_str());
+        else if (arg == "--max-cells")
+            opt.max_cells = atoll(val.c_str());
+        else if (arg == "--output")
+            opt.output = val;
+        else
+            return false;
+    }
+    if (opt.format != "csv" && opt.format != "json")
+        return false;
+    for (size_t i = 0; i < opt.engines.size(); i++)
+        if (find_engine(opt.engines[i]) == NULL) {
+            fprintf(stderr, "unknown engine %s\n", opt.engines[i].c_str());
+            return false;
+        }
+    return true;
+}
+
+// output
+
+static void print_number(FILE *out, double v, bool json) {
+    if (v < 0)
+        fputs(json ? "null" : "", out);
+    else
+        fprintf(out, "%.1f", v);
+}
+
+static const char *columns[] = { "engine", "dim", "popsize", "generations",
+        "evaluations", "ns_per_ask", "ns_per_tell", "ns_per_generation",
+        "allocs_per_generation", "bytes_per_generation", "peak_rss_kb",
+        "status" };
+
+static void print_csv_header(FILE *out) {
+    for (int c = 0; c < 12; c++)
+        fprintf(out, c == 0 ? "%s" : ",%s", columns[c]);
+    fputs("\n", out);
+}
+
+static void print_result(FILE *out, const result &r, bool json, bool first) {
+    bool ok = r.status == "ok";
+    bool allocs = ok && allocs_supported();
+    if (json) {
+        fprintf(out, "%s\n    {\"%s\": \"%s\", \"%s\": %d, \"%s\": %d, ",
+                first ? "" : ",", columns[0], r.engine.c_str(), columns[1],
+                r.dim, columns[2], r.popsize);
+        fprintf(out, "\"%s\": %lld, \"%s\": %lld, ", columns[3],
+                ok ? r.generations : 0, columns[4], ok ? r.evaluations : 0);
+    } else
+        fprintf(out, "%s,%d,%d,%lld,%lld,", r.engine.c_str(), r.dim, r.popsize,
+                ok ? r.generations : 0, ok ? r.evaluations : 0);
+    double values[] = { ok ? r.ns_ask : -1, ok ? r.ns_tell : -1,
+            ok ? r.ns_generation : -1, allocs ? r.allocs_generation : -1,
+            allocs ? r.bytes_generation : -1 };
+    for (int c = 0; c < 5; c++) {
+        if (json)
+            fprintf(out, "\"%s\": ", columns[c + 5]);
+        print_number(out, values[c], json);
+        fputs(json ? ", " : ",", out);
+    }
+    long rss = ok ? r.peak_rss_kb : -1;
+    if (json) {
+        if (rss < 0)
+            fprintf(out, "\"%s\": null, ", columns[10]);
+        else
+            fprintf(out, "\"%s\": %ld, ", columns[10], rss);
+        fprintf(out, "\"%s\": \"%s\"}", columns[11], r.status.c_str());
+    } else {
+        if (rss >= 0)
+            fprintf(out, "%ld", rss);
+        fprintf(out, ",%s\n", r.status.c_str());
+    }
+    fflush(out);
+}
+
+int main(int argc, char **argv) {
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        usage();
+        return 1;
+    }
+    FILE *out = stdout;
+    if (!opt.output.empty()) {
+        out = fopen(opt.output.c_str(), "w");
+        if (out == NULL) {
+            fprintf(stderr, "cannot write %s\n", opt.output.c_str());
+            return 1;
+        }
+    }
+    bool json = opt.format == "json";
+    if (json)
+        fprintf(out, "{\"benchmark\": \"fcmaes_bench\", \"version\": 1, "
+                "\"isa\": \"%s\", \"objective\": \"%s\", \"seconds\": %g, "
+                "\"results\": [", kernelISA_C(), objective.c_str(),
+                opt.seconds);
+    else
+        print_csv_header(out);
+    bool first = true;
+    for (size_t e = 0; e < opt.engines.size(); e++) {
+        const engine *eng = find_engine(opt.engines[e]);
+        for (size_t d = 0; d < opt.dims.size(); d++) {
+            int dim = opt.dims[d];
+            if (dim < 2)
+                continue;
+            problem pb(dim);
+            for (size_t p = 0; p < opt.popsizes.size(); p++) {
+                // engines without population are measured once per dimension
+                int popsize = eng->uses_popsize ? opt.popsizes[p] : 1;
+                if (!eng->uses_popsize && p > 0)
+                    break;
+                result r;
+                r.engine = eng->name;
+                r.dim = dim;
+                r.popsize = popsize;
+                r.status = "ok";
+                if ((eng->uses_popsize && popsize < 4)
+                        || (long long) dim * popsize > opt.max_cells
+                        || (eng->full_matrix && dim > opt.max_matrix_dim))
+                    r.status = "skipped";
+                if (r.status == "ok") {
+                    reset_peak_rss();
+                    if (eng->ask_tell)
+                        run_ask_tell(eng->name, pb, popsize, opt.seconds, r);
+                    else
+                        run_optimize(eng->name, pb, popsize, opt.seconds, r);
+                    r.peak_rss_kb = peak_rss_kb();
+                }
+                print_result(out, r, json, first);
+                first = false;
+            }
+        }
+    }
+    if (json)
+        fputs("\n]}\n", out);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
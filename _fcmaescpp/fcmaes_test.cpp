@@ -0,0 +1,127 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// Tests of the header only components, independent from Python. Each test
+// prints the failed checks and returns false, fcmaes_test returns 1 if any
+// test fails. Registered with ctest.
+//
+// Usage: fcmaes_test
+
+#include <stdio.h>
+#include <stdint.h>
+#include "philox.h"
+#include "cmaes.h"
+
+// known answer vectors of Philox4x32-10 (Random123 kat_vectors). The
+// counter is composed of block index (words 0, 1) and stream (words 2, 3).
+static bool testPhilox() {
+    static const uint32_t kat[3][10] = {
+            { 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+                    0x00000000, 0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                    0x9b00dbd8 },
+            { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+                    0xffffffff, 0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                    0x6d5451fd },
+            { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822,
+                    0x299f31d0, 0xd16cfe09, 0x94fdcceb, 0x5001e420,
+                    0x24126ea1 } };
+    bool ok = true;
+    for (int t = 0; t < 3; t++) {
+        const uint32_t *v = kat[t];
+        uint64_t index = v[0] | ((uint64_t) v[1] << 32);
+        uint64_t stream = v[2] | ((uint64_t) v[3] << 32);
+        uint64_t key = v[4] | ((uint64_t) v[5] << 32);
+        uint32_t out[4];
+        philox::block(key, index, stream, out);
+        for (int i = 0; i < 4; i++) {
+            if (out[i] != v[6 + i]) {
+                printf("philox vector %d word %d: %08x expected %08x\n", t, i,
+                        out[i], v[6 + i]);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+typedef fcmaes::Cmaes<4, 12> Cmaes4;
+
+static double rosen(const Cmaes4::Vec &x) {
+    double y = 0;
+    for (int i = 0; i < 3; i++)
+        y += 100 * (x(i + 1) - x(i) * x(i)) * (x(i + 1) - x(i) * x(i))
+                + (1 - x(i)) * (1 - x(i));
+    return y;
+}
+
+// the header only CMA-ES: solves Rosenbrock, respects the bounds and the
+// evaluation budget, ask / tell and optimize produce the same result.
+static bool testCmaes() {
+    bool ok = true;
+    Cmaes4::Vec guess = Cmaes4::Vec::Zero();
+    Cmaes4::Vec sigma = Cmaes4::Vec::Constant(0.3);
+    Cmaes4::Vec lower = Cmaes4::Vec::Constant(-5);
+    Cmaes4::Vec upper = Cmaes4::Vec::Constant(5);
+    Cmaes4 es(guess, sigma, lower, upper, 20000, 42);
+    int evals = es.optimize(rosen);
+    if (!(es.bestValue() < 1E-8)
+            || !(es.bestX() - Cmaes4::Vec::Ones()).isZero(1E-3)) {
+        printf("cmaes rosen: %g\n", es.bestValue());
+        ok = false;
+    }
+    if (evals > 20000 || evals != es.evaluations()) {
+        printf("cmaes evaluations: %d\n", evals);
+        ok = false;
+    }
+    // the optimum of the shifted sphere lies outside, at the upper bound
+    upper = Cmaes4::Vec::Constant(1);
+    Cmaes4 bounded(guess, sigma, lower, upper, 5000, 42);
+    Cmaes4::Fit ys;
+    bool inside = true;
+    while (bounded.stop() == 0 && bounded.evaluations() < 5000) {
+        const Cmaes4::Pop &xs = bounded.ask();
+        for (int k = 0; k < 12; k++) {
+            inside &= (xs.col(k).array() >= lower.array()).all()
+                    && (xs.col(k).array() <= upper.array()).all();
+            ys(k) = (xs.col(k).array() - 2).matrix().squaredNorm();
+        }
+        bounded.tell(ys);
+    }
+    if (!inside || !(bounded.bestX() - upper).isZero(1E-3)) {
+        printf("cmaes bounds: %g\n", bounded.bestValue());
+        ok = false;
+    }
+    Cmaes4 asked(guess, sigma, Cmaes4::Vec::Constant(-5), upper, 2000, 7);
+    Cmaes4 optimized(guess, sigma, Cmaes4::Vec::Constant(-5), upper, 2000, 7);
+    while (asked.evaluations() < 2000 && asked.stop() == 0) {
+        const Cmaes4::Pop &xs = asked.ask();
+        for (int k = 0; k < 12; k++)
+            ys(k) = rosen(xs.col(k));
+        asked.tell(ys);
+    }
+    optimized.optimize(rosen);
+    if (asked.bestValue() != optimized.bestValue()
+            || asked.evaluations() != optimized.evaluations()) {
+        printf("cmaes ask/tell: %g, optimize: %g\n", asked.bestValue(),
+                optimized.bestValue());
+        ok = false;
+    }
+    return ok;
+}
+
+int main() {
+    struct {
+        const char *name;
+        bool (*run)();
+    } tests[] = { { "philox", testPhilox }, { "cmaes", testCmaes } };
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        bool ok = tests[i].run();
+        printf("%s %s\n", tests[i].name, ok ? "ok" : "FAILED");
+        if (!ok)
+            failed++;
+    }
+    return failed > 0 ? 1 : 0;
+}
@@ -12,8 +12,6 @@
 #include <float.h>
 #include <ctime>
 #include <random>
-#define EIGEN_VECTORIZE_SSE2
-#include <EigenRand/EigenRand>
 #include "evaluator.h"
 
 using namespace std;
@@ -49,20 +47,16 @@ public:
         CR0 = CR0_;
         // stop criteria
         stop = 0;
-        rs = new Eigen::Rand::P8_mt19937_64(seed_);
+        rs = philox(seed_);
         init();
     }
 
-    ~GclDeOptimizer() {
-        delete rs;
-    }
-
     double rnd01() {
-        return distr_01(*rs);
+        return rs.uniform();
     }
 
     int rndInt(int max) {
-        return (int) (max * distr_01(*rs));
+        return (int) (max * rs.uniform());
     }
 
     void doOptimize() {
@@ -113,12 +107,12 @@ public:
                         - sqrt(float(iterations / maxIter))
                                 * exp(float(-gen_stuck / iterations));
                 if (iterations % 2 == 1) {
-                    CR = normreal(*rs, 0.95, 0.01);
-                    F = normreal(*rs, mu, 1);
+                    CR = normreal(rs, 0.95, 0.01);
+                    F = normreal(rs, mu, 1);
                     if (F < 0 || F > 1)
                         F = rnd01();
                 } else {
-                    CR = abs(normreal(*rs, CR0, 0.01));
+                    CR = abs(normreal(rs, CR0, 0.01));
                     F = F0;
                 }
                 vec ui = popX.col(p);
@@ -131,7 +125,7 @@ public:
                             ui[j] = popX(j, r1)
                                     + F * ((popX)(j, r2) - sp[r3 - popsize][j]);
                         if (!fitfun->feasible(j, ui[j]))
-                            ui[j] = fitfun->sample_i(j, *rs);
+                            ui[j] = fitfun->sample_i(j, rs);
                     }
                 }
                 nextX.col(p) = ui;
@@ -156,7 +150,7 @@ public:
         popF = zeros(popsize);
         nextX = mat(dim, popsize);
         for (int p = 0; p < popsize; p++)
-            nextX.col(p) = fitfun->sample(*rs);
+            nextX.col(p) = fitfun->sample(rs);
         nextY = vec(popsize);
         fitfun->values(nextX, nextY);
     }
@@ -191,7 +185,7 @@ private:
     int stop;
     double F0;
     double CR0;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox rs;
     mat popX;
     vec popY;
     mat nextX;
@@ -221,6 +215,7 @@ void optimizeGCLDE_C(long runid, callback_parallel func_par, int dim,
         upper_limit.resize(0);
     }
     Fitness fitfun(noop_callback, func_par, n, 1, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     GclDeOptimizer opt(runid, &fitfun, dim, seed, popsize, maxEvals, pbest,
             stopfitness, F0, CR0);
     try {
@@ -0,0 +1,515 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// Native implementation of the ESA GTOP trajectory benchmark problems used by
+// fcmaes/astro.py, see https://www.esa.int/gsp/ACT/projects/gtop/
+// Based on the kep_toolbox (https://github.com/esa/pykep) lagrangian
+// propagation and JPL low precision ephemerides, Lambert problems are solved
+// by the batch solver in lambert.h. Since these
+// ephemerides differ from the ones of the original GTOP code, objective
+// values of the same decision vector deviate from the GTOP reference values.
+// Therefore the objectives are exported with the suffix Lp (low precision),
+// fooC stays reserved for the GTOP reference implementation.
+//
+// Two problem types are supported:
+// MGA: multiple gravity assist with powered swing-bys, decision vector
+// [t0, T1, ..., Tn-1], used by cassini1 and gtoc1.
+// MGA-1DSM: multiple gravity assist with one deep space maneuver per leg,
+// decision vector [t0, Vinf, u, v, T1..Tn-1, eta1..etan-1, rp1.., gamma1..],
+// used by cassini2, messenger full, rosetta and sagas.
+//
+// Each objective is exported as double fooLpC(int dim, double* x) and as batch
+// variant void fooLpBatchC(int popsize, int dim, double* xs, double* ys)
+// (callback_parallel) evaluating a population on the shared thread pool.
+
+#include <math.h>
+#include <array>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include "parallel.h"
+#include "lambert.h"
+#include "keplerian_toolbox/astro_constants.hpp"
+#include "keplerian_toolbox/epoch.hpp"
+#include "keplerian_toolbox/core_functions/propagate_lagrangian.hpp"
+#include "keplerian_toolbox/core_functions/fb_prop.hpp"
+#include "keplerian_toolbox/planet/jpl_low_precision.hpp"
+#include "keplerian_toolbox/planet/keplerian.hpp"
+
+namespace gtop {
+
+typedef kep_toolbox::array3D vec3;
+
+// body ids as used by GTOP
+enum {
+    MERCURY = 1, VENUS, EARTH, MARS, JUPITER, SATURN, GTOC1_ASTEROID = 10, COMET_67P
+};
+
+static const double MU_SUN = ASTRO_MU_SUN;
+static const double AU = ASTRO_AU;
+static const double DAY = ASTRO_DAY2SEC;
+static const double DEG = ASTRO_DEG2RAD;
+static const double G0 = 9.80665;
+
+// returned for invalid arguments or failing kep_toolbox calls
+static const double INVALID = 1E10;
+
+static double dot(const vec3 &a, const vec3 &b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static double norm(const vec3 &a) {
+    return sqrt(dot(a, a));
+}
+
+static vec3 diff(const vec3 &a, const vec3 &b) {
+    vec3 d = { { a[0] - b[0], a[1] - b[1], a[2] - b[2] } };
+    return d;
+}
+
+static vec3 cross(const vec3 &a, const vec3 &b) {
+    vec3 c = { { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+            a[0] * b[1] - a[1] * b[0] } };
+    return c;
+}
+
+static vec3 unit(const vec3 &a) {
+    double n = norm(a);
+    vec3 u = { { a[0] / n, a[1] / n, a[2] / n } };
+    return u;
+}
+
+// solar system bodies, created once, used read only by all threads.
+class Bodies {
+
+public:
+
+    Bodies() {
+        const char *names[] = { "mercury", "venus", "earth", "mars",
+                "jupiter", "saturn" };
+        _bodies.resize(COMET_67P + 1);
+        for (int i = MERCURY; i <= SATURN; i++)
+            _bodies[i].reset(new kep_toolbox::planet::jpl_lp(names[i - 1]));
+        // asteroid 2001 TW229, see GTOC1 problem description
+        kep_toolbox::array6D tw229 = { { 2.5897261 * AU, 0.2734625,
+                6.40734 * DEG, 128.34711 * DEG, 264.78691 * DEG,
+                320.479555 * DEG } };
+        _bodies[GTOC1_ASTEROID].reset(new kep_toolbox::planet::keplerian(
+                kep_toolbox::epoch(53600, kep_toolbox::epoch::MJD), tw229,
+                MU_SUN, 0, 0, 0, "TW229"));
+        // comet 67P/Churyumov-Gerasimenko, target of rosetta
+        kep_toolbox::array6D c67p = { { 3.50294972836275 * AU, 0.6319356,
+                7.12723 * DEG, 50.92302 * DEG, 11.36788 * DEG, 0 } };
+        _bodies[COMET_67P].reset(new kep_toolbox::planet::keplerian(
+                kep_toolbox::epoch(52504.23754000012, kep_toolbox::epoch::MJD),
+                c67p, MU_SUN, 0, 0, 0, "67P"));
+    }
+
+    void eph(int id, double mjd2000, vec3 &r, vec3 &v) const {
+        _bodies[id]->eph(kep_toolbox::epoch(mjd2000), r, v);
+    }
+
+    double mu(int id) const {
+        return _bodies[id]->get_mu_self();
+    }
+
+    double radius(int id) const {
+        return _bodies[id]->get_radius();
+    }
+
+    static const Bodies& instance() {
+        static Bodies bodies;
+        return bodies;
+    }
+
+private:
+    std::vector<std::unique_ptr<kep_toolbox::planet::base>> _bodies;
+};
+
+// prograde single revolution lambert arc from r1 to r2, returns false if
+// there is no solution.
+static bool lambert(const vec3 &r1, const vec3 &r2, double tof, vec3 &v1,
+        vec3 &v2) {
+    int revs = 0;
+    return lambert::solveBatch(1, r1.data(), r2.data(), &tof, &MU_SUN, &revs,
+            v1.data(), v2.data()) == 0;
+}
+
+// powered swing-by: periapsis radius rp and periapsis maneuver needed to turn
+// the incoming relative velocity of size vin by the angle alpha into the
+// outgoing relative velocity of size vout. Returns the maneuver size.
+static double powSwingByInv(double vin, double vout, double alpha, double mu,
+        double &rp) {
+    // turning angle for given rp minus alpha, decreasing in rp
+    auto g = [&](double r) {
+        return asin(mu / (mu + r * vin * vin))
+                + asin(mu / (mu + r * vout * vout)) - alpha;
+    };
+    if (alpha <= 0) {
+        rp = HUGE_VAL;
+        return fabs(vout - vin);
+    }
+    double lo = 0;
+    double hi = mu / (vin * vin);
+    while (g(hi) > 0)
+        hi *= 2;
+    rp = hi;
+    for (int i = 0; i < 60; i++) {
+        double ein = 1 + rp * vin * vin / mu;
+        double eout = 1 + rp * vout * vout / mu;
+        double dg = -vin * vin / mu / (ein * sqrt(ein * ein - 1))
+                - vout * vout / mu / (eout * sqrt(eout * eout - 1));
+        double gr = g(rp);
+        if (gr > 0)
+            lo = rp;
+        else
+            hi = rp;
+        double next = rp - gr / dg;
+        if (!(next > lo && next < hi)) // keep Newton inside the bracket
+            next = 0.5 * (lo + hi);
+        if (fabs(next - rp) <= 1E-12 * rp) {
+            rp = next;
+            break;
+        }
+        rp = next;
+    }
+    return fabs(sqrt(vout * vout + 2 * mu / rp) - sqrt(vin * vin + 2 * mu / rp));
+}
+
+// maneuver at periapsis rp inserting into an orbit with eccentricity e from
+// a hyperbola with excess velocity vinf.
+static double insertion(double vinf, double mu, double rp, double e) {
+    return fabs(sqrt(vinf * vinf + 2 * mu / rp) - sqrt(mu * (1 + e) / rp));
+}
+
+struct MgaResult {
+    std::vector<double> dv; // launch, swing-by maneuvers including penalties
+    vec3 vrel; // arrival velocity relative to the target
+    vec3 vtarget; // target velocity at arrival
+};
+
+// MGA trajectory along seq (n bodies), x = [t0, T1, ..., Tn-1] (days).
+// Swing-bys below rpmin (km) are penalized by 0.01 km/s per km. Velocities
+// in the result are in m/s.
+static bool mga(const double *x, const int *seq, int n, const double *rpmin,
+        MgaResult &res) {
+    const Bodies &bodies = Bodies::instance();
+    std::vector<vec3> r(n), v(n), v1(n - 1), v2(n - 1);
+    double t = x[0];
+    for (int i = 0; i < n; i++) {
+        if (i > 0)
+            t += x[i];
+        bodies.eph(seq[i], t, r[i], v[i]);
+    }
+    // all legs are solved together
+    std::vector<double> tof(n - 1, 0), mu(n - 1, MU_SUN);
+    std::vector<int> revs(n - 1, 0);
+    for (int i = 0; i < n - 1; i++)
+        tof[i] = x[i + 1] * DAY;
+    if (lambert::solveBatch(n - 1, r[0].data(), r[1].data(), tof.data(),
+            mu.data(), revs.data(), v1[0].data(), v2[0].data()) > 0)
+        return false;
+    res.dv.resize(n - 1);
+    res.dv[0] = norm(diff(v1[0], v[0]));
+    for (int i = 1; i < n - 1; i++) {
+        vec3 vin = diff(v2[i - 1], v[i]);
+        vec3 vout = diff(v1[i], v[i]);
+        double nin = norm(vin);
+        double nout = norm(vout);
+        double alpha = acos(std::max(-1.0, std::min(1.0,
+                dot(vin, vout) / (nin * nout))));
+        double rp;
+        double mu = bodies.mu(seq[i]);
+        res.dv[i] = powSwingByInv(nin, nout, alpha, mu, rp);
+        double rpkm = rp / 1000;
+        if (rpkm < rpmin[i - 1])
+            res.dv[i] += 0.01 * (rpmin[i - 1] - rpkm) * 1000;
+    }
+    res.vrel = diff(v2[n - 2], v[n - 1]);
+    res.vtarget = v[n - 1];
+    return true;
+}
+
+struct DsmResult {
+    double dsm; // sum of deep space maneuvers
+    vec3 r; // final position
+    vec3 v; // final spacecraft velocity, after the last swing-by if any
+    vec3 vtarget; // target velocity at arrival
+};
+
+// MGA-1DSM trajectory along seq (n bodies), velocity formulation.
+// x = [t0, Vinf (km/s), u, v, T1..Tn-1 (days), eta1..etan-1,
+// rp1..rpm (body radii), gamma1..gammam], swing-bys at the bodies 1..m.
+// If m = n-1 there is a final unpowered swing-by at the target.
+// Velocities in the result are in m/s.
+static bool mgaDsm(const double *x, const int *seq, int n, int m,
+        DsmResult &res) {
+    const Bodies &bodies = Bodies::instance();
+    const double *T = x + 4;
+    const double *eta = T + n - 1;
+    const double *rp = eta + n - 1;
+    const double *gamma = rp + m;
+    vec3 r, v, vpl;
+    double t = x[0];
+    bodies.eph(seq[0], t, r, vpl);
+    // launch excess velocity, direction given by u, v relative to the frame
+    // spanned by the planets velocity i and orbital angular momentum k
+    double theta = 2 * M_PI * x[2];
+    double phi = acos(2 * x[3] - 1) - M_PI / 2;
+    double vinf = x[1] * 1000;
+    vec3 i = unit(vpl);
+    vec3 k = unit(cross(r, vpl));
+    vec3 j = cross(k, i);
+    double a = vinf * cos(theta) * cos(phi);
+    double b = vinf * sin(theta) * cos(phi);
+    double c = vinf * sin(phi);
+    for (int d = 0; d < 3; d++)
+        v[d] = vpl[d] + a * i[d] + b * j[d] + c * k[d];
+    res.dsm = 0;
+    for (int i = 0; i < n - 1; i++) {
+        if (i > 0) { // unpowered swing-by at body i
+            vec3 vout;
+            kep_toolbox::fb_prop(vout, v, vpl, rp[i - 1] * bodies.radius(seq[i]),
+                    gamma[i - 1], bodies.mu(seq[i]));
+            v = vout;
+        }
+        // coast to the deep space maneuver, lambert arc to the next body
+        kep_toolbox::propagate_lagrangian(r, v, eta[i] * T[i] * DAY, MU_SUN);
+        t += T[i];
+        vec3 rn, vn, v1, v2;
+        bodies.eph(seq[i + 1], t, rn, vn);
+        if (!lambert(r, rn, (1 - eta[i]) * T[i] * DAY, v1, v2))
+            return false;
+        res.dsm += norm(diff(v1, v));
+        r = rn;
+        v = v2;
+        vpl = vn;
+    }
+    res.vtarget = vpl;
+    if (m == n - 1) { // final swing-by
+        vec3 vout;
+        kep_toolbox::fb_prop(vout, v, vpl, rp[m - 1] * bodies.radius(seq[n - 1]),
+                gamma[m - 1], bodies.mu(seq[n - 1]));
+        v = vout;
+    }
+    res.r = r;
+    res.v = v;
+    return true;
+}
+
+// time to reach distance rmax coasting from (r, v), infinite if the orbit
+// stays inside.
+static double timeTo(const vec3 &r, const vec3 &v, double rmax, double mu) {
+    double R = norm(r);
+    double energy = 0.5 * dot(v, v) - mu / R;
+    double a = -mu / (2 * energy);
+    vec3 h = cross(r, v);
+    double p = dot(h, h) / mu;
+    double e = sqrt(std::max(0.0, 1 - p / a));
+    if (e < 1 && a * (1 + e) < rmax)
+        return HUGE_VAL;
+    double f0 = acos(std::max(-1.0, std::min(1.0, (p / R - 1) / e)));
+    if (dot(r, v) < 0)
+        f0 = -f0;
+    double f1 = acos(std::max(-1.0, std::min(1.0, (p / rmax - 1) / e)));
+    if (e < 1) {
+        double n = sqrt(mu / (a * a * a));
+        double E0 = 2 * atan(sqrt((1 - e) / (1 + e)) * tan(0.5 * f0));
+        double E1 = 2 * atan(sqrt((1 - e) / (1 + e)) * tan(0.5 * f1));
+        return (E1 - e * sin(E1) - E0 + e * sin(E0)) / n;
+    } else {
+        double n = sqrt(mu / (-a * a * a));
+        double F0 = 2 * atanh(sqrt((e - 1) / (e + 1)) * tan(0.5 * f0));
+        double F1 = 2 * atanh(sqrt((e - 1) / (e + 1)) * tan(0.5 * f1));
+        return (e * sinh(F1) - F1 - e * sinh(F0) + F0) / n;
+    }
+}
+
+// total DV (km/s): launch, swing-by maneuvers, Saturn orbit insertion.
+static double cassini1(const double *x) {
+    static const int seq[] = { EARTH, VENUS, VENUS, EARTH, JUPITER, SATURN };
+    static const double rpmin[] = { 6351.8, 6351.8, 6778.1, 671492 };
+    MgaResult res;
+    if (!mga(x, seq, 6, rpmin, res))
+        return INVALID;
+    double dv = 0;
+    for (double d : res.dv)
+        dv += d;
+    dv += insertion(norm(res.vrel), Bodies::instance().mu(SATURN), 108950E3,
+            0.98);
+    return dv / 1000;
+}
+
+// GTOC1 objective -m_final * |v_rel . v_ast| shifted by 2000000, the launcher
+// provides 2.5 km/s for free.
+static double gtoc1(const double *x) {
+    static const int seq[] = { EARTH, VENUS, EARTH, VENUS, EARTH, JUPITER,
+            SATURN, GTOC1_ASTEROID };
+    static const double rpmin[] = { 6351.8, 6778.1, 6351.8, 6778.1, 600000,
+            70000 };
+    static const double isp = 2500;
+    static const double mass = 1500;
+    MgaResult res;
+    if (!mga(x, seq, 8, rpmin, res))
+        return INVALID;
+    double dv = std::max(0.0, res.dv[0] - 2500);
+    for (int i = 1; i < (int) res.dv.size(); i++)
+        dv += res.dv[i];
+    double mfinal = mass * exp(-dv / (isp * G0));
+    return 2000000 - mfinal * fabs(dot(res.vrel, res.vtarget)) * 1E-6;
+}
+
+// total DV (km/s): launch, deep space maneuvers, rendezvous with Saturn.
+static double cassini2(const double *x) {
+    static const int seq[] = { EARTH, VENUS, VENUS, EARTH, JUPITER, SATURN };
+    DsmResult res;
+    if (!mgaDsm(x, seq, 6, 4, res))
+        return INVALID;
+    return (x[1] * 1000 + res.dsm + norm(diff(res.v, res.vtarget))) / 1000;
+}
+
+// DV (km/s) of the deep space maneuvers and the Mercury orbit insertion.
+static double messengerfull(const double *x) {
+    static const int seq[] = { EARTH, VENUS, VENUS, MERCURY, MERCURY, MERCURY,
+            MERCURY };
+    DsmResult res;
+    if (!mgaDsm(x, seq, 7, 5, res))
+        return INVALID;
+    double dv = res.dsm;
+    dv += insertion(norm(diff(res.v, res.vtarget)),
+            Bodies::instance().mu(MERCURY), 2640E3, 0.704);
+    return dv / 1000;
+}
+
+// DV (km/s) of the deep space maneuvers and the rendezvous with 67P.
+static double rosetta(const double *x) {
+    static const int seq[] = { EARTH, EARTH, MARS, EARTH, EARTH, COMET_67P };
+    DsmResult res;
+    if (!mgaDsm(x, seq, 6, 4, res))
+        return INVALID;
+    return (res.dsm + norm(diff(res.v, res.vtarget))) / 1000;
+}
+
+// time (years) to reach 50 AU after a Jupiter swing-by, the deep space
+// maneuvers may not exceed 1.782 km/s, launch excess velocity and deep space
+// maneuvers together 6.782 km/s. Violations are penalized proportionally so
+// that the feasible region can be found.
+static double sagas(const double *x) {
+    static const int seq[] = { EARTH, EARTH, JUPITER };
+    static const double rmax = 50 * AU;
+    static const double penalty = 1000;
+    DsmResult res;
+    if (!mgaDsm(x, seq, 3, 2, res))
+        return INVALID;
+    double t = timeTo(res.r, res.v, rmax, MU_SUN);
+    double years;
+    if (std::isfinite(t))
+        years = (x[4] + x[5] + t / DAY) / 365.25;
+    else { // orbit stays inside, penalize the missing distance
+        double a = -MU_SUN / (dot(res.v, res.v) - 2 * MU_SUN / norm(res.r));
+        double e = sqrt(std::max(0.0,
+                1 - dot(cross(res.r, res.v), cross(res.r, res.v)) / (MU_SUN * a)));
+        years = penalty * (1 + (rmax - a * (1 + e)) / AU);
+    }
+    if (res.dsm > 1782)
+        years += penalty * (res.dsm - 1782) / 1000;
+    double dv = x[1] * 1000 + res.dsm;
+    if (dv > 6782)
+        years += penalty * (dv - 6782) / 1000;
+    return years;
+}
+
+// evaluates a population, catches kep_toolbox exceptions.
+template<class Fun>
+static void evalBatch(Fun fun, int popsize, int dim, const double *xs,
+        double *ys) {
+    thread_pool::instance().parallel_for(popsize, 0, [&](int p) {
+        ys[p] = INVALID;
+        try {
+            ys[p] = fun(xs + p * dim);
+        } catch (std::exception &e) {
+        }
+    });
+}
+
+template<class Fun>
+static double eval(Fun fun, const double *x) {
+    try {
+        return fun(x);
+    } catch (std::exception &e) {
+        return INVALID;
+    }
+}
+}
+
+using namespace gtop;
+
+extern "C" {
+
+double cassini1LpC(int dim, double *x) {
+    return eval(cassini1, x);
+}
+
+double gtoc1LpC(int dim, double *x) {
+    return eval(gtoc1, x);
+}
+
+double cassini2LpC(int dim, double *x) {
+    return eval(cassini2, x);
+}
+
+double messengerfullLpC(int dim, double *x) {
+    return eval(messengerfull, x);
+}
+
+double rosettaLpC(int dim, double *x) {
+    return eval(rosetta, x);
+}
+
+double sagasLpC(int dim, double *x) {
+    return eval(sagas, x);
+}
+
+// Solves n Lambert problems, see lambert::solveBatch, using at most workers
+// threads (<= 0: all cores). r1, r2, v1, v2 hold n 3-dimensional vectors.
+// Returns the number of problems without solution, their velocities are NaN.
+int lambertBatch_C(int n, double *r1, double *r2, double *tof, double *mu,
+        int *revs, double *v1, double *v2, int workers) {
+    const int block = 16 * lambert::LAMBERT_CHUNK;
+    int blocks = (n + block - 1) / block;
+    std::atomic<int> failed(0);
+    thread_pool::instance().parallel_for(blocks, workers, [&](int b) {
+        int i0 = b * block;
+        int m = std::min(block, n - i0);
+        failed += lambert::solveBatch(m, r1 + 3 * i0, r2 + 3 * i0, tof + i0,
+                mu + i0, revs + i0, v1 + 3 * i0, v2 + 3 * i0);
+    });
+    return failed;
+}
+
+void cassini1LpBatchC(int popsize, int dim, double *xs, double *ys) {
+    evalBatch(cassini1, popsize, dim, xs, ys);
+}
+
+void gtoc1LpBatchC(int popsize, int dim, double *xs, double *ys) {
+    evalBatch(gtoc1, popsize, dim, xs, ys);
+}
+
+void cassini2LpBatchC(int popsize, int dim, double *xs, double *ys) {
+    evalBatch(cassini2, popsize, dim, xs, ys);
+}
+
+void messengerfullLpBatchC(int popsize, int dim, double *xs, double *ys) {
+    evalBatch(messengerfull, popsize, dim, xs, ys);
+}
+
+void rosettaLpBatchC(int popsize, int dim, double *xs, double *ys) {
+    evalBatch(rosetta, popsize, dim, xs, ys);
+}
+
+void sagasLpBatchC(int popsize, int dim, double *xs, double *ys) {
+    evalBatch(sagas, popsize, dim, xs, ys);
+}
+}
@@ -0,0 +1,555 @@
+/*
+ * advstore.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Concurrent result store of the advanced retry, see fcmaes/advretry.py.
+// The store lives in a named shared memory segment, so it can be used by
+// forked and spawned worker processes. All references inside the segment
+// are offsets, each process maps it at its own address.
+//
+// Writers never block each other: each worker process owns an insertion
+// buffer (single producer ring) it appends its results to. A single
+// compaction step, guarded by an atomic flag instead of a lock, merges the
+// sorted entries and all buffered results, removes entries close to better
+// ones to preserve diversity, keeps the 90% best and publishes them as new
+// sorted snapshot. There are two snapshots, readers access the active one
+// protected by a sequence counter and retry if it changed while reading.
+// Crossover pairs are sampled in O(1): the original scan selecting each
+// sorted index with probability lim is equivalent to drawing geometric
+// distributed gaps.
+// Requires shm_open / mmap, on other platforms creating a store fails.
+
+#ifndef ADVSTORE_HPP_
+#define ADVSTORE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <float.h>
+#include <new>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "philox.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ADV_STORE_SHM 1
+#else
+#define ADV_STORE_SHM 0
+#endif
+
+static const char ADV_STORE_MAGIC[8] = { 'F', 'C', 'M', 'A', 'E', 'S', 'A', 'S' };
+
+struct adv_store_header {
+    char magic[8];
+    int32_t dim;
+    int32_t capacity;
+    int32_t slots;
+    int32_t bufSize;
+    int64_t bytes;
+    uint64_t seed;
+    std::atomic<int32_t> compacting;
+    std::atomic<int32_t> active;
+    std::atomic<uint32_t> seq[2];
+    int32_t size[2];
+    std::atomic<int64_t> evals;
+    std::atomic<int32_t> runs;
+    std::atomic<uint64_t> evalFac; // bits of a double
+    std::atomic<uint64_t> calls;
+    std::atomic<uint32_t> bestSeq;
+    double bestY;
+};
+
+// insertion buffer of a worker process.
+struct adv_store_slot {
+    std::atomic<int64_t> owner; // pid, 0 if free
+    std::atomic<int64_t> head; // written by the owner
+    std::atomic<int64_t> tail; // written by the compaction
+    char pad[40];
+};
+
+class adv_store {
+
+public:
+
+    // entries of an insertion buffer.
+    static const int BUF_SIZE = 16;
+
+    // creates a new segment, returns NULL if this fails.
+    static adv_store* create(const char *name, int dim, int capacity,
+            int slots, const double *lower, const double *upper,
+            uint64_t seed) {
+#if ADV_STORE_SHM
+        int64_t bytes = layout(dim, capacity, slots, BUF_SIZE, NULL);
+        shm_unlink(name);
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+            return NULL;
+        if (ftruncate(fd, bytes) != 0) {
+            close(fd);
+            shm_unlink(name);
+            return NULL;
+        }
+        void *base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            shm_unlink(name);
+            return NULL;
+        }
+        memset(base, 0, bytes);
+        adv_store_header *h = new (base) adv_store_header();
+        h->dim = dim;
+        h->capacity = capacity;
+        h->slots = slots;
+        h->bufSize = BUF_SIZE;
+        h->bytes = bytes;
+        h->seed = seed;
+        h->bestY = DBL_MAX;
+        h->evalFac = bits(1.0);
+        adv_store *store = new adv_store(name, base);
+        for (int s = 0; s < slots; s++)
+            new (store->slot(s)) adv_store_slot();
+        std::copy(lower, lower + dim, store->_lower);
+        std::copy(upper, upper + dim, store->_upper);
+        memcpy(h->magic, ADV_STORE_MAGIC, 8);
+        return store;
+#else
+        return NULL;
+#endif
+    }
+
+    // maps an existing segment created by another process.
+    static adv_store* attach(const char *name) {
+#if ADV_STORE_SHM
+        int fd = shm_open(name, O_RDWR, 0600);
+        if (fd < 0)
+            return NULL;
+        struct stat st;
+        void *base = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(adv_store_header))
+            base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+            return NULL;
+        adv_store_header *h = (adv_store_header*) base;
+        if (memcmp(h->magic, ADV_STORE_MAGIC, 8) != 0 || h->bytes != st.st_size) {
+            munmap(base, st.st_size);
+            return NULL;
+        }
+        return new adv_store(name, base);
+#else
+        return NULL;
+#endif
+    }
+
+    // unmaps the segment, the creator also removes its name.
+    void unmap(bool unlink) {
+#if ADV_STORE_SHM
+        munmap(_base, _h->bytes);
+        if (unlink)
+            shm_unlink(_name.c_str());
+#endif
+    }
+
+    int dim() const {
+        return _h->dim;
+    }
+
+    // insertion buffer for the calling process, -1 if all are owned by
+    // living processes, then results are merged directly.
+    int claimSlot() {
+#if ADV_STORE_SHM
+        int64_t pid = getpid();
+        for (int s = 0; s < _h->slots; s++)
+            if (slot(s)->owner.load() == pid)
+                return s;
+        for (int s = 0; s < _h->slots; s++) {
+            adv_store_slot *sl = slot(s);
+            int64_t owner = sl->owner.load();
+            if ((owner == 0 || kill((pid_t) owner, 0) != 0)
+                    && sl->owner.compare_exchange_strong(owner, pid))
+                return s;
+        }
+#endif
+        return -1;
+    }
+
+    // registers a result, returns true if it is the new best one.
+    bool add(int s, double y, const double *x, long evals, double limit) {
+        _h->evals += evals;
+        if (!(y < limit))
+            return false;
+        bool improved = updateBest(y, x);
+        if (s < 0 || s >= _h->slots) {
+            lock();
+            merge(1, &y, x, true);
+            unlock();
+            return improved;
+        }
+        adv_store_slot *sl = slot(s);
+        int64_t head = sl->head.load(std::memory_order_relaxed);
+        while (head - sl->tail.load(std::memory_order_acquire) >= _h->bufSize)
+            compact(true);
+        double *e = entry(s, head % _h->bufSize);
+        e[0] = y;
+        std::copy(x, x + _h->dim, e + 1);
+        sl->head.store(head + 1, std::memory_order_release);
+        return improved;
+    }
+
+    // merges all buffered results into a new sorted snapshot, if wait is
+    // false only if no other compaction is running.
+    int compact(bool wait) {
+        if (wait)
+            lock();
+        else if (!tryLock())
+            return size();
+        int n = merge(0, NULL, NULL, true);
+        unlock();
+        return n;
+    }
+
+    // replaces the content by n sorted results, used to restore a store.
+    void setData(int n, const double *ys, const double *xs,
+            const double *bestX, double bestY) {
+        lock();
+        merge(n, ys, xs, false);
+        unlock();
+        updateBest(bestY, bestX);
+    }
+
+    // number of sorted entries.
+    int size() {
+        int n;
+        read([&](int a) {
+            n = _h->size[a];
+        });
+        return n;
+    }
+
+    // copies the sorted entries, xs may be NULL, returns their number.
+    int data(double *ys, double *xs) {
+        int n;
+        read([&](int a) {
+            n = _h->size[a];
+            std::copy(_ys[a], _ys[a] + n, ys);
+            if (xs != NULL)
+                std::copy(_xs[a], _xs[a] + (long) n * _h->dim, xs);
+        });
+        return n;
+    }
+
+    double bestY(double *x) {
+        double y;
+        for (;;) {
+            uint32_t s = _h->bestSeq.load(std::memory_order_acquire);
+            if (s & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            y = _h->bestY;
+            if (x != NULL)
+                std::copy(_bestX, _bestX + _h->dim, x);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_h->bestSeq.load(std::memory_order_relaxed) == s)
+                return y;
+        }
+    }
+
+    long evals() const {
+        return _h->evals.load();
+    }
+
+    int runs() const {
+        return _h->runs.load();
+    }
+
+    double evalFac() const {
+        return value(_h->evalFac.load());
+    }
+
+    // counts a new run if less than limit were started. Every
+    // checkInterval runs the evaluation factor is incremented and the
+    // store is compacted.
+    bool nextRun(int limit, int checkInterval, double maxFac,
+            double facIncr) {
+        int runs = _h->runs.load();
+        do {
+            if (runs >= limit)
+                return false;
+        } while (!_h->runs.compare_exchange_weak(runs, runs + 1));
+        if (checkInterval > 0 && (runs + 1) % checkInterval == checkInterval - 1) {
+            uint64_t f = _h->evalFac.load();
+            while (value(f) < maxFac
+                    && !_h->evalFac.compare_exchange_weak(f,
+                            bits(value(f) + facIncr)))
+                ;
+            compact(false);
+        }
+        return true;
+    }
+
+    // indices of two sorted entries for crossover, i < j, false if there
+    // are too few.
+    bool crossover(philox &rs, int n, int &i, int &j) {
+        if (n < 2)
+            return false;
+        double lim = (std::min(0.1 * n, 1.0)
+                + rs.uniform() * (0.2 * n - std::min(0.1 * n, 1.0))) / n;
+        for (int k = 0; k < 100; k++) {
+            i = geometric(rs, lim);
+            j = i + 1 + geometric(rs, lim);
+            if (j < n)
+                return true;
+        }
+        return false;
+    }
+
+    // crossover pair of the current sorted entries.
+    bool crossover(int &i, int &j) {
+        philox rs = philox(_h->seed).substream(_h->calls++);
+        return crossover(rs, size(), i, j);
+    }
+
+    // guess x1, boundaries and initial step size for the crossover
+    // operation, returns the value of the parent or DBL_MAX if there are
+    // too few entries.
+    double limits(double *x1, double *lower, double *upper, double *sdev) {
+        philox rs = philox(_h->seed).substream(_h->calls++);
+        double diffFac = 0.5 + 0.5 * rs.uniform();
+        double limFac = (2.0 + 2.0 * rs.uniform()) * diffFac;
+        int dim = _h->dim;
+        std::vector<double> x0(dim);
+        double y0 = DBL_MAX;
+        read([&](int a) {
+            int i, j;
+            y0 = DBL_MAX;
+            if (crossover(rs, _h->size[a], i, j)) {
+                y0 = _ys[a][i];
+                std::copy(_xs[a] + (long) i * dim, _xs[a] + (long) (i + 1) * dim,
+                        x0.begin());
+                std::copy(_xs[a] + (long) j * dim, _xs[a] + (long) (j + 1) * dim,
+                        x1);
+            }
+        });
+        if (y0 == DBL_MAX)
+            return y0;
+        for (int k = 0; k < dim; k++) {
+            double deltax = std::abs(x1[k] - x0[k]);
+            double deltaBound = std::max(0.0001, limFac * deltax);
+            lower[k] = std::max(_lower[k], x0[k] - deltaBound);
+            upper[k] = std::min(_upper[k], x0[k] + deltaBound);
+            sdev[k] = std::min(0.5,
+                    std::max(0.001, diffFac * deltax / (_upper[k] - _lower[k])));
+        }
+        return y0;
+    }
+
+private:
+
+    adv_store(const char *name, void *base) :
+            _name(name), _base((char*) base), _h((adv_store_header*) base) {
+        int64_t off[6];
+        layout(_h->dim, _h->capacity, _h->slots, _h->bufSize, off);
+        _lower = (double*) (_base + off[0]);
+        _upper = _lower + _h->dim;
+        _bestX = _upper + _h->dim;
+        for (int a = 0; a < 2; a++) {
+            _ys[a] = (double*) (_base + off[1 + a]);
+            _xs[a] = _ys[a] + _h->capacity;
+        }
+        _slots = _base + off[3];
+    }
+
+    // byte size of the segment, off receives the offsets of the bounds,
+    // the two snapshots and the slots.
+    static int64_t layout(int dim, int capacity, int slots, int bufSize,
+            int64_t *off) {
+        int64_t pos = align(sizeof(adv_store_header));
+        int64_t o[4];
+        o[0] = pos;
+        pos = align(pos + 3 * dim * sizeof(double));
+        for (int a = 0; a < 2; a++) {
+            o[1 + a] = pos;
+            pos = align(pos + (int64_t) capacity * (dim + 1) * sizeof(double));
+        }
+        o[3] = pos;
+        pos += (int64_t) slots * slotBytes(dim, bufSize);
+        if (off != NULL)
+            std::copy(o, o + 4, off);
+        return pos;
+    }
+
+    static int64_t align(int64_t pos) {
+        return (pos + 63) & ~(int64_t) 63;
+    }
+
+    static int64_t slotBytes(int dim, int bufSize) {
+        return align(sizeof(adv_store_slot) + (int64_t) bufSize * (dim + 1) * sizeof(double));
+    }
+
+    adv_store_slot* slot(int s) {
+        return (adv_store_slot*) (_slots + s * slotBytes(_h->dim, _h->bufSize));
+    }
+
+    double* entry(int s, int k) {
+        return (double*) ((char*) slot(s) + sizeof(adv_store_slot))
+                + (long) k * (_h->dim + 1);
+    }
+
+    static uint64_t bits(double d) {
+        uint64_t b;
+        memcpy(&b, &d, sizeof(b));
+        return b;
+    }
+
+    static double value(uint64_t b) {
+        double d;
+        memcpy(&d, &b, sizeof(d));
+        return d;
+    }
+
+    // number of failures before the first success, success probability p.
+    static int geometric(philox &rs, double p) {
+        if (p >= 1)
+            return 0;
+        double g = std::floor(std::log(1.0 - rs.uniform()) / std::log(1.0 - p));
+        return g < INT32_MAX / 2 ? (int) g : INT32_MAX / 2;
+    }
+
+    bool tryLock() {
+        int32_t expected = 0;
+        return _h->compacting.compare_exchange_strong(expected, 1,
+                std::memory_order_acquire);
+    }
+
+    void lock() {
+        while (!tryLock())
+            std::this_thread::yield();
+    }
+
+    void unlock() {
+        _h->compacting.store(0, std::memory_order_release);
+    }
+
+    // executes f(active snapshot) until no compaction interfered.
+    template<typename F> void read(F f) {
+        for (;;) {
+            int a = _h->active.load(std::memory_order_acquire);
+            uint32_t s = _h->seq[a].load(std::memory_order_acquire);
+            if (s & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            f(a);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_h->seq[a].load(std::memory_order_relaxed) == s)
+                return;
+        }
+    }
+
+    bool updateBest(double y, const double *x) {
+        if (!(y < bestY(NULL)))
+            return false;
+        uint32_t s;
+        do {
+            s = _h->bestSeq.load() & ~1u;
+        } while (!_h->bestSeq.compare_exchange_weak(s, s + 1));
+        bool improved = y < _h->bestY;
+        if (improved) {
+            _h->bestY = y;
+            std::copy(x, x + _h->dim, _bestX);
+        }
+        _h->bestSeq.store(s + 2, std::memory_order_release);
+        return improved;
+    }
+
+    double distance(const double *x, const double *xprev) const {
+        double sum = 0;
+        for (int k = 0; k < _h->dim; k++) {
+            double d = (x[k] - xprev[k]) / (_upper[k] - _lower[k]);
+            sum += d * d;
+        }
+        return std::sqrt(sum / _h->dim);
+    }
+
+    // requires the compaction flag. Merges the active snapshot if
+    // withActive, the buffered results and m extra entries into the other
+    // snapshot.
+    int merge(int m, const double *ys, const double *xs, bool withActive) {
+        int dim = _h->dim;
+        int a = _h->active.load();
+        int n = withActive ? _h->size[a] : 0;
+        std::vector<double> cy(_ys[a], _ys[a] + n);
+        std::vector<const double*> cx(n);
+        for (int i = 0; i < n; i++)
+            cx[i] = _xs[a] + (long) i * dim;
+        for (int i = 0; i < m; i++) {
+            cy.push_back(ys[i]);
+            cx.push_back(xs + (long) i * dim);
+        }
+        std::vector<int64_t> heads(_h->slots);
+        for (int s = 0; s < _h->slots; s++) {
+            adv_store_slot *sl = slot(s);
+            heads[s] = sl->head.load(std::memory_order_acquire);
+            for (int64_t t = sl->tail.load(); t < heads[s]; t++) {
+                const double *e = entry(s, t % _h->bufSize);
+                cy.push_back(e[0]);
+                cx.push_back(e + 1);
+            }
+        }
+        std::vector<int> idx(cy.size());
+        for (size_t i = 0; i < idx.size(); i++)
+            idx[i] = i;
+        std::stable_sort(idx.begin(), idx.end(), [&](int i, int j) {
+            return cy[i] < cy[j];
+        });
+        int w = 1 - a;
+        int keep = (int) (0.9 * _h->capacity);
+        _h->seq[w].fetch_add(1, std::memory_order_acq_rel);
+        int k = 0;
+        const double *xprev = NULL, *xprev2 = NULL;
+        for (size_t i = 0; i < idx.size() && k < keep; i++) {
+            const double *x = cx[idx[i]];
+            if ((xprev == NULL || distance(xprev, x) > 0.15)
+                    && (xprev2 == NULL || distance(xprev2, x) > 0.15)) {
+                _ys[w][k] = cy[idx[i]];
+                std::copy(x, x + dim, _xs[w] + (long) k * dim);
+                xprev2 = xprev;
+                xprev = _xs[w] + (long) k * dim;
+                k++;
+            }
+        }
+        _h->size[w] = k;
+        _h->seq[w].fetch_add(1, std::memory_order_release);
+        _h->active.store(w, std::memory_order_release);
+        // the buffered entries are copied, release them.
+        for (int s = 0; s < _h->slots; s++)
+            slot(s)->tail.store(heads[s], std::memory_order_release);
+        return k;
+    }
+
+    std::string _name;
+    char *_base;
+    adv_store_header *_h;
+    double *_lower;
+    double *_upper;
+    double *_bestX;
+    double *_ys[2];
+    double *_xs[2];
+    char *_slots;
+};
+
+#endif /* ADVSTORE_HPP_ */
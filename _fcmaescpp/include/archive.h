@@ -0,0 +1,229 @@
+/*
+ * archive.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Native CVT MAP-Elites archive, see fcmaes/mapelites.py.
+// The niche of a descriptor is its nearest niche center, determined by a
+// center_tree (centertree.h).
+//
+// The solutions, descriptors, values, counts and statistics are not owned
+// by the archive: they are the shared memory arrays of the Python Archive,
+// bound once per process. A niche is updated by compare and replace under a
+// per niche spinlock living in shared memory, so concurrent worker processes
+// never mix the solution of one candidate with the value of another. If no
+// statistics are maintained, candidates not improving their niche are
+// rejected without taking the lock.
+//
+// The variation operators of MAP-Elites, SBX with polynomial mutation and
+// Iso+LineDD, sample their parents from the archive and write clipped
+// offspring in a single pass, without intermediate arrays.
+
+#ifndef ARCHIVE_HPP_
+#define ARCHIVE_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+#include "centertree.h"
+#include "philox.h"
+
+class qd_archive {
+
+public:
+
+    // centers are row major capacity x qdim in encoded coordinates,
+    // (d - lower) / scale.
+    qd_archive(int dim, int qdim, int capacity, const double *centers,
+            const double *lower, const double *scale) :
+            _dim(dim), _qdim(qdim), _lower(lower, lower + qdim), _scale(
+                    scale, scale + qdim), _xs(nullptr), _ds(nullptr), _ys(
+                    nullptr), _counts(nullptr), _occupied(nullptr), _stats(
+                    nullptr), _locks(nullptr) {
+        _tree.build(qdim, capacity, centers);
+    }
+
+    // binds the shared arrays of the Python archive valid in this process.
+    // stats may be null.
+    void bind(double *xs, double *ds, double *ys, long *counts,
+            long *occupied, double *stats, int *locks) {
+        _xs = xs;
+        _ds = ds;
+        _ys = ys;
+        _counts = counts;
+        _occupied = occupied;
+        _stats = stats;
+        _locks = locks;
+    }
+
+    // niche of descriptor d (not encoded).
+    int niche(const double *d) const {
+        double q[_qdim];
+        for (int j = 0; j < _qdim; j++)
+            q[j] = (d[j] - _lower[j]) / _scale[j];
+        return _tree.nearest(q);
+    }
+
+    // adds candidate x with value y and descriptor d to niche i if it improves
+    // the niche. Returns the old value of the niche.
+    double update(int i, const double *x, double y, const double *d) {
+        if (_stats == nullptr) {
+            __atomic_fetch_add(_counts + i, 1, __ATOMIC_RELAXED);
+            if (!(y < load(i)))
+                return load(i);
+            lock(i);
+        } else {
+            lock(i);
+            updateStats(i, x);
+        }
+        double old = _ys[i];
+        if (y < old) {
+            if (old == INFINITY)
+                __atomic_fetch_add(_occupied, 1, __ATOMIC_RELAXED);
+            std::copy(x, x + _dim, _xs + (long) i * _dim);
+            std::copy(d, d + _qdim, _ds + (long) i * _qdim);
+            __atomic_store(_ys + i, &y, __ATOMIC_RELEASE);
+        }
+        unlock(i);
+        return old;
+    }
+
+    // n offspring generated by simulated binary crossover followed by
+    // polynomial mutation, written to xs (n x dim). The parents are drawn
+    // uniformly from the bestN best niches, si holds the niches sorted by
+    // value, null means niches 0, ..., bestN - 1. disC and disM are the
+    // distribution indices of crossover and mutation, both are randomized
+    // per call.
+    void sbx(int n, int bestN, const int *si, const double *lower,
+            const double *upper, double disC, double disM, philox &rs,
+            double *xs) {
+        disC *= 0.5 + 0.5 * rs.uniform();
+        disM *= 0.5 + 0.5 * rs.uniform();
+        double child[_dim];
+        for (int p = 0; p < n; p += 2) {
+            const double *x1 = parent(bestN, si, rs);
+            const double *x2 = parent(bestN, si, rs);
+            double *c1 = xs + (long) p * _dim;
+            double *c2 = p + 1 < n ? c1 + _dim : child;
+            for (int j = 0; j < _dim; j++) {
+                double mu = rs.uniform();
+                double beta = std::pow(2 * mu,
+                        (mu <= 0.5 ? 1 : -1) / (disC + 1));
+                if (rs.uniform() < 0.5)
+                    beta = -beta;
+                if (rs.uniform() < 0.5)
+                    beta = 1;
+                double mean = 0.5 * (x1[j] + x2[j]);
+                double diff = 0.5 * (x1[j] - x2[j]);
+                c1[j] = mean + beta * diff;
+                c2[j] = mean - beta * diff;
+            }
+            mutate(c1, lower, upper, disM, rs);
+            mutate(c2, lower, upper, disM, rs);
+        }
+    }
+
+    // n offspring x1 + N(0, isoSigma) + N(0, lineSigma) * (x1 - x2)
+    // generated by Iso+LineDD, written to xs (n x dim). Parents are drawn
+    // as for sbx.
+    void isoDD(int n, int bestN, const int *si, const double *lower,
+            const double *upper, double isoSigma, double lineSigma,
+            philox &rs, double *xs) {
+        for (int p = 0; p < n; p++) {
+            const double *x1 = parent(bestN, si, rs);
+            const double *x2 = parent(bestN, si, rs);
+            double *c = xs + (long) p * _dim;
+            for (int j = 0; j < _dim; j++) {
+                double x = x1[j] + isoSigma * rs.normal()
+                        + lineSigma * rs.normal() * (x1[j] - x2[j]);
+                c[j] = std::min(upper[j], std::max(lower[j], x));
+            }
+        }
+    }
+
+private:
+
+    const double* parent(int bestN, const int *si, philox &rs) const {
+        int i = rs.uniformInt(bestN);
+        return _xs + (long) (si == nullptr ? i : si[i]) * _dim;
+    }
+
+    // polynomial mutation of each variable with probability 1 / dim,
+    // clips x to the bounds.
+    void mutate(double *x, const double *lower, const double *upper,
+            double disM, philox &rs) const {
+        double e = 1 / (disM + 1);
+        for (int j = 0; j < _dim; j++) {
+            if (rs.uniform() < 1.0 / _dim) {
+                double mu = rs.uniform();
+                double range = upper[j] - lower[j];
+                if (mu <= 0.5) {
+                    double norm = (x[j] - lower[j]) / range;
+                    double b = std::pow(std::abs(1 - norm), disM + 1);
+                    x[j] += range
+                            * (std::pow(2 * mu + (1 - 2 * mu) * b, e) - 1);
+                } else {
+                    double norm = (upper[j] - x[j]) / range;
+                    double b = std::pow(std::abs(1 - norm), disM + 1);
+                    x[j] += range * (1
+                            - std::pow(2 * (1 - mu) + 2 * (mu - 0.5) * b, e));
+                }
+            }
+            x[j] = std::min(upper[j], std::max(lower[j], x[j]));
+        }
+    }
+
+    // running mean, sum of squared deviations, min and max of the candidates
+    // of niche i.
+    void updateStats(int i, const double *x) {
+        long count = ++_counts[i];
+        double *mean = _stats + 4L * i * _dim;
+        double *qmean = mean + _dim;
+        double *mn = qmean + _dim;
+        double *mx = mn + _dim;
+        for (int j = 0; j < _dim; j++) {
+            double diff = x[j] - mean[j];
+            mean[j] += diff / count;
+            qmean[j] += diff * diff * (count - 1.0) / count;
+            mn[j] = std::min(mn[j], x[j]);
+            mx[j] = std::max(mx[j], x[j]);
+        }
+    }
+
+    double load(int i) const {
+        double y;
+        __atomic_load(_ys + i, &y, __ATOMIC_ACQUIRE);
+        return y;
+    }
+
+    void lock(int i) {
+        for (int spin = 0; __atomic_exchange_n(_locks + i, 1, __ATOMIC_ACQUIRE);
+                spin++)
+            if (spin > 64)
+                std::this_thread::yield();
+    }
+
+    void unlock(int i) {
+        __atomic_store_n(_locks + i, 0, __ATOMIC_RELEASE);
+    }
+
+    int _dim;
+    int _qdim;
+    std::vector<double> _lower;
+    std::vector<double> _scale;
+    center_tree _tree;
+    // shared arrays of the Python archive.
+    double *_xs;
+    double *_ds;
+    double *_ys;
+    long *_counts;
+    long *_occupied;
+    double *_stats;
+    int *_locks;
+};
+
+#endif /* ARCHIVE_HPP_ */
@@ -0,0 +1,135 @@
+/*
+ * centertree.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Nearest center search used by the MAP-Elites archive (archive.h) and the
+// k-means niche center computation (kmeans.cpp).
+// The centers are stored coordinate major (structure of arrays), so the
+// squared distances of a query to a block of centers are computed by the
+// vectorized kernels::nearestCenter. For low dimensions a KD-tree over the
+// centers is used, its leaves are contiguous blocks of the reordered center
+// array searched by the same kernel. The tree stops paying off if the
+// dimension approaches log2 of the number of centers, then and for few
+// centers all of them are searched brute force.
+
+#ifndef CENTERTREE_HPP_
+#define CENTERTREE_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <float.h>
+#include <vector>
+#include "kernels.h"
+
+class center_tree {
+
+public:
+
+    // at most BRUTE_FORCE_MAX centers are searched without tree.
+    static const int BRUTE_FORCE_MAX = 512;
+    static const int LEAF_SIZE = 32;
+
+    center_tree() :
+            _dim(0), _n(0) {
+    }
+
+    // centers are row major n x dim.
+    void build(int dim, int n, const double *centers) {
+        _dim = dim;
+        _n = n;
+        _order.resize(n);
+        _cs.resize((long) dim * n);
+        _nodes.clear();
+        for (int i = 0; i < n; i++)
+            _order[i] = i;
+        if (n > BRUTE_FORCE_MAX && dim <= std::log2(n) - 3)
+            split(centers, 0, n);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < dim; j++)
+                _cs[(long) j * n + i] = centers[(long) _order[i] * dim + j];
+    }
+
+    // index of the center nearest to q.
+    int nearest(const double *q) const {
+        double best = DBL_MAX;
+        int i = _nodes.empty() ?
+                kernels::nearestCenter(_dim, _n, _cs.data(), _n, q, &best) :
+                search(0, q, best);
+        return _order[std::max(0, i)];
+    }
+
+private:
+
+    struct node {
+        int dim; // split dimension, -1 for a leaf
+        double split;
+        int left, right; // child nodes, leaf: range in _order
+    };
+
+    // builds the subtree of _order[begin, end), returns its node index.
+    int split(const double *centers, int begin, int end) {
+        int k = (int) _nodes.size();
+        _nodes.push_back(node { -1, 0, begin, end });
+        if (end - begin <= LEAF_SIZE)
+            return k;
+        int dim = 0;
+        double spread = -1;
+        for (int j = 0; j < _dim; j++) {
+            double mn = DBL_MAX, mx = -DBL_MAX;
+            for (int i = begin; i < end; i++) {
+                double c = centers[(long) _order[i] * _dim + j];
+                mn = std::min(mn, c);
+                mx = std::max(mx, c);
+            }
+            if (mx - mn > spread) {
+                spread = mx - mn;
+                dim = j;
+            }
+        }
+        int mid = (begin + end) / 2;
+        std::nth_element(_order.begin() + begin, _order.begin() + mid,
+                _order.begin() + end, [&](int a, int b) {
+                    return centers[(long) a * _dim + dim]
+                            < centers[(long) b * _dim + dim];
+                });
+        double value = centers[(long) _order[mid] * _dim + dim];
+        int left = split(centers, begin, mid);
+        int right = split(centers, mid, end);
+        _nodes[k] = node { dim, value, left, right };
+        return k;
+    }
+
+    // position in _order of the center nearest to q closer than best, -1 if
+    // there is none in the subtree.
+    int search(int k, const double *q, double &best) const {
+        const node &nd = _nodes[k];
+        if (nd.dim < 0) {
+            int i = kernels::nearestCenter(_dim, nd.right - nd.left,
+                    _cs.data() + nd.left, _n, q, &best);
+            return i < 0 ? -1 : nd.left + i;
+        }
+        double diff = q[nd.dim] - nd.split;
+        int near = diff < 0 ? nd.left : nd.right;
+        int far = diff < 0 ? nd.right : nd.left;
+        int i = search(near, q, best);
+        if (diff * diff < best) {
+            int j = search(far, q, best);
+            if (j >= 0)
+                i = j;
+        }
+        return i;
+    }
+
+    int _dim;
+    int _n;
+    // centers in tree order, coordinate major.
+    std::vector<double> _cs;
+    // center index of each position in _cs.
+    std::vector<int> _order;
+    std::vector<node> _nodes;
+};
+
+#endif /* CENTERTREE_HPP_ */
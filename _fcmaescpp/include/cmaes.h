@@ -0,0 +1,433 @@
+/*
+ * cmaes.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Header only active CMA-ES for small fixed size problems embedded in C++
+// code, the same algorithm as AcmaesOptimizer in acmaesoptimizer.cpp.
+// Dimension and population size are template parameters, all state uses
+// fixed size Eigen types and lives inside the object, so no heap memory is
+// allocated and the optimizer can be placed on the stack. The objective is a
+// functor double(const Vec&) passed as template argument, the compiler can
+// inline it into the generation loop. Intended for dim < ~20, for larger
+// dimensions use the library, fixed size Eigen matrices are not efficient
+// there.
+//
+// Usage:
+//
+//    fcmaes::Cmaes<4, 10> es(guess, sigma, lower, upper, 20000);
+//    es.optimize([](const fcmaes::Cmaes<4, 10>::Vec &x) { return x.squaredNorm(); });
+//    double y = es.bestValue();
+//
+// or via ask / tell:
+//
+//    while (es.stop() == 0) {
+//        const auto &xs = es.ask();
+//        for (int k = 0; k < 10; k++)
+//            ys(k) = f(xs.col(k));
+//        es.tell(ys);
+//    }
+
+#ifndef CMAES_HPP_
+#define CMAES_HPP_
+
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <float.h>
+#include "philox.h"
+
+namespace fcmaes {
+
+template<int Dim, int Popsize>
+class Cmaes {
+
+    static_assert(Dim > 0, "Dim must be positive");
+    static_assert(Popsize >= 4, "Popsize must be at least 4");
+
+public:
+
+    // number of parents/points for recombination.
+    static const int Mu = Popsize / 2;
+    // size of history queue of best values.
+    static const int HistorySize = 10 + 30 * Dim / Popsize;
+
+    typedef Eigen::Matrix<double, Dim, 1> Vec;
+    typedef Eigen::Matrix<double, Dim, Dim> Mat;
+    typedef Eigen::Matrix<double, Dim, Popsize> Pop;
+    typedef Eigen::Matrix<double, Popsize, 1> Fit;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    // guess: initial solution, inputSigma: initial coordinate wise standard
+    // deviations, lower/upper: box constraints, maxEvaluations: evaluation
+    // budget, used by optimize and to adapt the step size damping.
+    Cmaes(const Vec &guess, const Vec &inputSigma, const Vec &lower,
+            const Vec &upper, int maxEvaluations, long seed = 0,
+            double stopfitness = -std::numeric_limits<double>::infinity(),
+            double accuracy = 1.0) :
+            lower_(lower), upper_(upper), rs_(seed) {
+        init(guess, inputSigma, maxEvaluations, stopfitness, accuracy);
+    }
+
+    // unbounded problem.
+    Cmaes(const Vec &guess, const Vec &inputSigma, int maxEvaluations,
+            long seed = 0,
+            double stopfitness = -std::numeric_limits<double>::infinity(),
+            double accuracy = 1.0) :
+            lower_(Vec::Constant(-std::numeric_limits<double>::infinity())), upper_(
+                    Vec::Constant(std::numeric_limits<double>::infinity())), rs_(
+                    seed) {
+        init(guess, inputSigma, maxEvaluations, stopfitness, accuracy);
+    }
+
+    // generates Popsize new argument vectors, the columns of the result.
+    // The reference stays valid until the next call of ask.
+    const Pop& ask() {
+        rs_.fillNormal(arz_.data(), Dim * Popsize);
+        arx_.noalias() = BD_ * arz_;
+        for (int k = 0; k < Popsize; k++)
+            arx_.col(k) = closestFeasible(xmean_ + sigma_ * arx_.col(k));
+        return arx_;
+    }
+
+    // tells the function values for the argument vectors of the last ask.
+    // returns the stop criteria, 0 if the optimization should continue.
+    int tell(const Fit &ys) {
+        for (int k = 0; k < Popsize; k++)
+            fitness_(k) = std::isfinite(ys(k)) ? ys(k) : DBL_MAX;
+        evaluations_ += Popsize;
+        xmean_ = closestFeasible(xmean_);
+        // recompute the random vectors since the bounds may have moved arx
+        Vec invD = diagD_.cwiseInverse();
+        arz_.noalias() = invD.asDiagonal() * B_.transpose()
+                * ((arx_.colwise() - xmean_) / sigma_);
+        updateCMA();
+        iterations_++;
+        return stop_;
+    }
+
+    // minimizes fun until maxEvaluations is reached or a stop criteria holds.
+    // returns the number of evaluations.
+    template<class F>
+    int optimize(F &&fun) {
+        Fit ys;
+        Vec x;
+        while (evaluations_ < maxEvaluations_ && stop_ == 0) {
+            const Pop &xs = ask();
+            for (int k = 0; k < Popsize; k++) {
+                x = xs.col(k);
+                ys(k) = fun(x);
+            }
+            tell(ys);
+        }
+        return evaluations_;
+    }
+
+    const Vec& bestX() const {
+        return bestX_;
+    }
+
+    double bestValue() const {
+        return bestValue_;
+    }
+
+    const Vec& mean() const {
+        return xmean_;
+    }
+
+    double sigma() const {
+        return sigma_;
+    }
+
+    int evaluations() const {
+        return evaluations_;
+    }
+
+    int iterations() const {
+        return iterations_;
+    }
+
+    int stop() const {
+        return stop_;
+    }
+
+private:
+
+    void init(const Vec &guess, const Vec &inputSigma, int maxEvaluations,
+            double stopfitness, double accuracy) {
+        maxEvaluations_ = maxEvaluations;
+        stopfitness_ = stopfitness;
+        accuracy_ = accuracy;
+        // overall standard deviation - search volume.
+        sigma_ = inputSigma.maxCoeff();
+        // termination criteria
+        stopTolUpX_ = 1e3 * sigma_;
+        stopTolX_ = 1e-11 * sigma_ * accuracy;
+        stopTolFun_ = 1e-12 * accuracy;
+        stopTolHistFun_ = 1e-13 * accuracy;
+        // array for weighted recombination.
+        for (int i = 0; i < Mu; i++)
+            weights_(i) = log(Mu + 0.5) - log(i + 1.0);
+        double sumw = weights_.sum();
+        double sumwq = weights_.squaredNorm();
+        weights_ *= 1. / sumw;
+        // variance-effectiveness of sum w_i x_i.
+        mueff_ = sumw * sumw / sumwq;
+        // dynamic strategy parameters and constants
+        double dim = Dim;
+        cc_ = (4. + mueff_ / dim) / (dim + 4. + 2. * mueff_ / dim);
+        cs_ = (mueff_ + 2.) / (dim + mueff_ + 3.);
+        damps_ = (1. + 2. * std::max(0., sqrt((mueff_ - 1.) / (dim + 1.)) - 1.))
+                * std::max(0.3,
+                        1. - dim / (1e-6 + (maxEvaluations / Popsize)))
+                + cs_;
+        ccov1_ = 2. / ((dim + 1.3) * (dim + 1.3) + mueff_);
+        ccovmu_ = std::min(1. - ccov1_,
+                2. * (mueff_ - 2. + 1. / mueff_)
+                        / ((dim + 2.) * (dim + 2.) + mueff_));
+        chiN_ = sqrt(dim) * (1. - 1. / (4. * dim) + 1 / (21. * dim * dim));
+        lazyUpdateGap_ = 1.0 / (ccov1_ + ccovmu_ + 1e-23) / dim / 10.0;
+        // CMA internal values - updated each generation
+        xmean_ = closestFeasible(guess);
+        pc_.setZero();
+        ps_.setZero();
+        normps_ = 0;
+        B_.setIdentity();
+        diagD_ = inputSigma / sigma_;
+        diagC_ = diagD_.cwiseProduct(diagD_);
+        BD_ = B_ * diagD_.asDiagonal();
+        C_ = diagC_.asDiagonal();
+        iterations_ = 1;
+        lastUpdate_ = 0;
+        evaluations_ = 0;
+        stop_ = 0;
+        bestValue_ = DBL_MAX;
+        bestX_ = guess;
+        fitnessHistory_.setConstant(DBL_MAX);
+    }
+
+    Vec closestFeasible(const Vec &x) const {
+        return x.cwiseMax(lower_).cwiseMin(upper_);
+    }
+
+    // indices of the first n elements of v in ascending order.
+    template<class V, int N>
+    static void sortIndex(const V &v, int (&index)[N]) {
+        for (int i = 0; i < N; i++)
+            index[i] = i;
+        std::sort(index, index + N, [&v](int i, int j) {
+            return v(i) < v(j);
+        });
+    }
+
+    bool updateEvolutionPaths(const Vec &zmean, const Vec &xold) {
+        ps_ = ps_ * (1. - cs_) + ((B_ * zmean) * sqrt(cs_ * (2. - cs_) * mueff_));
+        normps_ = ps_.norm();
+        bool hsig = normps_ / sqrt(1. - pow(1. - cs_, 2. * iterations_)) / chiN_
+                < 1.4 + 2. / (Dim + 1.);
+        pc_ *= (1. - cc_);
+        if (hsig)
+            pc_ += (xmean_ - xold) * (sqrt(cc_ * (2. - cc_) * mueff_) / sigma_);
+        return hsig;
+    }
+
+    double updateCovariance(bool hsig, const Eigen::Matrix<double, Dim, Mu> &bestArx,
+            const int (&arindex)[Popsize], const Vec &xold) {
+        double negccov = 0;
+        if (ccov1_ + ccovmu_ > 0) {
+            // mu difference vectors
+            Eigen::Matrix<double, Dim, Mu> arpos = (bestArx.colwise() - xold)
+                    * (1. / sigma_);
+            // minor correction if hsig==false
+            double oldFac = hsig ? 0 : ccov1_ * cc_ * (2. - cc_);
+            oldFac += 1. - ccov1_ - ccovmu_;
+            // Adapt covariance matrix C active CMA
+            negccov = (1. - ccovmu_) * 0.25 * mueff_
+                    / (pow(Dim + 2., 1.5) + 2. * mueff_);
+            // keep at least 0.66 in all directions
+            double negminresidualvariance = 0.66;
+            double negalphaold = 0.5;
+            // the mu worst solutions, worst first
+            Eigen::Matrix<double, Dim, Mu> arzneg;
+            for (int i = 0; i < Mu; i++)
+                arzneg.col(i) = arz_.col(arindex[Popsize - 1 - i]);
+            Eigen::Matrix<double, Mu, 1> arnorms = arzneg.colwise().norm();
+            int idxnorms[Mu];
+            sortIndex(arnorms, idxnorms);
+            // the i-th smallest norm is replaced by the i-th largest
+            Eigen::Matrix<double, Mu, 1> arnormsInv;
+            for (int i = 0; i < Mu; i++)
+                arnormsInv(idxnorms[i]) = arnorms(idxnorms[Mu - 1 - i])
+                        / arnorms(idxnorms[i]);
+            double sqarnw = arnormsInv.cwiseProduct(arnormsInv).dot(weights_);
+            double negcovMax = (1. - negminresidualvariance) / sqarnw;
+            if (negccov > negcovMax)
+                negccov = negcovMax;
+            Eigen::Matrix<double, Dim, Mu> artmp = BD_
+                    * (arzneg * arnormsInv.asDiagonal());
+            oldFac += negalphaold * negccov;
+            double cpos = ccovmu_ + (1. - negalphaold) * negccov;
+            C_ *= oldFac;
+            C_.noalias() += ccov1_ * (pc_ * pc_.transpose());
+            C_.noalias() += arpos * (cpos * weights_).asDiagonal()
+                    * arpos.transpose();
+            C_.noalias() -= artmp * (negccov * weights_).asDiagonal()
+                    * artmp.transpose();
+        }
+        return negccov;
+    }
+
+    void updateBD(double negccov) {
+        if (ccov1_ + ccovmu_ + negccov > 0
+                && (std::fmod(iterations_,
+                        1. / (ccov1_ + ccovmu_ + negccov) / Dim / 10.)) < 1.) {
+            // enforce symmetry to prevent complex numbers
+            C_.template triangularView<Eigen::StrictlyLower>() = C_.transpose();
+            Eigen::SelfAdjointEigenSolver<Mat> sades(C_);
+            // diagD defines the scaling
+            diagD_ = sades.eigenvalues();
+            B_ = sades.eigenvectors();
+            if (diagD_.minCoeff() <= 0) {
+                diagD_ = diagD_.cwiseMax(0.);
+                double tfac = diagD_.maxCoeff() / 1e14;
+                C_.diagonal().array() += tfac;
+                diagD_.array() += tfac;
+            }
+            if (diagD_.maxCoeff() > 1e14 * diagD_.minCoeff()) {
+                double tfac = diagD_.maxCoeff() / 1e14 - diagD_.minCoeff();
+                C_.diagonal().array() += tfac;
+                diagD_.array() += tfac;
+            }
+            diagC_ = C_.diagonal();
+            diagD_ = diagD_.cwiseSqrt(); // D contains standard deviations now
+            BD_ = B_ * diagD_.asDiagonal();
+        }
+    }
+
+    void updateCMA() {
+        // sort by fitness and compute weighted mean into xmean
+        int arindex[Popsize];
+        sortIndex(fitness_, arindex);
+        Vec xold = xmean_;
+        Eigen::Matrix<double, Dim, Mu> bestArx;
+        Eigen::Matrix<double, Dim, Mu> bestArz;
+        for (int i = 0; i < Mu; i++) {
+            bestArx.col(i) = arx_.col(arindex[i]);
+            bestArz.col(i) = arz_.col(arindex[i]);
+        }
+        xmean_.noalias() = bestArx * weights_;
+        Vec zmean = bestArz * weights_;
+        bool hsig = updateEvolutionPaths(zmean, xold);
+        // adapt step size sigma
+        sigma_ *= exp(std::min(1.0, (normps_ / chiN_ - 1.) * cs_ / damps_));
+        double bestFitness = fitness_(arindex[0]);
+        double worstFitness = fitness_(arindex[Popsize - 1]);
+        if (bestValue_ > bestFitness) {
+            bestValue_ = bestFitness;
+            bestX_ = bestArx.col(0);
+            if (std::isfinite(stopfitness_) && bestFitness < stopfitness_) {
+                stop_ = 1;
+                return;
+            }
+        }
+        if (iterations_ >= lastUpdate_ + lazyUpdateGap_) {
+            lastUpdate_ = iterations_;
+            double negccov = updateCovariance(hsig, bestArx, arindex, xold);
+            updateBD(negccov);
+            // handle termination criteria
+            Vec sqrtDiagC = diagC_.cwiseSqrt();
+            if ((sigma_ * pc_.cwiseAbs().cwiseMax(sqrtDiagC).array()
+                    <= stopTolX_).all()) {
+                stop_ = 2;
+                return;
+            }
+            if ((sigma_ * sqrtDiagC.array() > stopTolUpX_).any()) {
+                stop_ = 3;
+                return;
+            }
+        }
+        double historyBest = fitnessHistory_.minCoeff();
+        double historyWorst = fitnessHistory_.maxCoeff();
+        if (iterations_ > 2
+                && std::max(historyWorst, worstFitness)
+                        - std::min(historyBest, bestFitness) < stopTolFun_) {
+            stop_ = 4;
+            return;
+        }
+        if (iterations_ > HistorySize
+                && historyWorst - historyBest < stopTolHistFun_) {
+            stop_ = 5;
+            return;
+        }
+        // condition number of the covariance matrix exceeds 1e14
+        if (diagD_.maxCoeff() / diagD_.minCoeff()
+                > 1e7 * 1.0 / sqrt(accuracy_)) {
+            stop_ = 6;
+            return;
+        }
+        // adjust step size in case of equal function values (flat fitness)
+        if (bestValue_ == fitness_(arindex[(int) (0.1 + Popsize / 4.)]))
+            sigma_ *= exp(0.2 + cs_ / damps_);
+        if (iterations_ > 2
+                && std::max(historyWorst, bestFitness)
+                        - std::min(historyBest, bestFitness) == 0)
+            sigma_ *= exp(0.2 + cs_ / damps_);
+        // store best in history
+        for (int i = HistorySize - 1; i > 0; i--)
+            fitnessHistory_(i) = fitnessHistory_(i - 1);
+        fitnessHistory_(0) = bestFitness;
+    }
+
+    Vec lower_;
+    Vec upper_;
+    philox rs_;
+
+    int maxEvaluations_;
+    double stopfitness_;
+    double accuracy_;
+    double stopTolUpX_;
+    double stopTolX_;
+    double stopTolFun_;
+    double stopTolHistFun_;
+
+    Eigen::Matrix<double, Mu, 1> weights_;
+    double mueff_;
+    double cc_;
+    double cs_;
+    double damps_;
+    double ccov1_;
+    double ccovmu_;
+    double chiN_;
+    double lazyUpdateGap_;
+
+    Vec xmean_;
+    Vec pc_;
+    Vec ps_;
+    double normps_;
+    double sigma_;
+    Mat B_;
+    Mat BD_;
+    Mat C_;
+    Vec diagD_;
+    Vec diagC_;
+
+    Pop arx_;
+    Pop arz_;
+    Fit fitness_;
+    Eigen::Matrix<double, HistorySize, 1> fitnessHistory_;
+
+    int iterations_;
+    int lastUpdate_;
+    int evaluations_;
+    int stop_;
+    double bestValue_;
+    Vec bestX_;
+};
+}
+
+#endif /* CMAES_HPP_ */
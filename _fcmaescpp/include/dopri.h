@@ -0,0 +1,333 @@
+/*
+ * dopri.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Dormand Prince 5(4) integrator with embedded error estimate and step size
+// control, see E. Hairer, S.P. Norsett, G. Wanner: Solving Ordinary
+// Differential Equations I, Section II.4 and II.5.
+// Systems use the same signature as the Ascent integrators:
+// void operator()(const state_t &y, state_t &yDot, const double t).
+// Accepted steps can be observed using the 4th order continuous extension
+// (dense output) of the method, see Hairer et al. II.6.
+
+#ifndef DOPRI_HPP_
+#define DOPRI_HPP_
+
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <float.h>
+
+namespace ode {
+
+static const int DOPRI_STAGES = 7;
+
+static const double DOPRI_C[7] = { 0, 1.0/5, 3.0/10, 4.0/5, 8.0/9, 1, 1 };
+
+static const double DOPRI_A[7][6] = { { 0 }, { 1.0/5 }, { 3.0/40, 9.0/40 },
+        { 44.0/45, -56.0/15, 32.0/9 },
+        { 19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729 },
+        { 9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656 },
+        { 35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84 } };
+
+// 5th order weights, equal to the last row of DOPRI_A (FSAL)
+static const double DOPRI_B[7] = { 35.0/384, 0, 500.0/1113, 125.0/192,
+        -2187.0/6784, 11.0/84, 0 };
+
+// difference between 5th and embedded 4th order weights
+static const double DOPRI_E[7] = { 71.0/57600, 0, -71.0/16695, 71.0/1920,
+        -17253.0/339200, 22.0/525, -1.0/40 };
+
+// dense output coefficients, see Hairer et al. dopri5.f
+static const double DOPRI_D[7] = { -12715105075.0/11282082432.0, 0,
+        87487479700.0/32700410799.0, -10690763975.0/1880347072.0,
+        701980252875.0/199316789632.0, -1453857185.0/822651844.0,
+        69997945.0/29380423.0 };
+
+// observer called after each accepted step, does nothing.
+struct no_observer {
+    template<class Integrator>
+    void operator()(Integrator &integrator, double t0, double t1) {
+    }
+};
+
+// creates states of a given dimension. Fixed size states (std::array) are
+// stored inline and their dimension is known at compile time, so all loops
+// over the state can be unrolled.
+template<typename State>
+struct state_traits {
+    static State create(int dim) {
+        return State(dim);
+    }
+    static int dim(int dim) {
+        return dim;
+    }
+};
+
+template<size_t N>
+struct state_traits<std::array<double, N>> {
+    static std::array<double, N> create(int) {
+        std::array<double, N> s;
+        s.fill(0);
+        return s;
+    }
+    static constexpr int dim(int) {
+        return N;
+    }
+};
+
+template<typename State = std::vector<double>>
+class Dopri45 {
+
+public:
+
+    // atol, rtol: absolute and relative tolerance of the local error.
+    // hmin, hmax: limits of the absolute step size, hmax <= 0 means no limit.
+    // h0: initial step size, h0 <= 0 means it is estimated from the system.
+    Dopri45(int dim, double atol, double rtol, double hmin, double hmax,
+            double h0) :
+            _dim(dim), _atol(atol), _rtol(rtol), _hmin(fabs(hmin)), _hmax(
+                    hmax > 0 ? hmax : HUGE_VAL), _h(fabs(h0)) {
+        for (int s = 0; s < DOPRI_STAGES; s++)
+            _k[s] = state_traits<State>::create(dim);
+        for (int s = 0; s < 5; s++)
+            _rcont[s] = state_traits<State>::create(dim);
+        _yt = state_traits<State>::create(dim);
+        _ynew = state_traits<State>::create(dim);
+        _steps = 0;
+        _rejected = 0;
+        _evaluations = 0;
+        _fsal = false;
+        _told = 0;
+        _hold = 0;
+    }
+
+    // Integrates y from t to tN, tN < t integrates backwards. Returns false
+    // if the step size falls below hmin or no longer advances t, or if the
+    // error estimate is not finite. Then y and t hold the last accepted state.
+    template<class System>
+    bool integrate(System &sys, State &y, double &t, double tN) {
+        no_observer observer;
+        return integrate(sys, y, t, tN, observer);
+    }
+
+    // as above, observer(*this, t0, t1) is called after each accepted step
+    // from t0 to t1, interpolate can be used for times in between.
+    template<class System, class Observer>
+    bool integrate(System &sys, State &y, double &t, double tN,
+            Observer &observer) {
+        double dir = tN >= t ? 1 : -1;
+        _fsal = false;
+        if (_h <= 0)
+            _h = initialStep(sys, y, t, dir);
+        bool reject = false;
+        while (dir * (tN - t) > 0) {
+            double h = std::min(_h, _hmax);
+            bool last = h >= dir * (tN - t);
+            if (last)
+                h = dir * (tN - t);
+            else if (h <= 16 * DBL_EPSILON * fabs(t))
+                return false;
+            double err = tryStep(sys, y, t, dir * h);
+            if (!std::isfinite(err))
+                return false;
+            double fac = 0.9 * pow(std::max(err, 1E-10), -0.2);
+            if (err <= 1.0) {
+                _steps++;
+                denseOutput(y, dir * h);
+                double t0 = t;
+                t = last ? tN : t + dir * h;
+                _told = t0;
+                _hold = t - t0;
+                std::swap(y, _ynew);
+                std::swap(_k[0], _k[6]); // first same as last
+                _fsal = true;
+                fac = std::min(reject ? 1.0 : 5.0, std::max(0.2, fac));
+                reject = false;
+                // keep the step size if the end point was hit early
+                if (!last || h * fac < _h)
+                    _h = h * fac;
+                observer(*this, t0, t);
+            } else {
+                _rejected++;
+                reject = true;
+                _h = h * std::max(0.2, fac);
+                if (_h < _hmin)
+                    return false;
+            }
+            _h = std::max(_h, _hmin);
+        }
+        return true;
+    }
+
+    int steps() {
+        return _steps;
+    }
+
+    int rejected() {
+        return _rejected;
+    }
+
+    int evaluations() {
+        return _evaluations;
+    }
+
+    double stepSize() {
+        return _h;
+    }
+
+    // state at time t of the last accepted step, 4th order accurate.
+    void interpolate(double t, State &y) const {
+        double theta = _hold == 0 ? 1 : (t - _told) / _hold;
+        double theta1 = 1 - theta;
+        for (int i = 0; i < dim(); i++)
+            y[i] = _rcont[0][i] + theta * (_rcont[1][i] + theta1 * (_rcont[2][i]
+                    + theta * (_rcont[3][i] + theta1 * _rcont[4][i])));
+    }
+
+    // compile time constant for fixed size states
+    int dim() const {
+        return state_traits<State>::dim(_dim);
+    }
+
+private:
+
+    // performs a step of size h, _ynew holds the result, _k[6] the derivative
+    // at _ynew. Returns the normed error estimate, <= 1 means accepted.
+    template<class System>
+    double tryStep(System &sys, const State &y, double t, double h) {
+        if (!_fsal) {
+            sys(y, _k[0], t);
+            _evaluations++;
+            _fsal = true;
+        }
+        for (int s = 1; s < DOPRI_STAGES; s++) {
+            for (int i = 0; i < dim(); i++) {
+                double dy = 0;
+                for (int j = 0; j < s; j++)
+                    dy += DOPRI_A[s][j] * _k[j][i];
+                _yt[i] = y[i] + h * dy;
+            }
+            sys(_yt, _k[s], t + DOPRI_C[s] * h);
+            _evaluations++;
+        }
+        // the last stage was evaluated at the 5th order solution
+        for (int i = 0; i < dim(); i++)
+            _ynew[i] = _yt[i];
+        double err = 0;
+        for (int i = 0; i < dim(); i++) {
+            double e = 0;
+            for (int s = 0; s < DOPRI_STAGES; s++)
+                e += DOPRI_E[s] * _k[s][i];
+            double sc = _atol + _rtol * std::max(fabs(y[i]), fabs(_ynew[i]));
+            e *= h / sc;
+            err += e * e;
+        }
+        return sqrt(err / dim());
+    }
+
+    // coefficients of the continuous extension for the step y -> _ynew,
+    // _k[6] holds the derivative at _ynew.
+    void denseOutput(const State &y, double h) {
+        for (int i = 0; i < dim(); i++) {
+            double ydiff = _ynew[i] - y[i];
+            double bspl = h * _k[0][i] - ydiff;
+            double d = 0;
+            for (int s = 0; s < DOPRI_STAGES; s++)
+                d += DOPRI_D[s] * _k[s][i];
+            _rcont[0][i] = y[i];
+            _rcont[1][i] = ydiff;
+            _rcont[2][i] = bspl;
+            _rcont[3][i] = ydiff - h * _k[6][i] - bspl;
+            _rcont[4][i] = h * d;
+        }
+    }
+
+    // initial step size estimation, see Hairer et al. II.4
+    template<class System>
+    double initialStep(System &sys, const State &y, double t, double dir) {
+        sys(y, _k[0], t);
+        _evaluations++;
+        double d0 = 0, d1 = 0;
+        for (int i = 0; i < dim(); i++) {
+            double sc = _atol + _rtol * fabs(y[i]);
+            d0 += (y[i] / sc) * (y[i] / sc);
+            d1 += (_k[0][i] / sc) * (_k[0][i] / sc);
+        }
+        d0 = sqrt(d0 / dim());
+        d1 = sqrt(d1 / dim());
+        double h0 = (d0 < 1E-5 || d1 < 1E-5) ? 1E-6 : 0.01 * d0 / d1;
+        h0 = std::min(h0, _hmax);
+        for (int i = 0; i < dim(); i++)
+            _yt[i] = y[i] + dir * h0 * _k[0][i];
+        sys(_yt, _k[1], t + dir * h0);
+        _evaluations++;
+        double d2 = 0;
+        for (int i = 0; i < dim(); i++) {
+            double sc = _atol + _rtol * fabs(y[i]);
+            double d = (_k[1][i] - _k[0][i]) / sc;
+            d2 += d * d;
+        }
+        d2 = sqrt(d2 / dim()) / h0;
+        double dm = std::max(d1, d2);
+        double h1 = dm <= 1E-15 ? std::max(1E-6, h0 * 1E-3) :
+                pow(0.01 / dm, 0.2);
+        _fsal = true; // _k[0] holds the derivative at y
+        return std::max(_hmin, std::min(std::min(100 * h0, h1), _hmax));
+    }
+
+    int _dim;
+    double _atol;
+    double _rtol;
+    double _hmin;
+    double _hmax;
+    double _h;
+    State _k[DOPRI_STAGES];
+    State _yt;
+    State _ynew;
+    State _rcont[5];
+    double _told;
+    double _hold;
+    int _steps;
+    int _rejected;
+    int _evaluations;
+    bool _fsal;
+};
+
+// Locates a root of g(t) in [t0, t1] given g0 = g(t0), g1 = g(t1) of
+// opposite sign using the Illinois variant of regula falsi.
+template<class G>
+double findRoot(G &g, double t0, double t1, double g0, double g1, double tol) {
+    int side = 0;
+    double t = t1;
+    for (int iter = 0; iter < 100; iter++) {
+        double tprev = t;
+        t = (t0 * g1 - t1 * g0) / (g1 - g0);
+        if (fabs(t - tprev) <= tol)
+            break;
+        double gt = g(t);
+        if (gt == 0)
+            break;
+        if ((gt > 0) == (g1 > 0)) {
+            t1 = t;
+            g1 = gt;
+            if (side == -1)
+                g0 *= 0.5;
+            side = -1;
+        } else {
+            t0 = t;
+            g0 = gt;
+            if (side == 1)
+                g1 *= 0.5;
+            side = 1;
+        }
+    }
+    return t;
+}
+}
+
+#endif /* DOPRI_HPP_ */
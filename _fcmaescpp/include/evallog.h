@@ -0,0 +1,370 @@
+/*
+ * evallog.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Native evaluation log. Each objective function evaluation performed by a
+// Fitness is appended as fixed width binary record
+//
+//     int64 eval, int64 runid, double x[dim], double y[nobj], double time
+//
+// to a memory mapped file starting with a 64 byte header, see eval_log_header.
+// eval is the 1-based evaluation number of the run, time the wall clock time
+// in seconds since the epoch. Address space for the maximal file size is
+// reserved once, the file itself grows in chunks, so the mapping never moves.
+// Appending threads never lock: a thread reserves a block of BLOCK records by
+// a single atomic add to the slot counter in the shared header and fills it
+// privately. So processes forked after opening the log - or opening it
+// themselves - append to the same log without overwriting each other.
+// Unused slots of the reserved blocks have eval == 0 and are skipped by
+// readers. The file is only grown under a record lock on the header, so
+// processes never shrink it. The process creating the file cuts its unused
+// tail when closing it, if no other process uses the log anymore - each
+// process appending to the log holds a shared record lock on a byte beyond
+// the file. An existing log with the same dim and nobj is continued.
+// Requires mmap, on other platforms creating a log fails.
+
+#ifndef EVALLOG_HPP_
+#define EVALLOG_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define EVAL_LOG_MMAP 1
+#else
+#define EVAL_LOG_MMAP 0
+#endif
+
+struct eval_log_header {
+    char magic[8];
+    int32_t version;
+    int32_t dim;
+    int32_t nobj;
+    int32_t recordSize;
+    // record slots reserved by all processes, including unused ones.
+    int64_t slots;
+    char reserved[32];
+};
+
+static const char EVAL_LOG_MAGIC[8] = { 'F', 'C', 'M', 'A', 'E', 'S', 'L', 'G' };
+
+class eval_log {
+
+public:
+
+    // records reserved by a thread at once.
+    static const int BLOCK = 64;
+    // address space reserved for the file, 256 GB.
+    static const int64_t MAX_BYTES = (int64_t) 1 << 38;
+    // initial file size.
+    static const int64_t MIN_BYTES = (int64_t) 1 << 20;
+    // byte ranges locked by lockFile.
+    static const int HEADER = 0;
+    static const int USERS = 1;
+
+    // opens or creates the log at path, returns null if this fails.
+    static std::shared_ptr<eval_log> create(const char *path, int dim,
+            int nobj) {
+        std::shared_ptr<eval_log> log(new eval_log(dim, nobj));
+        if (!log->open(path))
+            return std::shared_ptr<eval_log>();
+        return log;
+    }
+
+    // log all Fitness instances created afterwards record to, may be null.
+    static std::shared_ptr<eval_log> active() {
+        std::lock_guard<std::mutex> lock(activeMutex());
+        return activeLog();
+    }
+
+    static void setActive(const std::shared_ptr<eval_log> &log) {
+        std::lock_guard<std::mutex> lock(activeMutex());
+        activeLog() = log;
+    }
+
+    ~eval_log() {
+#if EVAL_LOG_MMAP
+        if (_base != NULL) {
+            // cut the unused tail of the last chunk. Forked processes
+            // inherit the log object, they must not cut the file.
+            if (_creator == getpid() && lockFile(F_WRLCK, USERS, false)) {
+                lockFile(F_WRLCK, HEADER);
+                int64_t n = std::min(slots(), fileCapacity());
+                if (ftruncate(_fd, sizeof(eval_log_header) + n * _recordSize)
+                        != 0)
+                    std::cout << "eval_log: truncate failed" << std::endl;
+                lockFile(F_UNLCK, HEADER);
+            }
+            munmap(_base, MAX_BYTES);
+        }
+        if (_fd >= 0)
+            close(_fd);
+#endif
+    }
+
+    void append(int64_t runid, int64_t eval, const double *x,
+            const double *y) {
+        int64_t slot = nextSlot();
+        if (slot < 0)
+            return;
+        char *r = _base + sizeof(eval_log_header) + slot * _recordSize;
+        double t = std::chrono::duration<double>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        memcpy(r + 8, &runid, 8);
+        memcpy(r + 16, x, _dim * sizeof(double));
+        memcpy(r + 16 + _dim * sizeof(double), y, _nobj * sizeof(double));
+        memcpy(r + _recordSize - 8, &t, 8);
+        // eval marks the slot as used, published after the record
+        __atomic_store_n((int64_t*) r, eval, __ATOMIC_RELEASE);
+    }
+
+    int dim() const {
+        return _dim;
+    }
+
+    int nobj() const {
+        return _nobj;
+    }
+
+    // number of record slots reserved by all processes, including unused
+    // ones.
+    int64_t slots() const {
+        return __atomic_load_n(&header()->slots, __ATOMIC_RELAXED);
+    }
+
+    static int recordSize(int dim, int nobj) {
+        return 8 * (3 + dim + nobj);
+    }
+
+private:
+
+    struct thread_block {
+        uint64_t log;
+        uint64_t generation;
+        int64_t next;
+        int64_t end;
+    };
+
+    eval_log(int dim, int nobj) :
+            _dim(dim), _nobj(nobj), _recordSize(recordSize(dim, nobj)), _id(
+                    nextId()), _fd(-1), _creator(-1), _base(NULL), _capacity(
+                    0), _lockedGeneration(0) {
+    }
+
+    eval_log_header* header() const {
+        return (eval_log_header*) _base;
+    }
+
+    bool open(const char *path) {
+#if EVAL_LOG_MMAP
+        _fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (_fd < 0) {
+            std::cout << "eval_log: cannot open " << path << std::endl;
+            return false;
+        }
+        // processes opening the log concurrently see a complete header
+        lockFile(F_WRLCK, HEADER);
+        bool valid = init(path);
+        lockFile(F_UNLCK, HEADER);
+        if (!valid)
+            return false;
+        lockFile(F_RDLCK, USERS);
+        _lockedGeneration = generation().load();
+        void *base = mmap(NULL, MAX_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED,
+                _fd, 0);
+        if (base == MAP_FAILED) {
+            std::cout << "eval_log: mmap failed" << std::endl;
+            return false;
+        }
+        _base = (char*) base;
+        static int atFork = pthread_atfork(NULL, NULL, onFork);
+        (void) atFork;
+        return true;
+#else
+        std::cout << "eval_log: not supported on this platform" << std::endl;
+        return false;
+#endif
+    }
+
+#if EVAL_LOG_MMAP
+    // checks or writes the header, sizes the file. Called holding the file
+    // lock.
+    bool init(const char *path) {
+        struct stat st;
+        fstat(_fd, &st);
+        int64_t size = st.st_size;
+        eval_log_header h;
+        if (size >= (int64_t) sizeof(h)) {
+            if (pread(_fd, &h, sizeof(h), 0) != sizeof(h)
+                    || memcmp(h.magic, EVAL_LOG_MAGIC, 8) != 0 || h.dim != _dim
+                    || h.nobj != _nobj) {
+                std::cout << "eval_log: " << path
+                        << " is no evaluation log of matching dimension"
+                        << std::endl;
+                return false;
+            }
+            if (h.version < 2) { // no slot counter, the file size counts
+                h.version = 2;
+                h.slots = (size - sizeof(h)) / _recordSize;
+                if (pwrite(_fd, &h, sizeof(h), 0) != sizeof(h))
+                    return false;
+            }
+        } else {
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, EVAL_LOG_MAGIC, 8);
+            h.version = 2;
+            h.dim = _dim;
+            h.nobj = _nobj;
+            h.recordSize = _recordSize;
+            if (pwrite(_fd, &h, sizeof(h), 0) != sizeof(h))
+                return false;
+            _creator = getpid();
+        }
+        return grow((std::max(size, MIN_BYTES) - (int64_t) sizeof(h))
+                / _recordSize);
+    }
+
+    // grows the file to hold at least n records, never shrinks it, so
+    // processes sharing the log can't cut each others records. Called
+    // holding the file lock.
+    bool grow(int64_t n) {
+        int64_t capacity = fileCapacity();
+        if (capacity < n) {
+            if (ftruncate(_fd, sizeof(eval_log_header) + n * _recordSize)
+                    != 0)
+                return false;
+            capacity = n;
+        }
+        _capacity = capacity;
+        return true;
+    }
+
+    int64_t fileCapacity() const {
+        struct stat st;
+        fstat(_fd, &st);
+        return (st.st_size - (int64_t) sizeof(eval_log_header)) / _recordSize;
+    }
+
+    // record lock of type F_RDLCK, F_WRLCK or F_UNLCK on byte range HEADER
+    // or USERS for the calling process. Returns false if the lock is held by
+    // another process and wait is false. Threads of a process are excluded
+    // by _growMutex.
+    bool lockFile(short type, int range, bool wait = true) const {
+        struct flock fl;
+        memset(&fl, 0, sizeof(fl));
+        fl.l_type = type;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = range == HEADER ? 0 : MAX_BYTES;
+        fl.l_len = range == HEADER ? sizeof(eval_log_header) : 1;
+        int res;
+        while ((res = fcntl(_fd, wait ? F_SETLKW : F_SETLK, &fl)) != 0
+                && errno == EINTR)
+            ;
+        return res == 0;
+    }
+#endif
+
+    // slot for the next record of the calling thread, -1 if the log is full.
+    // A block reserved before a fork belongs to the parent process.
+    int64_t nextSlot() {
+        static thread_local thread_block tb = { 0, 0, 0, 0 };
+        uint64_t gen = generation().load(std::memory_order_relaxed);
+        if (tb.log != _id || tb.generation != gen || tb.next >= tb.end) {
+#if EVAL_LOG_MMAP
+            if (_lockedGeneration != gen) { // record locks aren't inherited
+                lockFile(F_RDLCK, USERS);
+                _lockedGeneration = gen;
+            }
+#endif
+            int64_t start = __atomic_fetch_add(&header()->slots, BLOCK,
+                    __ATOMIC_RELAXED);
+            if (!ensureCapacity(start + BLOCK))
+                return -1;
+            tb.log = _id;
+            tb.generation = gen;
+            tb.next = start;
+            tb.end = start + BLOCK;
+        }
+        return tb.next++;
+    }
+
+    // grows the file if records < n fit into it, doubles its size.
+    bool ensureCapacity(int64_t n) {
+        if (n <= _capacity.load())
+            return true;
+#if EVAL_LOG_MMAP
+        std::lock_guard<std::mutex> lock(_growMutex);
+        if (n <= _capacity.load())
+            return true;
+        int64_t maxRecords = (MAX_BYTES - (int64_t) sizeof(eval_log_header))
+                / _recordSize;
+        if (n > maxRecords)
+            return false;
+        int64_t capacity = std::max(n, 2 * _capacity.load());
+        if (capacity > maxRecords)
+            capacity = maxRecords;
+        lockFile(F_WRLCK, HEADER);
+        bool grown = grow(capacity);
+        lockFile(F_UNLCK, HEADER);
+        return grown;
+#else
+        return false;
+#endif
+    }
+
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> id(0);
+        return ++id;
+    }
+
+    // incremented in the child process after each fork.
+    static std::atomic<uint64_t>& generation() {
+        static std::atomic<uint64_t> gen(0);
+        return gen;
+    }
+
+    static void onFork() {
+        generation()++;
+    }
+
+    static std::mutex& activeMutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::shared_ptr<eval_log>& activeLog() {
+        static std::shared_ptr<eval_log> log;
+        return log;
+    }
+
+    int _dim;
+    int _nobj;
+    int _recordSize;
+    uint64_t _id;
+    int _fd;
+    // process which created the file, -1 if it existed.
+    long _creator;
+    char *_base;
+    // records fitting into the file, as seen by this process.
+    std::atomic<int64_t> _capacity;
+    // fork generation of this process when it acquired the USERS lock.
+    std::atomic<uint64_t> _lockedGeneration;
+    std::mutex _growMutex;
+};
+
+#endif /* EVALLOG_HPP_ */
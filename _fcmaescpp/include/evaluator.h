@@ -18,11 +18,13 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <memory>
+#include <stdint.h>
 #include <chrono>
 #include <condition_variable>
 
-#define EIGEN_VECTORIZE_SSE2
-#include <EigenRand/EigenRand>
+#include "evallog.h"
+#include "philox.h"
 
 using Clock = std::chrono::steady_clock;
 using std::chrono::time_point;
@@ -90,58 +92,62 @@ static bool noop_callback(int popsize, const double *x, double *y) {
 static void noop_callback_par(int popsize, int dim, double *x, double *y) {
 }
 
-static std::uniform_real_distribution<> distr_01 =
-        std::uniform_real_distribution<>(0, 1);
-
-static std::normal_distribution<> gauss_01 = std::normal_distribution<>(0, 1);
-
-static Eigen::MatrixXd normal(int dx, int dy, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::normal<mat>(dx, dy, rs);
+static Eigen::MatrixXd normal(int dx, int dy, philox &rs) {
+    mat m(dx, dy);
+    rs.fillNormal(m.data(), m.size());
+    return m;
 }
 
-static Eigen::MatrixXd cauchy(int dx, int dy, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::cauchy<mat>(dx, dy, rs);
+static Eigen::MatrixXd cauchy(int dx, int dy, philox &rs) {
+    mat m(dx, dy);
+    rs.fillUniform(m.data(), m.size());
+    return m.unaryExpr([](double u) {
+        return std::tan(M_PI * (u - 0.5));
+    });
 }
 
-static Eigen::MatrixXd studentT(int dx, int dy, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::studentT<mat>(dx, dy, rs);
+// Student's t with one degree of freedom, which is the Cauchy distribution.
+static Eigen::MatrixXd studentT(int dx, int dy, philox &rs) {
+    return cauchy(dx, dy, rs);
 }
 
-static double rand01(Eigen::Rand::P8_mt19937_64 &rs) {
-    return distr_01(rs);
+static double rand01(philox &rs) {
+    return rs.uniform();
 }
 
-static int randInt(Eigen::Rand::P8_mt19937_64 &rs, int max) {
-    return (int) (max * distr_01(rs));
+static int randInt(philox &rs, int max) {
+    return rs.uniformInt(max);
 }
 
-static double normreal(Eigen::Rand::P8_mt19937_64 &rs, double mu, double sdev) {
-    return gauss_01(rs) * sdev + mu;
+static double normreal(philox &rs, double mu, double sdev) {
+    return rs.normal() * sdev + mu;
 }
 
-static Eigen::MatrixXd normalVec(int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::normal<vec>(dim, 1, rs);
+static Eigen::MatrixXd normalVec(int dim, philox &rs) {
+    return normal(dim, 1, rs);
 }
 
-static vec normalVec(const vec &mean, const vec &sdev, int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    vec nv = Eigen::Rand::normal<vec>(dim, 1, rs);
+static vec normalVec(const vec &mean, const vec &sdev, int dim, philox &rs) {
+    vec nv = normal(dim, 1, rs);
     return (nv.array() * sdev.array()).matrix() + mean;
 }
 
-static Eigen::MatrixXd cauchyVec(int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::cauchy<vec>(dim, 1, rs);
+static Eigen::MatrixXd cauchyVec(int dim, philox &rs) {
+    return cauchy(dim, 1, rs);
 }
 
-static Eigen::MatrixXd studentTVec(int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::studentT<vec>(dim, 1, rs);
+static Eigen::MatrixXd studentTVec(int dim, philox &rs) {
+    return studentT(dim, 1, rs);
 }
 
-static Eigen::MatrixXd uniform(int dx, int dy, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::uniformReal<mat>(dx, dy, rs);
+static Eigen::MatrixXd uniform(int dx, int dy, philox &rs) {
+    mat m(dx, dy);
+    rs.fillUniform(m.data(), m.size());
+    return m;
 }
 
-static Eigen::MatrixXd uniformVec(int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::uniformReal<vec>(dim, 1, rs);
+static Eigen::MatrixXd uniformVec(int dim, philox &rs) {
+    return uniform(dim, 1, rs);
 }
 
 static vec zeros(int n) {
@@ -194,6 +200,69 @@ static int index_min(vec &v) {
     return mi;
 }
 
+// population buffer owned by an ask/tell optimizer and shared with the caller,
+// which maps it once (as numpy arrays) and afterwards passes no data across
+// the C interface. xs holds the popsize x dim arguments, row p is solution p
+// (column major dim x popsize in Eigen), ys the popsize x nobj function values.
+// Both blocks start at a cache line boundary.
+
+class pop_buffer {
+
+public:
+
+    // allocates the buffer if its size changed
+    void init(int dim, int popsize, int nobj) {
+        if (_data && dim == _dim && popsize == _popsize && nobj == _nobj)
+            return;
+        _dim = dim;
+        _popsize = popsize;
+        _nobj = nobj;
+        long nx = padded((long) dim * popsize);
+        long ny = padded((long) nobj * popsize);
+        _data.reset(new double[nx + ny + LINE]);
+        _xs = aligned(_data.get());
+        _ys = _xs + nx;
+    }
+
+    double* xs() {
+        return _xs;
+    }
+
+    double* ys() {
+        return _ys;
+    }
+
+    Eigen::Map<mat> X() {
+        return Eigen::Map<mat>(_xs, _dim, _popsize);
+    }
+
+    Eigen::Map<mat> Y() {
+        return Eigen::Map<mat>(_ys, _nobj, _popsize);
+    }
+
+private:
+
+    // doubles per cache line
+    static const int LINE = 8;
+
+    static long padded(long n) {
+        return (n + LINE - 1) / LINE * LINE;
+    }
+
+    static double* aligned(double *p) {
+        uintptr_t a = ((uintptr_t) p + LINE * sizeof(double) - 1)
+                & ~(uintptr_t) (LINE * sizeof(double) - 1);
+        return (double*) a;
+    }
+
+    std::unique_ptr<double[]> _data;
+    double *_xs = NULL;
+    double *_ys = NULL;
+    int _dim = 0;
+    int _popsize = 0;
+    int _nobj = 0;
+};
+
 // wrapper around the fitness function, scales according to boundaries
 
 class Fitness {
@@ -215,6 +284,22 @@ public:
         _normalize = false;
         _terminate = false;
         _dim = dim;
+        _runid = 0;
+        setLog(eval_log::active());
+    }
+
+    // records all evaluations to log, see evallog.h. Ignored if its
+    // dimensions don't match.
+    void setLog(const std::shared_ptr<eval_log> &log) {
+        if (log && (log->dim() != _dim || log->nobj() != _nobj))
+            _log.reset();
+        else
+            _log = log;
+    }
+
+    // run id stored in the evaluation log records.
+    void setRunid(long runid) {
+        _runid = runid;
     }
 
     bool terminate() {
@@ -222,25 +307,25 @@ public:
     }
 
     vec eval(const vec &X) {
-        double res[_nobj];
-        _terminate = _terminate || _func(_dim, X.data(), res);
-        for (int i = 0; i < _nobj; i++) {
-            if (std::isnan(res[i]) || !std::isfinite(res[i]))
-                res[i] = 1E99;
-        }
-        _evaluationCounter++;
-        vec rvec = Eigen::Map<vec, Eigen::Unaligned>(res, _nobj);
-        return rvec;
+        return eval(X.data());
     }
 
+    // after termination was requested the function is no longer called,
+    // 1E99 is returned and neither counted nor logged.
     vec eval(const double *const p) {
         double res[_nobj];
-        _terminate = _terminate || _func(_dim, p, res);
-        for (int i = 0; i < _nobj; i++) {
-            if (std::isnan(res[i]) || !std::isfinite(res[i]))
-                res[i] = 1E99;
+        if (_terminate) {
+            std::fill(res, res + _nobj, 1E99);
+        } else {
+            _terminate = _func(_dim, p, res);
+            for (int i = 0; i < _nobj; i++) {
+                if (std::isnan(res[i]) || !std::isfinite(res[i]))
+                    res[i] = 1E99;
+            }
+            _evaluationCounter++;
+            if (_log)
+                _log->append(_runid, _evaluationCounter, p, res);
         }
-        _evaluationCounter++;
         vec rvec = Eigen::Map<vec, Eigen::Unaligned>(res, _nobj);
         return rvec;
     }
@@ -296,26 +381,26 @@ public:
         return _lower.size() != 0;
     }
 
-    vec sample(Eigen::Rand::P8_mt19937_64 &rs) {
+    vec sample(philox &rs) {
         if (_lower.size() == 0)
             std::cout << "no bounds error" << std::endl;
         vec rv = uniformVec(_dim, rs);
         return (rv.array() * _scale.array()).matrix() + _lower;
     }
 
-    vec sample(Eigen::Rand::P8_mt19937_64 &rs, vec &up, vec &lo) {
+    vec sample(philox &rs, vec &up, vec &lo) {
          vec rv = uniformVec(_dim, rs);
          return (rv.array() * (up - lo).array()).matrix() + lo;
     }
 
-    double sample_i(int i, Eigen::Rand::P8_mt19937_64 &rs) {
+    double sample_i(int i, philox &rs) {
         if (_lower.size() == 0)
             std::cout << "no bounds error" << std::endl;
-        return _lower[i] + _scale[i] * distr_01(rs);
+        return _lower[i] + _scale[i] * rs.uniform();
     }
 
-    double sample_i(int i, Eigen::Rand::P8_mt19937_64 &rs, vec &up, vec &lo) {
-        return lo[i] + (up[i] - lo[i]) * distr_01(rs);
+    double sample_i(int i, philox &rs, vec &up, vec &lo) {
+        return lo[i] + (up[i] - lo[i]) * rs.uniform();
     }
 
     int evaluations() {
@@ -373,6 +458,10 @@ public:
         _func_par(popsize, n, pargs, res);
         for (int p = 0; p < popX.cols(); p++)
             ys[p] = res[p];
+        if (_log)
+            for (int p = 0; p < popsize; p++)
+                _log->append(_runid, _evaluationCounter + p + 1, pargs + p * n,
+                        res + p);
         _evaluationCounter += popsize;
     }
 
@@ -411,6 +500,8 @@ private:
     bool _normalize;
     bool _terminate;
     long _evaluationCounter;
+    long _runid;
+    std::shared_ptr<eval_log> _log;
 };
 
 struct vec_id {
@@ -0,0 +1,52 @@
+/*
+ * kernels.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Hot loops of the optimizers operating on raw column major arrays. They are
+// compiled in kernels.cpp for several instruction sets (x86-64 baseline SSE2,
+// x86-64-v3 AVX2/FMA and x86-64-v4 AVX-512), the variant matching the CPU is
+// selected once when the library is loaded. So the library can be built
+// without -march=native and still runs the hot loops at near native speed on
+// all x86 generations. Other platforms and compilers get a single variant.
+
+#ifndef KERNELS_HPP_
+#define KERNELS_HPP_
+
+namespace kernels {
+
+// xs[:,k] = mean + sigma * B * z[:,k] for k < n, B is dim x dim, z and xs are
+// dim x n.
+void affineSample(int dim, int n, const double *B, const double *z,
+        double sigma, const double *mean, double *xs);
+
+// C = beta * C + A * diag(w) * A^T, C is dim x dim, A is dim x n. Only the
+// lower triangle of C is read and updated.
+void rankUpdate(int dim, int n, double *C, double beta, const double *A,
+        const double *w);
+
+// differential evolution trial vector: x[j] = xb[j] + F * (x1[j] - x2[j]) if
+// u[j] <= CR, else xp[j]. Set u[r] = 0 to force the mutation of variable r.
+void deTrial(int dim, const double *xb, const double *x1, const double *x2,
+        const double *xp, double F, double CR, const double *u, double *x);
+
+// clears mask[i] for all i != index dominated by solution index, weakly
+// dominated solutions included. yt holds the objective values objective
+// major, yt[j * n + i] is objective j of solution i. dom is a work array of
+// size n.
+void clearDominated(int nobj, int n, const double *yt, int index,
+        unsigned char *mask, unsigned char *dom);
+
+// index of the center nearest to q with squared euclidean distance below
+// *best, -1 if there is none. The n centers are stored coordinate major,
+// cs[j * ld + i] is coordinate j of center i. Updates *best.
+int nearestCenter(int qdim, int n, const double *cs, long ld, const double *q,
+        double *best);
+
+// instruction set selected for the kernels: "avx512", "avx2" or "default".
+const char* isa();
+}
+
+#endif /* KERNELS_HPP_ */
@@ -0,0 +1,186 @@
+/*
+ * lambert.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Batch solver for Lambert's problem following D. Izzo: Revisiting Lambert's
+// problem, Celestial Mechanics and Dynamical Astronomy 121 (2015), as
+// implemented by kep_toolbox::lambert_problem.
+// Problems are processed in chunks in structure of arrays layout. All problems
+// of a chunk perform the same Householder iterations until all converged, the
+// time of flight branches (Battin series near the parabola, general formula
+// otherwise) are selected per problem instead of taken, so the inner loops
+// vectorize. Only prograde transfers are computed.
+
+#ifndef LAMBERT_HPP_
+#define LAMBERT_HPP_
+
+#include <cmath>
+#include <algorithm>
+
+namespace lambert {
+
+static const int LAMBERT_CHUNK = 64;
+
+// maximal number of Householder iterations, the initial guesses below
+// usually need less than 5.
+static const int LAMBERT_ITER = 12;
+
+// terms of the hypergeometric series used near the parabola
+static const int LAMBERT_SERIES = 12;
+
+// non dimensional time of flight for Izzo's variable x, lambda and N
+// revolutions.
+inline double x2tof(double x, double lambda, double N) {
+    double E = x * x - 1;
+    double rho = fabs(E);
+    double z = sqrt(1 + lambda * lambda * E);
+    // general formula
+    double y = sqrt(rho);
+    double g = x * z - lambda * E;
+    double dell = acos(std::max(-1.0, std::min(1.0, g))) + N * M_PI;
+    double dhyp = log(std::max(1E-300, y * (z - lambda * x) + g));
+    double d = E < 0 ? dell : dhyp;
+    double tof = (x - lambda * z - d / y) / E;
+    // Battin series, accurate near x = 1
+    double eta = z - lambda * x;
+    double s1 = 0.5 * (1 - lambda - x * eta);
+    double q = 1;
+    double c = 1;
+    for (int j = 0; j < LAMBERT_SERIES; j++) {
+        c *= (3.0 + j) * (1.0 + j) / (2.5 + j) * s1 / (j + 1);
+        q += c;
+    }
+    q *= 4.0 / 3.0;
+    double series = 0.5 * (eta * eta * eta * q + 4 * lambda * eta)
+            + N * M_PI / (rho * y);
+    return fabs(x - 1) < 0.01 ? series : tof;
+}
+
+// Solves n Lambert problems. Problem i transfers from r1[3*i..3*i+2] to
+// r2[3*i..3*i+2] in time tof[i] around a body with gravity parameter mu[i].
+// revs[i] = 0 computes the single revolution transfer, revs[i] = N > 0 the
+// left branch, revs[i] = -N the right branch of the N revolution solutions.
+// The velocities at r1 and r2 are written to v1 and v2, NaN if there is no
+// solution. Returns the number of problems without solution.
+inline int solveBatch(int n, const double *r1, const double *r2,
+        const double *tof, const double *mu, const int *revs, double *v1,
+        double *v2) {
+    const int C = LAMBERT_CHUNK;
+    double lam[C], T[C], x[C], N[C];
+    double ir1[3][C], ir2[3][C], it1[3][C], it2[3][C];
+    double R1[C], R2[C], gam[C], rho[C], sig[C];
+    bool ok[C];
+    int failed = 0;
+    for (int i0 = 0; i0 < n; i0 += C) {
+        int m = std::min(C, n - i0);
+        // geometry and initial guess
+        for (int j = 0; j < m; j++) {
+            const double *p1 = r1 + 3 * (i0 + j);
+            const double *p2 = r2 + 3 * (i0 + j);
+            double c0 = p2[0] - p1[0], c1 = p2[1] - p1[1], c2 = p2[2] - p1[2];
+            double cn = sqrt(c0 * c0 + c1 * c1 + c2 * c2);
+            R1[j] = sqrt(p1[0] * p1[0] + p1[1] * p1[1] + p1[2] * p1[2]);
+            R2[j] = sqrt(p2[0] * p2[0] + p2[1] * p2[1] + p2[2] * p2[2]);
+            double s = 0.5 * (cn + R1[j] + R2[j]);
+            for (int k = 0; k < 3; k++) {
+                ir1[k][j] = p1[k] / R1[j];
+                ir2[k][j] = p2[k] / R2[j];
+            }
+            double h0 = ir1[1][j] * ir2[2][j] - ir1[2][j] * ir2[1][j];
+            double h1 = ir1[2][j] * ir2[0][j] - ir1[0][j] * ir2[2][j];
+            double h2 = ir1[0][j] * ir2[1][j] - ir1[1][j] * ir2[0][j];
+            double hn = sqrt(h0 * h0 + h1 * h1 + h2 * h2);
+            // transfer angle > pi for prograde motion if h points south
+            double sgn = h2 < 0 ? -1 : 1;
+            h0 *= sgn / hn;
+            h1 *= sgn / hn;
+            h2 *= sgn / hn;
+            it1[0][j] = h1 * ir1[2][j] - h2 * ir1[1][j];
+            it1[1][j] = h2 * ir1[0][j] - h0 * ir1[2][j];
+            it1[2][j] = h0 * ir1[1][j] - h1 * ir1[0][j];
+            it2[0][j] = h1 * ir2[2][j] - h2 * ir2[1][j];
+            it2[1][j] = h2 * ir2[0][j] - h0 * ir2[2][j];
+            it2[2][j] = h0 * ir2[1][j] - h1 * ir2[0][j];
+            double l = sgn * sqrt(std::max(0.0, 1 - cn / s));
+            lam[j] = l;
+            T[j] = sqrt(2 * mu[i0 + j] / (s * s * s)) * tof[i0 + j];
+            gam[j] = sqrt(0.5 * mu[i0 + j] * s);
+            rho[j] = (R1[j] - R2[j]) / cn;
+            sig[j] = sqrt(std::max(0.0, 1 - rho[j] * rho[j]));
+            int rv = revs[i0 + j];
+            N[j] = abs(rv);
+            double t = T[j];
+            if (rv == 0) {
+                double T0 = acos(l) + l * sqrt(1 - l * l);
+                double T1 = 2.0 / 3.0 * (1 - l * l * l);
+                if (t >= T0)
+                    x[j] = pow(T0 / t, 2.0 / 3.0) - 1;
+                else if (t < T1)
+                    x[j] = 2.5 * T1 / t * (T1 - t) / (1 - pow(l, 5)) + 1;
+                else
+                    x[j] = pow(T0 / t, log2(T1 / T0)) - 1;
+            } else {
+                double tmp = rv > 0 ? pow((N[j] * M_PI + M_PI) / (8 * t), 2.0 / 3.0) :
+                        pow(8 * t / (N[j] * M_PI), 2.0 / 3.0);
+                x[j] = (tmp - 1) / (tmp + 1);
+            }
+        }
+        // Householder iterations until all problems of the chunk converged
+        for (int it = 0; it < LAMBERT_ITER; it++) {
+            double dmax = 0;
+            for (int j = 0; j < m; j++) {
+                double xj = x[j];
+                double l = lam[j];
+                double tt = x2tof(xj, l, N[j]);
+                double l2 = l * l;
+                double l3 = l2 * l;
+                double umx2 = 1 - xj * xj;
+                double y = sqrt(1 - l2 * umx2);
+                double y3 = y * y * y;
+                double dT = (3 * tt * xj - 2 + 2 * l3 * xj / y) / umx2;
+                double ddT = (3 * tt + 5 * xj * dT + 2 * (1 - l2) * l3 / y3)
+                        / umx2;
+                double dddT = (7 * xj * ddT + 8 * dT
+                        - 6 * (1 - l2) * l2 * l3 * xj / (y3 * y * y)) / umx2;
+                double delta = tt - T[j];
+                double xn = xj - delta * (dT * dT - 0.5 * delta * ddT)
+                        / (dT * (dT * dT - delta * ddT) + dddT * delta * delta / 6);
+                // freeze degenerate problems and multiple revolution problems
+                // leaving the ellipse, these have no solution
+                bool valid = xn == xn && fabs(xn) < (N[j] > 0 ? 1 : HUGE_VAL);
+                xn = valid ? xn : xj;
+                dmax = std::max(dmax, fabs(xn - xj));
+                x[j] = xn;
+            }
+            if (dmax < 1E-13)
+                break;
+        }
+        // velocities
+        for (int j = 0; j < m; j++) {
+            double xj = x[j];
+            double l = lam[j];
+            double tt = x2tof(xj, l, N[j]);
+            ok[j] = fabs(tt - T[j]) <= 1E-8 * T[j] && (N[j] == 0 || fabs(xj) < 1);
+            double y = sqrt(1 - l * l + l * l * xj * xj);
+            double vr1 = gam[j] * ((l * y - xj) - rho[j] * (l * y + xj)) / R1[j];
+            double vr2 = -gam[j] * ((l * y - xj) + rho[j] * (l * y + xj)) / R2[j];
+            double vt = gam[j] * sig[j] * (y + l * xj);
+            double *w1 = v1 + 3 * (i0 + j);
+            double *w2 = v2 + 3 * (i0 + j);
+            for (int k = 0; k < 3; k++) {
+                w1[k] = ok[j] ? vr1 * ir1[k][j] + vt / R1[j] * it1[k][j] : NAN;
+                w2[k] = ok[j] ? vr2 * ir2[k][j] + vt / R2[j] * it2[k][j] : NAN;
+            }
+        }
+        for (int j = 0; j < m; j++)
+            if (!ok[j])
+                failed++;
+    }
+    return failed;
+}
+}
+
+#endif /* LAMBERT_HPP_ */
@@ -0,0 +1,193 @@
+/*
+ * parallel.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Shared worker pool for independent native jobs like batch trajectory
+// propagation. The pool is created once on first use with cores - 1 threads,
+// the calling thread always takes part in the work, so a single call uses at
+// most all cores. Calls made while a thread already works for the pool are
+// executed inline. Concurrent callers, for instance the worker threads of
+// evaluator.h, share the cores with the pool threads: the number of callers
+// working inside parallel_for plus busy pool threads never exceeds the
+// number of cores. A caller finding all cores busy waits, pool threads leave
+// their job between two items while callers are waiting.
+
+#ifndef PARALLEL_HPP_
+#define PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+class thread_pool {
+
+public:
+
+    static thread_pool& instance() {
+        static thread_pool pool(std::thread::hardware_concurrency());
+        return pool;
+    }
+
+    ~thread_pool() {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _not_empty.notify_all();
+        for (auto &t : _threads)
+            if (t.joinable())
+                t.join();
+    }
+
+    int size() {
+        return (int) _threads.size();
+    }
+
+    // true if called from one of the pool threads.
+    static bool inside() {
+        return in_pool();
+    }
+
+    // Executes f(i) for all i in [0, n). Uses at most workers threads
+    // including the caller, workers <= 0 means all cores.
+    void parallel_for(int n, int workers, const std::function<void(int)> &f) {
+        if (n <= 0)
+            return;
+        if (workers <= 0 || workers > size() + 1)
+            workers = size() + 1;
+        if (workers > n)
+            workers = n;
+        if (workers <= 1 || in_pool()) {
+            for (int i = 0; i < n; i++)
+                f(i);
+            return;
+        }
+        std::shared_ptr<job> jb(new job(n, f));
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _waiting++;
+            while (_callers + _busy >= _cores)
+                _not_empty.wait(lock);
+            _waiting--;
+            _callers++;
+            for (int w = 1; w < workers; w++)
+                _tasks.push_back(jb);
+        }
+        _not_empty.notify_all();
+        in_pool() = true; // nested calls of f are executed inline
+        jb->run();
+        in_pool() = false;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _callers--;
+        }
+        _not_empty.notify_all();
+        jb->wait();
+    }
+
+private:
+
+    class job {
+
+    public:
+        job(int n, const std::function<void(int)> &f) :
+                _n(n), _f(f), _next(0), _done(0) {
+        }
+
+        // executes items until all are taken or leave() returns true.
+        void run(const std::function<bool()> &leave = nullptr) {
+            int i;
+            int finished = 0;
+            while (!(leave && leave()) && (i = _next++) < _n) {
+                try {
+                    _f(i);
+                } catch (std::exception &e) {
+                    std::cout << e.what() << std::endl;
+                }
+                finished++;
+            }
+            if (finished > 0 && (_done += finished) == _n) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _finished.notify_all();
+            }
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_done < _n)
+                _finished.wait(lock);
+        }
+
+    private:
+        int _n;
+        std::function<void(int)> _f;
+        std::atomic<int> _next;
+        std::atomic<int> _done;
+        std::mutex _mutex;
+        std::condition_variable _finished;
+    };
+
+    thread_pool(int cores) :
+            _stop(false), _cores(std::max(1, cores)), _waiting(0), _callers(
+                    0), _busy(0) {
+        for (int i = 0; i < _cores - 1; i++)
+            _threads.push_back(std::thread(&thread_pool::execute, this));
+    }
+
+    static bool& in_pool() {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    void execute() {
+        in_pool() = true;
+        while (true) {
+            std::shared_ptr<job> jb;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                while (!_stop && (_tasks.empty() || _waiting > 0
+                        || _callers + _busy >= _cores))
+                    _not_empty.wait(lock);
+                if (_stop)
+                    return;
+                jb = _tasks.front();
+                _tasks.pop_front();
+                _busy++;
+            }
+            jb->run([this] {
+                return _waiting > 0;
+            });
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _busy--;
+            }
+            _not_empty.notify_all();
+        }
+    }
+
+    bool _stop;
+    int _cores;
+    // callers waiting for a free core, modified holding _mutex.
+    std::atomic<int> _waiting;
+    // threads inside parallel_for which are not pool threads, modified
+    // holding _mutex.
+    std::atomic<int> _callers;
+    // pool threads working on a job, modified holding _mutex.
+    std::atomic<int> _busy;
+    std::vector<std::thread> _threads;
+    std::deque<std::shared_ptr<job>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _not_empty;
+};
+
+#endif /* PARALLEL_HPP_ */
@@ -0,0 +1,207 @@
+/*
+ * philox.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Counter based random number generator Philox4x32-10, see
+// Salmon et al., Parallel random numbers: as easy as 1, 2, 3, SC11.
+// A block of four random 32 bit words is a stateless function of the key and
+// a 128 bit counter composed of the block index and a stream id:
+// philox::block(key, index, stream). An instance holds only key, stream, the
+// next block index and a small buffer - no heap allocation, cheap to copy.
+// substream(id) derives an independent stream, for instance per thread or per
+// candidate, without synchronization. Values drawn from a substream don't
+// depend on thread scheduling.
+// fillUniform and fillNormal generate LANES blocks at once, the compiler
+// vectorizes these loops.
+
+#ifndef PHILOX_HPP_
+#define PHILOX_HPP_
+
+#include <cmath>
+#include <stddef.h>
+#include <stdint.h>
+
+class philox {
+
+public:
+
+    typedef uint64_t result_type;
+
+    // blocks generated at once by the bulk fills.
+    static const int LANES = 8;
+
+    explicit philox(uint64_t seed = 0, uint64_t stream = 0) :
+            _key(seed), _stream(stream), _index(0), _avail(0), _hasNormal(
+                    false), _normal(0) {
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return ~(result_type) 0;
+    }
+
+    // block index of stream, 4 random words are written to out.
+    static void block(uint64_t key, uint64_t index, uint64_t stream,
+            uint32_t *out) {
+        uint32_t c0 = (uint32_t) index, c1 = (uint32_t) (index >> 32);
+        uint32_t c2 = (uint32_t) stream, c3 = (uint32_t) (stream >> 32);
+        uint32_t k0 = (uint32_t) key, k1 = (uint32_t) (key >> 32);
+        for (int r = 0; r < ROUNDS; r++) {
+            round(c0, c1, c2, c3, k0, k1);
+            k0 += W0;
+            k1 += W1;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+
+    // independent stream identified by id, doesn't change this generator.
+    philox substream(uint64_t id) const {
+        uint32_t w[4];
+        block(_key ^ SUBSTREAM_KEY, id, _stream, w);
+        return philox(join(w[0], w[1]), join(w[2], w[3]));
+    }
+
+    // random 64 bit word.
+    result_type operator()() {
+        if (_avail == 0) {
+            uint32_t w[4];
+            block(_key, _index++, _stream, w);
+            _buf[0] = join(w[2], w[3]);
+            _buf[1] = join(w[0], w[1]);
+            _avail = 2;
+        }
+        return _buf[--_avail];
+    }
+
+    // uniform in [0, 1).
+    double uniform() {
+        return toUnit((*this)());
+    }
+
+    // uniform in {0, ..., max - 1}.
+    int uniformInt(int max) {
+        return (int) (max * uniform());
+    }
+
+    // standard normal distributed.
+    double normal() {
+        if (_hasNormal) {
+            _hasNormal = false;
+            return _normal;
+        }
+        double z0, z1;
+        boxMuller((*this)(), (*this)(), z0, z1);
+        _normal = z1;
+        _hasNormal = true;
+        return z0;
+    }
+
+    // fills out with n uniform values in [0, 1).
+    void fillUniform(double *out, size_t n) {
+        uint64_t w[2 * LANES];
+        while (n > 0) {
+            blocks(w);
+            size_t m = n < 2 * LANES ? n : 2 * LANES;
+            for (size_t i = 0; i < m; i++)
+                out[i] = toUnit(w[i]);
+            out += m;
+            n -= m;
+        }
+    }
+
+    // fills out with n standard normal values.
+    void fillNormal(double *out, size_t n) {
+        uint64_t w[2 * LANES];
+        double z[2 * LANES];
+        while (n > 0) {
+            blocks(w);
+            for (int i = 0; i < LANES; i++)
+                boxMuller(w[2 * i], w[2 * i + 1], z[i], z[i + LANES]);
+            size_t m = n < 2 * LANES ? n : 2 * LANES;
+            for (size_t i = 0; i < m; i++)
+                out[i] = z[i];
+            out += m;
+            n -= m;
+        }
+    }
+
+private:
+
+    static const int ROUNDS = 10;
+    static const uint32_t M0 = 0xD2511F53;
+    static const uint32_t M1 = 0xCD9E8D57;
+    static const uint32_t W0 = 0x9E3779B9;
+    static const uint32_t W1 = 0xBB67AE85;
+    static const uint64_t SUBSTREAM_KEY = 0x5851F42D4C957F2DULL;
+
+    static void round(uint32_t &c0, uint32_t &c1, uint32_t &c2, uint32_t &c3,
+            uint32_t k0, uint32_t k1) {
+        uint64_t p0 = (uint64_t) M0 * c0;
+        uint64_t p1 = (uint64_t) M1 * c2;
+        uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t) p1;
+        c3 = (uint32_t) p0;
+        c0 = n0;
+        c2 = n2;
+    }
+
+    static uint64_t join(uint32_t lo, uint32_t hi) {
+        return ((uint64_t) hi << 32) | lo;
+    }
+
+    static double toUnit(uint64_t w) {
+        return (w >> 11) * 0x1.0p-53;
+    }
+
+    static void boxMuller(uint64_t w0, uint64_t w1, double &z0, double &z1) {
+        double u = ((w0 >> 11) + 1) * 0x1.0p-53; // (0, 1]
+        double r = std::sqrt(-2.0 * std::log(u));
+        double a = 2.0 * M_PI * toUnit(w1);
+        z0 = r * std::cos(a);
+        z1 = r * std::sin(a);
+    }
+
+    // the next LANES blocks as 2 * LANES words, block i is block(key, index + i, stream).
+    void blocks(uint64_t *w) {
+        uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+        for (int i = 0; i < LANES; i++) {
+            uint64_t index = _index + i;
+            c0[i] = (uint32_t) index;
+            c1[i] = (uint32_t) (index >> 32);
+            c2[i] = (uint32_t) _stream;
+            c3[i] = (uint32_t) (_stream >> 32);
+        }
+        uint32_t k0 = (uint32_t) _key, k1 = (uint32_t) (_key >> 32);
+        for (int r = 0; r < ROUNDS; r++) {
+            for (int i = 0; i < LANES; i++)
+                round(c0[i], c1[i], c2[i], c3[i], k0, k1);
+            k0 += W0;
+            k1 += W1;
+        }
+        for (int i = 0; i < LANES; i++) {
+            w[2 * i] = join(c0[i], c1[i]);
+            w[2 * i + 1] = join(c2[i], c3[i]);
+        }
+        _index += LANES;
+    }
+
+    uint64_t _key;
+    uint64_t _stream;
+    uint64_t _index;
+    uint64_t _buf[2];
+    int _avail;
+    bool _hasNormal;
+    double _normal;
+};
+
+#endif /* PHILOX_HPP_ */
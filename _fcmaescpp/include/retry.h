@@ -0,0 +1,152 @@
+/*
+ * retry.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Native parallel optimization retry, the C++ counterpart of fcmaes/retry.py.
+// retry_config selects the optimizer and its parameters, it is passed by
+// pointer from Python as ctypes Structure with the same field order.
+// retry_store collects the results of the runs like retry.Store: at most
+// capacity solutions, if full it is sorted and only the 90% best are kept.
+// It also maintains the mean and standard deviation of all results below
+// the value limit.
+
+#ifndef RETRY_HPP_
+#define RETRY_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <float.h>
+#include <mutex>
+#include <vector>
+
+enum retry_optimizer {
+    RETRY_DE = 0, // differential evolution
+    RETRY_ACMA = 1, // active CMA-ES
+    RETRY_DE_ACMA = 2, // sequence DE -> CMA-ES, default of retry.py
+    RETRY_BITE = 3, // BiteOpt
+};
+
+struct retry_config {
+    int optimizer; // retry_optimizer
+    int numRetries;
+    int maxEvals; // per run
+    int popsize;
+    double stopFitness; // all runs are stopped if reached
+    double valueLimit; // only results below are stored
+    int capacity;
+    int workers; // <= 0 means all cores
+    long seed;
+};
+
+class retry_store {
+
+public:
+
+    retry_store(int dim, int capacity) :
+            _dim(dim), _capacity(std::max(2, capacity)), _stored(0), _evals(
+                    0), _runs(0), _statRuns(0), _mean(0), _qmean(0), _bestY(
+                    DBL_MAX), _xs(_capacity * dim), _ys(_capacity), _bestX(
+                    dim) {
+    }
+
+    // registers the result of a run.
+    void add(double y, const double *x, long evals, double limit) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _evals += evals;
+        _runs++;
+        if (!(y < limit))
+            return;
+        _statRuns++;
+        if (y < _bestY) {
+            _bestY = y;
+            std::copy(x, x + _dim, _bestX.begin());
+        }
+        if (_stored >= _capacity - 1)
+            sort();
+        double diff = std::min(1E20, y - _mean); // avoid overflow
+        _qmean += (_statRuns - 1.0) / _statRuns * diff * diff;
+        _mean += diff / _statRuns;
+        _ys[_stored] = y;
+        std::copy(x, x + _dim, _xs.begin() + (long) _stored * _dim);
+        _stored++;
+    }
+
+    // sorts all entries, keeps only the 90% best to make room for new ones.
+    int sort() {
+        std::vector<int> idx(_stored);
+        for (int i = 0; i < _stored; i++)
+            idx[i] = i;
+        std::stable_sort(idx.begin(), idx.end(), [this](int i, int j) {
+            return _ys[i] < _ys[j];
+        });
+        int keep = std::min(_stored, (int) (0.9 * _capacity));
+        std::vector<double> xs(_xs.size()), ys(_ys.size());
+        for (int i = 0; i < keep; i++) {
+            ys[i] = _ys[idx[i]];
+            std::copy(_xs.begin() + (long) idx[i] * _dim,
+                    _xs.begin() + (long) (idx[i] + 1) * _dim,
+                    xs.begin() + (long) i * _dim);
+        }
+        _xs.swap(xs);
+        _ys.swap(ys);
+        _stored = keep;
+        return keep;
+    }
+
+    int stored() const {
+        return _stored;
+    }
+
+    const double* xs() const {
+        return _xs.data();
+    }
+
+    const double* ys() const {
+        return _ys.data();
+    }
+
+    double bestY() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bestY;
+    }
+
+    const double* bestX() const {
+        return _bestX.data();
+    }
+
+    long evals() const {
+        return _evals;
+    }
+
+    int runs() const {
+        return _runs;
+    }
+
+    double mean() const {
+        return _mean;
+    }
+
+    double sdev() const {
+        return _statRuns <= 0 ? 0 : std::sqrt(_qmean / _statRuns);
+    }
+
+private:
+    int _dim;
+    int _capacity;
+    int _stored;
+    long _evals;
+    int _runs;
+    int _statRuns;
+    double _mean;
+    double _qmean;
+    double _bestY;
+    std::vector<double> _xs;
+    std::vector<double> _ys;
+    std::vector<double> _bestX;
+    std::mutex _mutex;
+};
+
+#endif /* RETRY_HPP_ */
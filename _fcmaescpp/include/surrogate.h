@@ -0,0 +1,235 @@
+/*
+ * surrogate.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Quadratic surrogate model used to pre-screen candidates of expensive
+// objective functions: an optimizer generates factor * popsize candidates,
+// only the popsize with the best predicted values are evaluated.
+//
+// The model is fitted in local coordinates z = (x - center) / scale, set by
+// the optimizer each generation, for instance the CMA mean and its
+// coordinate wise standard deviations. It is trained incrementally: each
+// evaluated point adds its feature vector phi(z) to the normal equations
+// G = sum(phi phi^T), b = sum(phi y), O(features^2), older points are
+// down weighted by the forgetting factor. Moving to new coordinates is an
+// affine map of z, which maps the quadratic features linearly, phi' = T phi
+// with at most four entries per row of T. So G and b are transformed in
+// O(features^2) instead of being rebuilt from an archive.
+// Features are all monomials up to degree 2 if there are at most
+// MAX_FULL_FEATURES of them (dim <= 43), else 1, z_i and z_i^2.
+// The weights are computed by a ridge regularized LDLT solve, once per
+// generation.
+
+#ifndef SURROGATE_HPP_
+#define SURROGATE_HPP_
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class surrogate {
+
+public:
+
+    static const int MAX_FULL_FEATURES = 1000;
+
+    // dim variables, nobj objectives followed by ncon constraints, feasible
+    // if <= 0. forgetting in (0, 1] is the weight factor applied to older
+    // points for each new one.
+    surrogate(int dim, int nobj, int ncon, double forgetting) :
+            _dim(dim), _nobj(nobj), _ncon(ncon), _forgetting(forgetting), _updates(
+                    0), _fitted(false) {
+        _full = (dim + 1) * (dim + 2) / 2 <= MAX_FULL_FEATURES;
+        _nfeat = _full ? (dim + 1) * (dim + 2) / 2 : 1 + 2 * dim;
+        _G = Eigen::MatrixXd::Zero(_nfeat, _nfeat);
+        _b = Eigen::MatrixXd::Zero(_nfeat, nobj + ncon);
+        _center = Eigen::VectorXd::Zero(dim);
+        _scale = Eigen::VectorXd::Ones(dim);
+    }
+
+    int features() const {
+        return _nfeat;
+    }
+
+    // enough points to determine at least the linear part of the model.
+    bool ready() const {
+        return _updates >= std::min(_nfeat, 2 * (_dim + 1));
+    }
+
+    // moves the model to coordinates z = (x - center) / scale.
+    void setCoordinates(const Eigen::VectorXd &center,
+            const Eigen::VectorXd &scale) {
+        Eigen::VectorXd s = scale.cwiseMax(1E-300);
+        if (_updates > 0) {
+            // z' = a * z + d
+            Eigen::VectorXd a = _scale.cwiseQuotient(s);
+            Eigen::VectorXd d = (_center - center).cwiseQuotient(s);
+            transform(a, d);
+        }
+        _center = center;
+        _scale = s;
+        _fitted = false;
+    }
+
+    // adds an evaluated point, ys holds nobj + ncon values.
+    void update(const Eigen::VectorXd &x, const Eigen::VectorXd &y) {
+        for (int i = 0; i < y.size(); i++)
+            if (!std::isfinite(y[i]) || std::abs(y[i]) >= 1E99)
+                return;
+        Eigen::VectorXd phi = features(x);
+        _G *= _forgetting;
+        _b *= _forgetting;
+        _G.selfadjointView<Eigen::Lower>().rankUpdate(phi);
+        _b += phi * y.transpose();
+        _updates++;
+        _fitted = false;
+    }
+
+    // predicted values of x, nobj + ncon.
+    Eigen::VectorXd predict(const Eigen::VectorXd &x) {
+        fit();
+        return _w.transpose() * features(x);
+    }
+
+    // indices of the k of the candidates xs (columns) with the best predicted
+    // values: for a single objective the lowest, for multiple objectives the
+    // least dominated. Candidates predicted to violate constraints come last.
+    std::vector<int> select(const Eigen::MatrixXd &xs, int k) {
+        int n = xs.cols();
+        Eigen::MatrixXd ys(_nobj + _ncon, n);
+        for (int i = 0; i < n; i++)
+            ys.col(i) = predict(xs.col(i));
+        std::vector<double> violation(n, 0), rank(n, 0);
+        for (int i = 0; i < n; i++) {
+            for (int c = 0; c < _ncon; c++)
+                violation[i] += std::max(0.0, ys(_nobj + c, i));
+            if (_nobj == 1)
+                rank[i] = ys(0, i);
+            else
+                for (int j = 0; j < n; j++)
+                    if (j != i && dominates(ys.col(j), ys.col(i)))
+                        rank[i]++;
+        }
+        std::vector<int> idx(n);
+        for (int i = 0; i < n; i++)
+            idx[i] = i;
+        std::stable_sort(idx.begin(), idx.end(), [&](int i, int j) {
+            return violation[i] < violation[j]
+                    || (violation[i] == violation[j] && rank[i] < rank[j]);
+        });
+        idx.resize(std::min(k, n));
+        return idx;
+    }
+
+private:
+
+    Eigen::VectorXd features(const Eigen::VectorXd &x) const {
+        Eigen::VectorXd z = (x - _center).cwiseQuotient(_scale);
+        Eigen::VectorXd phi(_nfeat);
+        phi[0] = 1;
+        phi.segment(1, _dim) = z;
+        int f = _dim + 1;
+        if (_full) {
+            for (int i = 0; i < _dim; i++)
+                for (int j = i; j < _dim; j++)
+                    phi[f++] = z[i] * z[j];
+        } else
+            phi.tail(_dim) = z.cwiseProduct(z);
+        return phi;
+    }
+
+    bool dominates(const Eigen::VectorXd &a, const Eigen::VectorXd &b) const {
+        bool better = false;
+        for (int i = 0; i < _nobj; i++) {
+            if (a[i] > b[i])
+                return false;
+            better |= a[i] < b[i];
+        }
+        return better;
+    }
+
+    // applies z' = a * z + d to G and b: phi(z') = T phi(z),
+    // G' = T G T^T, b' = T b. T has at most four entries per row.
+    void transform(const Eigen::VectorXd &a, const Eigen::VectorXd &d) {
+        std::vector<int> start(_nfeat + 1), col;
+        std::vector<double> val;
+        int row = 0;
+        // constant
+        start[row++] = 0;
+        col.push_back(0);
+        val.push_back(1);
+        // z'_i = a_i z_i + d_i
+        for (int i = 0; i < _dim; i++) {
+            start[row++] = col.size();
+            col.push_back(0);
+            val.push_back(d[i]);
+            col.push_back(1 + i);
+            val.push_back(a[i]);
+        }
+        // z'_i z'_j = a_i a_j z_i z_j + a_i d_j z_i + d_i a_j z_j + d_i d_j
+        int f = _dim + 1;
+        for (int i = 0; i < _dim; i++)
+            for (int j = i; j < (_full ? _dim : i + 1); j++) {
+                start[row++] = col.size();
+                col.push_back(0);
+                val.push_back(d[i] * d[j]);
+                col.push_back(1 + i);
+                val.push_back(a[i] * d[j]);
+                col.push_back(1 + j);
+                val.push_back(d[i] * a[j]);
+                col.push_back(f++);
+                val.push_back(a[i] * a[j]);
+            }
+        start[row] = col.size();
+        for (int j = 1; j < _nfeat; j++)
+            for (int i = 0; i < j; i++)
+                _G(i, j) = _G(j, i);
+        // H = T G
+        Eigen::MatrixXd H = Eigen::MatrixXd::Zero(_nfeat, _nfeat);
+        Eigen::MatrixXd b = Eigen::MatrixXd::Zero(_nfeat, _b.cols());
+        for (int r = 0; r < _nfeat; r++)
+            for (int e = start[r]; e < start[r + 1]; e++) {
+                H.row(r) += val[e] * _G.row(col[e]);
+                b.row(r) += val[e] * _b.row(col[e]);
+            }
+        // G = H T^T
+        _G.setZero();
+        for (int r = 0; r < _nfeat; r++)
+            for (int e = start[r]; e < start[r + 1]; e++)
+                _G.col(r) += val[e] * H.col(col[e]);
+        _b = b;
+    }
+
+    // ridge regularized least squares weights.
+    void fit() {
+        if (_fitted)
+            return;
+        Eigen::MatrixXd A = _G.selfadjointView<Eigen::Lower>();
+        double ridge = 1E-8 * std::max(1E-300, A.diagonal().maxCoeff()) + 1E-12;
+        A.diagonal().array() += ridge;
+        _w = A.ldlt().solve(_b);
+        _fitted = true;
+    }
+
+    int _dim;
+    int _nobj;
+    int _ncon;
+    double _forgetting;
+    int _updates;
+    bool _fitted;
+    bool _full;
+    int _nfeat;
+    // lower triangle of the normal equations matrix.
+    Eigen::MatrixXd _G;
+    Eigen::MatrixXd _b;
+    Eigen::MatrixXd _w;
+    Eigen::VectorXd _center;
+    Eigen::VectorXd _scale;
+};
+
+#endif /* SURROGATE_HPP_ */
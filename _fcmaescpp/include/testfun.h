@@ -0,0 +1,276 @@
+/*
+ * testfun.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dietmar Wolz
+ */
+
+// Single and multi objective test functions used to benchmark the optimizers
+// natively, without Python and ctypes overhead.
+// Single objective: sphere, ellipsoid, Rosenbrock, Rastrigin, Ackley, as
+// defined in fcmaes/testfun.py.
+// Multi objective: ZDT1-6, see E. Zitzler, K. Deb, L. Thiele: Comparison of
+// Multiobjective Evolutionary Algorithms: Empirical Results, Evolutionary
+// Computation 8 (2000) and DTLZ1-7, see K. Deb, L. Thiele, M. Laumanns,
+// E. Zitzler: Scalable Test Problems for Evolutionary Multiobjective
+// Optimization (2005). ZDT5 is defined on bit strings, here a variable >= 0.5
+// is interpreted as bit set.
+// Sums are accumulated in SUM_LANES independent partial sums, so the loops
+// vectorize without reassociating floating point operations.
+
+#ifndef TESTFUN_HPP_
+#define TESTFUN_HPP_
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace testfun {
+
+static const int SUM_LANES = 4;
+
+// sum of g(x[i]) over i in [from, to)
+template<class G>
+inline double sum(const double *x, int from, int to, G g) {
+    double acc[SUM_LANES] = { 0 };
+    int i = from;
+    for (; i + SUM_LANES <= to; i += SUM_LANES)
+        for (int k = 0; k < SUM_LANES; k++)
+            acc[k] += g(x[i + k]);
+    double s = 0;
+    for (; i < to; i++)
+        s += g(x[i]);
+    for (int k = 0; k < SUM_LANES; k++)
+        s += acc[k];
+    return s;
+}
+
+// single objective
+
+inline double sphere(int dim, const double *x) {
+    return sum(x, 0, dim, [](double xi) {
+        return xi * xi;
+    });
+}
+
+// weights 1e6^(i/(dim-1)) of the ellipsoid.
+inline void elliWeights(int dim, std::vector<double> &w) {
+    w.resize(dim);
+    double step = dim > 1 ? log(1E6) / (dim - 1) : 0;
+    for (int i = 0; i < dim; i++)
+        w[i] = exp(step * i);
+}
+
+inline double elli(int dim, const double *x, const double *w) {
+    double acc[SUM_LANES] = { 0 };
+    int i = 0;
+    for (; i + SUM_LANES <= dim; i += SUM_LANES)
+        for (int k = 0; k < SUM_LANES; k++)
+            acc[k] += w[i + k] * x[i + k] * x[i + k];
+    double s = 0;
+    for (; i < dim; i++)
+        s += w[i] * x[i] * x[i];
+    for (int k = 0; k < SUM_LANES; k++)
+        s += acc[k];
+    return s;
+}
+
+inline double rosen(int dim, const double *x) {
+    const double alpha = 1E2;
+    double acc[SUM_LANES] = { 0 };
+    int i = 0;
+    for (; i + SUM_LANES < dim; i += SUM_LANES)
+        for (int k = 0; k < SUM_LANES; k++) {
+            double a = x[i + k] * x[i + k] - x[i + k + 1];
+            double b = 1 - x[i + k];
+            acc[k] += alpha * a * a + b * b;
+        }
+    double s = 0;
+    for (; i < dim - 1; i++) {
+        double a = x[i] * x[i] - x[i + 1];
+        double b = 1 - x[i];
+        s += alpha * a * a + b * b;
+    }
+    for (int k = 0; k < SUM_LANES; k++)
+        s += acc[k];
+    return s;
+}
+
+inline double rastrigin(int dim, const double *x) {
+    return 10.0 * dim + sum(x, 0, dim, [](double xi) {
+        return xi * xi - 10.0 * cos(2.0 * M_PI * xi);
+    });
+}
+
+inline double ackley(int dim, const double *x) {
+    double sq = sum(x, 0, dim, [](double xi) {
+        return xi * xi;
+    });
+    double sc = sum(x, 0, dim, [](double xi) {
+        return cos(2.0 * M_PI * xi);
+    });
+    return -20.0 * exp(-0.2 * sqrt(sq / dim)) - exp(sc / dim) + 20.0 + M_E;
+}
+
+// ZDT, 2 objectives, x in [0,1], ZDT4: x[1..] in [-5,5]
+
+inline double zdtG(int dim, const double *x) {
+    return 1 + 9 * sum(x, 1, dim, [](double xi) {
+        return xi;
+    }) / (dim - 1);
+}
+
+inline void zdt1(int dim, const double *x, double *y) {
+    double g = zdtG(dim, x);
+    y[0] = x[0];
+    y[1] = g * (1 - sqrt(x[0] / g));
+}
+
+inline void zdt2(int dim, const double *x, double *y) {
+    double g = zdtG(dim, x);
+    double h = x[0] / g;
+    y[0] = x[0];
+    y[1] = g * (1 - h * h);
+}
+
+inline void zdt3(int dim, const double *x, double *y) {
+    double g = zdtG(dim, x);
+    double h = x[0] / g;
+    y[0] = x[0];
+    y[1] = g * (1 - sqrt(h) - h * sin(10 * M_PI * x[0]));
+}
+
+inline void zdt4(int dim, const double *x, double *y) {
+    double g = 1 + 10 * (dim - 1) + sum(x, 1, dim, [](double xi) {
+        return xi * xi - 10 * cos(4 * M_PI * xi);
+    });
+    y[0] = x[0];
+    y[1] = g * (1 - sqrt(x[0] / g));
+}
+
+// number of bits set in the group of n variables starting at x.
+inline int zdtBits(const double *x, int n) {
+    int u = 0;
+    for (int i = 0; i < n; i++)
+        u += x[i] >= 0.5;
+    return u;
+}
+
+// dim = 30 + 5 * k, the first group has 30 bits, the others 5 bits.
+inline void zdt5(int dim, const double *x, double *y) {
+    double g = 0;
+    for (int i = 30; i + 5 <= dim; i += 5) {
+        int u = zdtBits(x + i, 5);
+        g += u < 5 ? 2 + u : 1;
+    }
+    y[0] = 1 + zdtBits(x, std::min(30, dim));
+    y[1] = g / y[0];
+}
+
+inline void zdt6(int dim, const double *x, double *y) {
+    double s = sum(x, 1, dim, [](double xi) {
+        return xi;
+    });
+    double g = 1 + 9 * pow(s / (dim - 1), 0.25);
+    double s6 = pow(sin(6 * M_PI * x[0]), 6);
+    y[0] = 1 - exp(-4 * x[0]) * s6;
+    double h = y[0] / g;
+    y[1] = g * (1 - h * h);
+}
+
+// DTLZ, nobj objectives, x in [0,1], the last k = dim - nobj + 1 variables
+// determine the distance to the front.
+
+inline double dtlzG1(int dim, int nobj, const double *x) {
+    int k = dim - nobj + 1;
+    return 100 * (k + sum(x, nobj - 1, dim, [](double xi) {
+        double d = xi - 0.5;
+        return d * d - cos(20 * M_PI * d);
+    }));
+}
+
+inline double dtlzG2(int dim, int nobj, const double *x) {
+    return sum(x, nobj - 1, dim, [](double xi) {
+        double d = xi - 0.5;
+        return d * d;
+    });
+}
+
+// linear front used by DTLZ1.
+inline void dtlzLinear(int nobj, const double *x, double g, double *y) {
+    for (int m = 0; m < nobj; m++) {
+        double f = 0.5 * (1 + g);
+        for (int j = 0; j < nobj - 1 - m; j++)
+            f *= x[j];
+        if (m > 0)
+            f *= 1 - x[nobj - 1 - m];
+        y[m] = f;
+    }
+}
+
+// spherical front for the angles theta[0..nobj-2] (in units of pi/2).
+inline void dtlzSpherical(int nobj, const double *theta, double g, double *y) {
+    for (int m = 0; m < nobj; m++) {
+        double f = 1 + g;
+        for (int j = 0; j < nobj - 1 - m; j++)
+            f *= cos(0.5 * M_PI * theta[j]);
+        if (m > 0)
+            f *= sin(0.5 * M_PI * theta[nobj - 1 - m]);
+        y[m] = f;
+    }
+}
+
+inline void dtlz1(int dim, int nobj, const double *x, double *y) {
+    dtlzLinear(nobj, x, dtlzG1(dim, nobj, x), y);
+}
+
+inline void dtlz2(int dim, int nobj, const double *x, double *y) {
+    dtlzSpherical(nobj, x, dtlzG2(dim, nobj, x), y);
+}
+
+inline void dtlz3(int dim, int nobj, const double *x, double *y) {
+    dtlzSpherical(nobj, x, dtlzG1(dim, nobj, x), y);
+}
+
+inline void dtlz4(int dim, int nobj, const double *x, double *y) {
+    double theta[nobj];
+    for (int j = 0; j < nobj - 1; j++)
+        theta[j] = pow(x[j], 100);
+    dtlzSpherical(nobj, theta, dtlzG2(dim, nobj, x), y);
+}
+
+// DTLZ5 and DTLZ6 share the degenerated front.
+inline void dtlzDegenerated(int nobj, const double *x, double g, double *y) {
+    double theta[nobj];
+    theta[0] = x[0];
+    for (int j = 1; j < nobj - 1; j++)
+        theta[j] = (1 + 2 * g * x[j]) / (2 * (1 + g));
+    dtlzSpherical(nobj, theta, g, y);
+}
+
+inline void dtlz5(int dim, int nobj, const double *x, double *y) {
+    dtlzDegenerated(nobj, x, dtlzG2(dim, nobj, x), y);
+}
+
+inline void dtlz6(int dim, int nobj, const double *x, double *y) {
+    double g = sum(x, nobj - 1, dim, [](double xi) {
+        return pow(xi, 0.1);
+    });
+    dtlzDegenerated(nobj, x, g, y);
+}
+
+inline void dtlz7(int dim, int nobj, const double *x, double *y) {
+    int k = dim - nobj + 1;
+    double g = 1 + 9.0 / k * sum(x, nobj - 1, dim, [](double xi) {
+        return xi;
+    });
+    double h = nobj;
+    for (int m = 0; m < nobj - 1; m++) {
+        y[m] = x[m];
+        h -= x[m] / (1 + g) * (1 + sin(3 * M_PI * x[m]));
+    }
+    y[nobj - 1] = (1 + g) * h;
+}
+}
+
+#endif /* TESTFUN_HPP_ */
@@ -0,0 +1,215 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// Instruction set dispatched kernels, see kernels.h.
+// With GCC on x86-64 ELF platforms each kernel is compiled as function
+// multiversion (target_clones), an ifunc resolver checks the CPU via cpuid
+// when the library is loaded and binds the best variant. The kernels are
+// plain loops over raw arrays, so the vectorizer generates the code for each
+// variant. Eigen code is not dispatched since its SIMD path is fixed at
+// compile time. Define FCMAES_NO_DISPATCH to build a single variant.
+
+#include <algorithm>
+#include "kernels.h"
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11 \
+        && defined(__x86_64__) && defined(__ELF__) \
+        && !defined(FCMAES_NO_DISPATCH)
+#define KERNEL __attribute__((target_clones("arch=x86-64-v4", \
+        "arch=x86-64-v3", "default")))
+#define KERNEL_DISPATCH 1
+#else
+#define KERNEL
+#define KERNEL_DISPATCH 0
+#endif
+
+// number of columns processed together, reduces the memory traffic for
+// matrices not fitting into the cache.
+static const int KERNEL_BLOCK = 4;
+
+namespace kernels {
+
+KERNEL
+void affineSample(int dim, int n, const double *B, const double *z,
+        double sigma, const double *mean, double *xs) {
+    int k = 0;
+    for (; k + KERNEL_BLOCK <= n; k += KERNEL_BLOCK) {
+        double *__restrict x0 = xs + (long) k * dim;
+        double *__restrict x1 = x0 + dim;
+        double *__restrict x2 = x1 + dim;
+        double *__restrict x3 = x2 + dim;
+        const double *z0 = z + (long) k * dim;
+        for (int i = 0; i < dim; i++) {
+            x0[i] = 0;
+            x1[i] = 0;
+            x2[i] = 0;
+            x3[i] = 0;
+        }
+        for (int j = 0; j < dim; j++) {
+            const double *__restrict b = B + (long) j * dim;
+            double a0 = z0[j], a1 = z0[dim + j], a2 = z0[2 * dim + j], a3 =
+                    z0[3 * dim + j];
+            for (int i = 0; i < dim; i++) {
+                x0[i] += a0 * b[i];
+                x1[i] += a1 * b[i];
+                x2[i] += a2 * b[i];
+                x3[i] += a3 * b[i];
+            }
+        }
+        for (int i = 0; i < dim; i++) {
+            x0[i] = mean[i] + sigma * x0[i];
+            x1[i] = mean[i] + sigma * x1[i];
+            x2[i] = mean[i] + sigma * x2[i];
+            x3[i] = mean[i] + sigma * x3[i];
+        }
+    }
+    for (; k < n; k++) {
+        double *__restrict x = xs + (long) k * dim;
+        const double *zk = z + (long) k * dim;
+        for (int i = 0; i < dim; i++)
+            x[i] = 0;
+        for (int j = 0; j < dim; j++) {
+            const double *__restrict b = B + (long) j * dim;
+            double a = zk[j];
+            for (int i = 0; i < dim; i++)
+                x[i] += a * b[i];
+        }
+        for (int i = 0; i < dim; i++)
+            x[i] = mean[i] + sigma * x[i];
+    }
+}
+
+KERNEL
+void rankUpdate(int dim, int n, double *C, double beta, const double *A,
+        const double *w) {
+    for (int c = 0; c < dim; c++) {
+        double *__restrict col = C + (long) c * dim;
+        for (int i = c; i < dim; i++)
+            col[i] *= beta;
+        int j = 0;
+        for (; j + KERNEL_BLOCK <= n; j += KERNEL_BLOCK) {
+            const double *__restrict a0 = A + (long) j * dim;
+            const double *__restrict a1 = a0 + dim;
+            const double *__restrict a2 = a1 + dim;
+            const double *__restrict a3 = a2 + dim;
+            double f0 = w[j] * a0[c], f1 = w[j + 1] * a1[c], f2 = w[j + 2]
+                    * a2[c], f3 = w[j + 3] * a3[c];
+            for (int i = c; i < dim; i++)
+                col[i] += f0 * a0[i] + f1 * a1[i] + f2 * a2[i] + f3 * a3[i];
+        }
+        for (; j < n; j++) {
+            const double *__restrict a = A + (long) j * dim;
+            double f = w[j] * a[c];
+            for (int i = c; i < dim; i++)
+                col[i] += f * a[i];
+        }
+    }
+}
+
+KERNEL
+void deTrial(int dim, const double *xb, const double *x1, const double *x2,
+        const double *xp, double F, double CR, const double *u, double *x) {
+    for (int j = 0; j < dim; j++) {
+        double m = xb[j] + F * (x1[j] - x2[j]);
+        x[j] = u[j] <= CR ? m : xp[j];
+    }
+}
+
+KERNEL
+void clearDominated(int nobj, int n, const double *yt, int index,
+        unsigned char *mask, unsigned char *dom) {
+    for (int i = 0; i < n; i++)
+        dom[i] = 1;
+    for (int j = 0; j < nobj; j++) {
+        const double *__restrict y = yt + (long) j * n;
+        double yi = y[index];
+        for (int i = 0; i < n; i++)
+            dom[i] &= y[i] >= yi;
+    }
+    dom[index] = 0;
+    for (int i = 0; i < n; i++)
+        mask[i] &= dom[i] ^ 1;
+}
+
+// centers processed together by nearestCenter, the distances of a block
+// stay in the L1 cache.
+static const int NEAREST_BLOCK = 256;
+
+KERNEL
+int nearestCenter(int qdim, int n, const double *cs, long ld, const double *q,
+        double *best) {
+    double d[NEAREST_BLOCK];
+    double bd = *best;
+    int bi = -1;
+    for (int k = 0; k < n; k += NEAREST_BLOCK) {
+        int m = std::min(NEAREST_BLOCK, n - k);
+        const double *__restrict c = cs + k;
+        double q0 = q[0];
+        for (int i = 0; i < m; i++) {
+            double t = c[i] - q0;
+            d[i] = t * t;
+        }
+        for (int j = 1; j < qdim; j++) {
+            const double *__restrict cj = c + j * ld;
+            double qj = q[j];
+            for (int i = 0; i < m; i++) {
+                double t = cj[i] - qj;
+                d[i] += t * t;
+            }
+        }
+        // lane wise minimum, a plain min reduction is not vectorized
+        // without -ffast-math.
+        double lanes[8];
+        for (int l = 0; l < 8; l++)
+            lanes[l] = d[0];
+        int i = 0;
+        for (; i + 8 <= m; i += 8)
+            for (int l = 0; l < 8; l++)
+                lanes[l] = d[i + l] < lanes[l] ? d[i + l] : lanes[l];
+        for (; i < m; i++)
+            lanes[0] = std::min(lanes[0], d[i]);
+        double mn = *std::min_element(lanes, lanes + 8);
+        if (mn < bd) {
+            bd = mn;
+            for (int i = 0; i < m; i++)
+                if (d[i] == mn) {
+                    bi = k + i;
+                    break;
+                }
+        }
+    }
+    *best = bd;
+    return bi;
+}
+
+const char* isa() {
+#if KERNEL_DISPATCH
+    __builtin_cpu_init();
+#if __GNUC__ >= 12
+    if (__builtin_cpu_supports("x86-64-v4"))
+        return "avx512";
+    if (__builtin_cpu_supports("x86-64-v3"))
+        return "avx2";
+#else
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512cd")
+            && __builtin_cpu_supports("avx512dq")
+            && __builtin_cpu_supports("avx512vl"))
+        return "avx512";
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return "avx2";
+#endif
+#endif
+    return "default";
+}
+}
+
+extern "C" {
+
+// instruction set used by the dispatched kernels.
+const char* kernelISA_C() {
+    return kernels::isa();
+}
+}
@@ -0,0 +1,162 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// k-means used to compute the niche centers of CVT MAP-Elites, see
+// fcmaes/mapelites.py.
+// Seeding follows k-means++, new centers are drawn proportional to the
+// squared distance D^2 of the points to their nearest center. Drawing them
+// one by one costs O(n * k) distances, for 100000 centers in 8 dimensions
+// even a KD-tree doesn't prune enough. So, like k-means||, the centers are
+// drawn in rounds, each round adds as many centers as exist already and
+// updates D^2 by one nearest center query per point. The rounds are
+// performed on a random subset of SEED_POINTS * k points.
+// Then mini-batch Lloyd iterations follow: each iteration assigns a random
+// batch of points to their nearest center and moves each center towards
+// the mean of its batch points with a per center learning rate
+// 1 / (number of points assigned so far). If the batch covers all points,
+// standard Lloyd iterations are performed.
+// Nearest centers are determined by a center_tree, multithreaded over
+// chunks of points.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "centertree.h"
+#include "parallel.h"
+#include "philox.h"
+
+namespace {
+
+// points processed together by a thread.
+const int CHUNK = 1024;
+// size of the seeding subset per center.
+const int SEED_POINTS = 4;
+
+// nearest center of each point xs[points[i]], i < n.
+void assign(const center_tree &tree, const double *xs, int dim,
+        const std::vector<int> &points, int n, int workers,
+        std::vector<int> &assigned) {
+    thread_pool::instance().parallel_for((n + CHUNK - 1) / CHUNK, workers,
+            [&](int ch) {
+                int end = std::min(n, (ch + 1) * CHUNK);
+                for (int i = ch * CHUNK; i < end; i++)
+                    assigned[i] = tree.nearest(xs + (long) points[i] * dim);
+            });
+}
+
+// k-means++ seeding in rounds, returns the number of centers.
+int seedCenters(int n, int dim, const double *xs, int k, philox &rs, int workers,
+        double *centers) {
+    int m = (int) std::min((long) n, (long) SEED_POINTS * k);
+    std::vector<int> points(m), assigned(m);
+    for (int i = 0; i < m; i++)
+        points[i] = m == n ? i : rs.uniformInt(n);
+    std::vector<double> d2(m, INFINITY);
+    std::vector<double> us;
+    center_tree tree;
+    int p = rs.uniformInt(m);
+    std::copy(xs + (long) points[p] * dim, xs + (long) (points[p] + 1) * dim,
+            centers);
+    int c = 1, added = 1;
+    while (c < k) {
+        // D^2 for the centers added last
+        const double *fresh = centers + (long) (c - added) * dim;
+        tree.build(dim, added, fresh);
+        assign(tree, xs, dim, points, m, workers, assigned);
+        double sum = 0;
+        for (int i = 0; i < m; i++) {
+            const double *x = xs + (long) points[i] * dim;
+            const double *y = fresh + (long) assigned[i] * dim;
+            double d = 0;
+            for (int j = 0; j < dim; j++)
+                d += (x[j] - y[j]) * (x[j] - y[j]);
+            d2[i] = std::min(d2[i], d);
+            sum += d2[i];
+        }
+        if (!(sum > 0))
+            break;
+        // draw min(c, k - c) points proportional to D^2
+        us.resize(std::min(c, k - c));
+        for (double &u : us)
+            u = rs.uniform() * sum;
+        std::sort(us.begin(), us.end());
+        added = 0;
+        double cum = 0;
+        int last = -1;
+        for (int i = 0, u = 0; i < m && u < (int) us.size(); i++) {
+            cum += d2[i];
+            if (us[u] >= cum)
+                continue;
+            while (u < (int) us.size() && us[u] < cum)
+                u++;
+            if (i != last) { // drawn once, even if hit by several draws
+                std::copy(xs + (long) points[i] * dim,
+                        xs + (long) (points[i] + 1) * dim,
+                        centers + (long) (c + added) * dim);
+                added++;
+                last = i;
+            }
+        }
+        if (added == 0)
+            break;
+        c += added;
+    }
+    return c;
+}
+
+}
+
+extern "C" {
+
+// k centers of the n points xs (n x dim) written to centers (k x dim).
+// Performs iterations mini-batch Lloyd steps using batch random points each,
+// batch >= n means full Lloyd iterations. workers <= 0 uses all cores.
+void kmeans_C(int n, int dim, double *xs, int k, int iterations, int batch,
+        long seed, int workers, double *centers) {
+    philox rs(seed);
+    k = std::min(k, n);
+    int seeded = seedCenters(n, dim, xs, k, rs, workers, centers);
+    // duplicate points, fill up with random points
+    for (int c = seeded; c < k; c++) {
+        int p = rs.uniformInt(n);
+        std::copy(xs + (long) p * dim, xs + (long) (p + 1) * dim,
+                centers + (long) c * dim);
+    }
+    bool full = batch >= n;
+    if (full)
+        batch = n;
+    center_tree tree;
+    std::vector<int> points(batch), assigned(batch);
+    std::vector<double> sums((long) k * dim);
+    std::vector<long> counts(k), total(k, 0);
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < batch; i++)
+            points[i] = full ? i : rs.uniformInt(n);
+        tree.build(dim, k, centers);
+        assign(tree, xs, dim, points, batch, workers, assigned);
+        std::fill(sums.begin(), sums.end(), 0);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (int i = 0; i < batch; i++) {
+            int c = assigned[i];
+            const double *x = xs + (long) points[i] * dim;
+            double *s = &sums[(long) c * dim];
+            for (int j = 0; j < dim; j++)
+                s[j] += x[j];
+            counts[c]++;
+        }
+        for (int c = 0; c < k; c++) {
+            if (counts[c] == 0)
+                continue;
+            total[c] = full ? counts[c] : total[c] + counts[c];
+            double eta = (double) counts[c] / total[c];
+            double *center = centers + (long) c * dim;
+            const double *s = &sums[(long) c * dim];
+            for (int j = 0; j < dim; j++)
+                center[j] += eta * (s[j] / counts[c] - center[j]);
+        }
+    }
+}
+
+}
@@ -14,8 +14,6 @@
 #include <float.h>
 #include <ctime>
 #include <random>
-#define EIGEN_VECTORIZE_SSE2
-#include <EigenRand/EigenRand>
 #include "evaluator.h"
 
 using namespace std;
@@ -30,7 +28,7 @@ public:
 
     FitnessSigma(callback_parallel func_par_, int dim_, const vec &lower_limit,
             const vec &upper_limit, const vec &guess_, const vec &sigma_,
-            Eigen::Rand::P8_mt19937_64 *rs_) {
+            philox *rs_) {
         func_par = func_par_;
         dim = dim_;
         lower = lower_limit;
@@ -66,14 +64,14 @@ public:
     }
 
     vec normX() {
-        return distr_01(*rs) < 0.5 ?
+        return rs->uniform() < 0.5 ?
                 getClosestFeasible(normalVec(xmean, sigma0, dim, *rs)) :
                 getClosestFeasible(normalVec(xmean, sigma, dim, *rs));
     }
 
     double normXi(int i) {
         double nx;
-        if (distr_01(*rs) < 0.5) {
+        if (rs->uniform() < 0.5) {
             do {
                 nx = normreal(*rs, xmean[i], sigma0[i]);
             } while (!feasible(i, nx));
@@ -115,7 +113,7 @@ public:
         return lower.size() == 0 || (x >= lower[i] && x <= upper[i]);
     }
 
-    vec sample(Eigen::Rand::P8_mt19937_64 &rs) {
+    vec sample(philox &rs) {
         if (lower.size() > 0) {
             vec rv = uniformVec(dim, rs);
             return (rv.array() * scale.array()).matrix() + lower;
@@ -123,11 +121,11 @@ public:
             return normalVec(dim, rs);
     }
 
-    double sample_i(int i, Eigen::Rand::P8_mt19937_64 &rs) {
+    double sample_i(int i, philox &rs) {
         if (lower.size() > 0)
-            return lower[i] + scale[i] * distr_01(rs);
+            return lower[i] + scale[i] * rs.uniform();
         else
-            return gauss_01(rs);
+            return rs.normal();
     }
 
     int getEvaluations() {
@@ -144,7 +142,7 @@ private:
     vec sigma0;
     vec sigma;
     vec maxSigma;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox *rs;
     long evaluationCounter;
     vec scale;
     vec invScale;
@@ -154,7 +152,7 @@ class LclDeOptimizer {
 
 public:
 
-    LclDeOptimizer(long runid_, FitnessSigma *fitfun_, int dim_, Eigen::Rand::P8_mt19937_64 *rs_,
+    LclDeOptimizer(long runid_, FitnessSigma *fitfun_, int dim_, philox *rs_,
             int popsize_, int maxEvaluations_, double pbest_,
             double stopfitness_, double F0_, double CR0_) {
         // runid used to identify a specific run
@@ -179,20 +177,16 @@ public:
         init();
     }
 
-    ~LclDeOptimizer() {
-        delete rs;
-    }
-
     double rnd01() {
-        return distr_01(*rs);
+        return rs->uniform();
     }
 
     int rndInt(int max) {
-        return (int) (max * distr_01(*rs));
+        return (int) (max * rs->uniform());
     }
 
     int rndInt2(int max) {
-        double u = distr_01(*rs);
+        double u = rs->uniform();
         return (int) (max * u * u);
     }
 
@@ -326,7 +320,7 @@ private:
     int stop;
     double F0;
     double CR0;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox *rs;
     mat popX;
     vec popY;
     mat nextX;
@@ -359,10 +353,10 @@ void optimizeLCLDE_C(long runid, callback_parallel func_par, int dim,
         lower_limit.resize(0);
         upper_limit.resize(0);
     }
-    Eigen::Rand::P8_mt19937_64 *rs = new Eigen::Rand::P8_mt19937_64(seed);
+    philox rs(seed);
     FitnessSigma fitfun(func_par, dim, lower_limit, upper_limit, guess, inputSigma,
-            rs);
-    LclDeOptimizer opt(runid, &fitfun, dim, rs, popsize, maxEvals, pbest,
+            &rs);
+    LclDeOptimizer opt(runid, &fitfun, dim, &rs, popsize, maxEvals, pbest,
             stopfitness, F0, CR0);
     try {
         opt.doOptimize();
@@ -13,15 +13,13 @@
 //
 // Requires Eigen version >= 3.4 because new slicing capabilities are used, see
 // https://eigen.tuxfamily.org/dox-devel/group__TutorialSlicingIndexing.html
-// requires https://github.com/bab2min/EigenRand for random number generation.
 
 #include <Eigen/Core>
 #include <iostream>
 #include <float.h>
 #include <stdint.h>
 #include <ctime>
-#include <random>
-#include <EigenRand/EigenRand>
+#include "philox.h"
 
 using namespace std;
 
@@ -33,10 +31,6 @@ typedef bool (*callback_type)(int, const double*, double*);
 
 namespace l_differential_evolution {
 
-static uniform_real_distribution<> distr_01 = std::uniform_real_distribution<>(
-        0, 1);
-static normal_distribution<> gauss_01 = std::normal_distribution<>(0, 1);
-
 static vec zeros(int n) {
     return Eigen::MatrixXd::Zero(n, 1);
 }
@@ -45,20 +39,23 @@ static vec constant(int n, double val) {
     return vec::Constant(n, val);
 }
 
-static Eigen::MatrixXd uniform(int dx, int dy, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::uniformReal<mat>(dx, dy, rs);
+static Eigen::MatrixXd uniform(int dx, int dy, philox &rs) {
+    mat m(dx, dy);
+    rs.fillUniform(m.data(), m.size());
+    return m;
 }
 
-static Eigen::MatrixXd uniformVec(int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    return Eigen::Rand::uniformReal<vec>(dim, 1, rs);
+static Eigen::MatrixXd uniformVec(int dim, philox &rs) {
+    return uniform(dim, 1, rs);
 }
 
-static double normreal(double mean, double sdev, Eigen::Rand::P8_mt19937_64 &rs) {
-    return gauss_01(rs) * sdev + mean;
+static double normreal(double mean, double sdev, philox &rs) {
+    return rs.normal() * sdev + mean;
 }
 
-static vec normalVec(const vec &mean, const vec &sdev, int dim, Eigen::Rand::P8_mt19937_64 &rs) {
-    vec nv = Eigen::Rand::normal<vec>(dim, 1, rs);
+static vec normalVec(const vec &mean, const vec &sdev, int dim, philox &rs) {
+    vec nv(dim);
+    rs.fillNormal(nv.data(), dim);
     return (nv.array() * sdev.array()).matrix() + mean;
 }
 
@@ -70,7 +67,7 @@ public:
 
     Fitness(callback_type func_, int dim_, const vec &lower_limit,
             const vec &upper_limit, const vec &guess_, const vec &sigma_,
-            Eigen::Rand::P8_mt19937_64 *rs_) {
+            philox *rs_) {
         func = func_;
         dim = dim_;
         lower = lower_limit;
@@ -105,14 +102,14 @@ public:
     }
 
     vec normX() {
-        return distr_01(*rs) < 0.5 ?
+        return rs->uniform() < 0.5 ?
                 getClosestFeasible(normalVec(xmean, sigma0, dim, *rs)) :
                 getClosestFeasible(normalVec(xmean, sigma, dim, *rs));
     }
 
     double normXi(int i) {
         double nx;
-        if (distr_01(*rs) < 0.5) {
+        if (rs->uniform() < 0.5) {
             do {
                 nx = normreal(xmean[i], sigma0[i], *rs);
             } while (!feasible(i, nx));
@@ -138,7 +135,7 @@ public:
 
     double sample_i(int i) {
         if (lower.size() > 0)
-            return lower[i] + scale[i] * distr_01(*rs);
+            return lower[i] + scale[i] * rs->uniform();
         else
             return normXi(i);
     }
@@ -177,7 +174,7 @@ private:
     vec sigma0;
     vec sigma;
     vec maxSigma;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox *rs;
     long evaluationCounter;
     vec scale;
     vec invScale;
@@ -187,7 +184,7 @@ class LDeOptimizer {
 
 public:
 
-    LDeOptimizer(long runid_, Fitness *fitfun_, int dim_, Eigen::Rand::P8_mt19937_64 *rs_,
+    LDeOptimizer(long runid_, Fitness *fitfun_, int dim_, philox *rs_,
             int popsize_, int maxEvaluations_, double keep_,
             double stopfitness_, double F_, double CR_,
             double min_mutate_, double max_mutate_, bool *isInt_) {
@@ -221,21 +218,17 @@ public:
         init();
     }
 
-    ~LDeOptimizer() {
-        delete rs;
-    }
-
     double rnd01() {
-        return distr_01(*rs);
+        return rs->uniform();
     }
 
     double rnd02() {
-        double rnd = distr_01(*rs);
+        double rnd = rs->uniform();
         return rnd * rnd;
     }
 
     int rndInt(int max) {
-        return (int) (max * distr_01(*rs));
+        return (int) (max * rs->uniform());
     }
 
     vec next_improve(const vec &xb, const vec &x, const vec &xi) {
@@ -369,7 +362,7 @@ private:
     int stop;
     double F0;
     double CR0;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox *rs;
     mat popX;
     vec popY;
     vec popIter;
@@ -407,9 +400,9 @@ void optimizeLDE_C(long runid, callback_type func, int dim, double *init,
         lower_limit.resize(0);
         upper_limit.resize(0);
     }
-    Eigen::Rand::P8_mt19937_64 *rs = new Eigen::Rand::P8_mt19937_64(seed);
-    Fitness fitfun(func, dim, lower_limit, upper_limit, guess, inputSigma, rs);
-    LDeOptimizer opt(runid, &fitfun, dim, rs, popsize, maxEvals, keep,
+    philox rs(seed);
+    Fitness fitfun(func, dim, lower_limit, upper_limit, guess, inputSigma, &rs);
+    LDeOptimizer opt(runid, &fitfun, dim, &rs, popsize, maxEvals, keep,
             stopfitness, F, CR, min_mutate, max_mutate,
             useIsInt ? isInt : NULL);
     try {
@@ -8,7 +8,6 @@
 //
 // Requires Eigen version >= 3.4 because new slicing capabilities are used, see
 // https://eigen.tuxfamily.org/dox-devel/group__TutorialSlicingIndexing.html
-// requires https://github.com/bab2min/EigenRand for random number generation.
 //
 // Can switch to NSGA-II like population update via parameter 'nsga_update'.
 // Then it works essentially like NSGA-II but instead of the tournament selection
@@ -47,8 +46,9 @@
 #include <random>
 #include <queue>
 #include <tuple>
-#include <EigenRand/EigenRand>
 #include "evaluator.h"
+#include "kernels.h"
+#include "surrogate.h"
 
 namespace mode_optimizer {
 
@@ -88,7 +88,7 @@ public:
         // position of current x/y
         pos = 0;
         //std::random_device rd;
-        rs = new Eigen::Rand::P8_mt19937_64(seed_);
+        rs = philox(seed_);
         // NSGA population update parameters, ignored if nsga_update == false
         // usually use pro_c = 1.0, dis_c = 20.0, pro_m = 1.0, dis_m = 20.0.
         pro_c = pro_c_;
@@ -117,13 +117,9 @@ public:
         init();
     }
 
-    ~MoDeOptimizer() {
-        delete rs;
-    }
-
     mat variation(const mat &x) {
-        double dis_c_ = (0.5 * rand01(*rs) + 0.5) * dis_c;
-        double dis_m_ = (0.5 * rand01(*rs) + 0.5) * dis_m;
+        double dis_c_ = (0.5 * rand01(rs) + 0.5) * dis_c;
+        double dis_m_ = (0.5 * rand01(rs) + 0.5) * dis_m;
         int n2 = x.cols() / 2;
         int n = 2 * n2;
         mat parent1 = x(Eigen::indexing::all, Eigen::seq(0, n2 - 1));
@@ -131,19 +127,19 @@ public:
         mat beta = mat(dim, n2);
         vec to1;
         if (pro_c < 1.0) {
-            to1 = uniformVec(dim, *rs);
+            to1 = uniformVec(dim, rs);
         }
         for (int p = 0; p < n2; p++) {
             for (int i = 0; i < dim; i++) {
-                if (rand01(*rs) > 0.5 || (pro_c < 1.0 && to1(i) < pro_c))
+                if (rand01(rs) > 0.5 || (pro_c < 1.0 && to1(i) < pro_c))
                     beta(i, p) = 1.0;
                 else {
-                    double r = rand01(*rs);
+                    double r = rand01(rs);
                     if (r <= 0.5)
                         beta(i, p) = pow(2 * r, 1.0 / (dis_c_ + 1.0));
                     else
                         beta(i, p) = pow(2 * r, -1.0 / (dis_c_ + 1.0));
-                    if (rand01(*rs) > 0.5)
+                    if (rand01(rs) > 0.5)
                         beta(i, p) = -beta(i, p);
                 }
             }
@@ -160,8 +156,8 @@ public:
         vec scale = fitfun->scale();
         for (int p = 0; p < n; p++) {
             for (int i = 0; i < dim; i++) {
-                if (rand01(*rs) < limit) { // site
-                    double mu = rand01(*rs);
+                if (rand01(rs) < limit) { // site
+                    double mu = rand01(rs);
                     double norm = fitfun->norm_i(i, offspring(i, p));
                     if (mu <= 0.5) // temp
                         offspring(i, p) += scale(i) *
@@ -196,26 +192,30 @@ public:
             CR = iterations % 2 == 0 ? 0.5 * CR0 : CR0;
             F = iterations % 2 == 0 ? 0.5 * F0 : F0;
         }
+        return trial(p);
+    }
+
+    // DE trial vector for individual p.
+    vec trial(int p) {
         vec xp = popX.col(p);
         int r1, r2, r3;
         do {
-            r1 = randInt(*rs,popsize);
-            r2 = randInt(*rs,popsize);
+            r1 = randInt(rs,popsize);
+            r2 = randInt(rs,popsize);
             if (pareto_update > 0)
                 // sample elite solutions
-                 r3 = (int) (pow(rand01(*rs), 1.0 + pareto_update) * popsize);
+                 r3 = (int) (pow(rand01(rs), 1.0 + pareto_update) * popsize);
             else
                 // sample from whole population
-                 r3 = randInt(*rs,popsize);
+                 r3 = randInt(rs,popsize);
         } while (r3 == p || r3 == r1 || r3 == r2 || r2 == p || r2 == r1 || r1 == p);
-        vec x1 = popX.col(r1);
-        vec x2 = popX.col(r2);
-        vec x3 = popX.col(r3);
-        vec x = x3 + (x1 - x2) * F;
-        int r = randInt(*rs,dim);
+        int r = randInt(rs,dim);
+        vec u(dim);
         for (int j = 0; j < dim; j++)
-            if (j != r && rand01(*rs) > CR)
-                x[j] = xp[j];
+            u[j] = j == r ? 0 : rand01(rs);
+        vec x(dim);
+        kernels::deTrial(dim, popX.col(r3).data(), popX.col(r1).data(),
+                popX.col(r2).data(), xp.data(), F, CR, u.data(), x.data());
         x = fitfun->getClosestFeasible(x);
         modify(x);
         return x;
@@ -228,11 +228,11 @@ public:
         for (int i = 0; i < dim; i++)
             if (isInt[i])
                 n_ints++;
-        double to_mutate = min_mutate + rand01(*rs) * (max_mutate - min_mutate);
+        double to_mutate = min_mutate + rand01(rs) * (max_mutate - min_mutate);
         for (int i = 0; i < dim; i++) {
             if (isInt[i]) {
-                if (rand01(*rs) < to_mutate / n_ints)
-                    x[i] = (int)fitfun->sample_i(i, *rs); // resample
+                if (rand01(rs) < to_mutate / n_ints)
+                    x[i] = (int)fitfun->sample_i(i, rs); // resample
             }
         }
     }
@@ -277,24 +277,18 @@ public:
 
     vec pareto_levels(const mat &y) {
         int n = y.cols();
-        ivec pareto(n);
-        for (int i = 0; i < n; i++)
-            pareto(i) = i;
         vec domination = zeros(n);
-        bool mask[n];
-        for (int i = 0; i < n; i++)
-            mask[i] = true;
+        mat yt = y.transpose(); // objective major
+        std::vector<unsigned char> mask(n, 1), dom(n);
         for (int index = 0; index < n;) {
-            for (int i = 0; i < n; i++) {
-                if (i != index && mask[i] && is_dominated(y, i, index))
-                    mask[i] = false;
-            }
+            kernels::clearDominated(y.rows(), n, yt.data(), index, mask.data(),
+                    dom.data());
             for (int i = 0; i < n; i++) {
                 if (mask[i])
                     domination[i] += 1;
             }
             index++;
-            while (!mask[index] && index < n)
+            while (index < n && !mask[index])
                 index++;
         }
         return domination;
@@ -501,28 +495,68 @@ public:
     }
 
     mat askAll() {
+       if (screen) {
+           // model coordinates: population mean and standard deviation
+           mat pop = popX.leftCols(popsize);
+           vec m = pop.rowwise().mean();
+           vec sdev = (pop.colwise() - m).rowwise().norm() / sqrt(popsize);
+           screen->setCoordinates(m, sdev);
+       }
+       bool screened = !nsga_update && screen && screen->ready();
        for (int p = 0; p < popsize; p++) {
            vec x = nextX(p);
+           if (screened) {
+               // keep the least dominated predicted of screenFactor trials
+               mat xs(dim, screenFactor);
+               xs.col(0) = x;
+               for (int k = 1; k < screenFactor; k++)
+                   xs.col(k) = trial(p);
+               x = xs.col(screen->select(xs, 1)[0]);
+           }
            popX.col(popsize + p) = x;
        }
        return popX.rightCols(popsize);
     }
 
-    int tellAll(mat ys) {
-       for (int p = 0; p < popsize; p++)
-            popY.col(popsize + p) = ys.col(p);
+    int tellAll(const Eigen::Ref<const mat> &ys) {
+       popY.rightCols(popsize) = ys;
+       if (screen)
+           for (int p = 0; p < popsize; p++)
+               screen->update(popX.col(popsize + p), ys.col(p));
 //            std::cout << p << " x " << popX.col(popsize + p).transpose() << std::endl;
 //            std::cout << p << " y " << ys.col(p).transpose() << std::endl;
        pop_update();
        return stop;
     }
 
-    int tellAll(mat ys, bool nsga_update_, double pareto_update_) {
+    int tellAll(const Eigen::Ref<const mat> &ys, bool nsga_update_,
+            double pareto_update_) {
         nsga_update = nsga_update_;
         pareto_update = pareto_update_;
         return tellAll(ys);
     }
 
+    // replaces the first individuals by xs with known function and
+    // constraint values ys, used to warm start from the best records of an
+    // evaluation log.
+    void setPopulation(const mat &xs, const mat &ys) {
+        int n = std::min((int) xs.cols(), popsize);
+        popX.leftCols(n) = xs.leftCols(n);
+        popY.leftCols(n) = ys.leftCols(n);
+        if (nsga_update)
+            vX = variation(popX(Eigen::indexing::all, Eigen::seqN(0, popsize)));
+    }
+
+    // in DE mode each trial vector for ask/tell is the least dominated of
+    // factor trials predicted by a quadratic surrogate model of the told
+    // objective and constraint values, see surrogate.h.
+    void enableScreening(int factor, double forgetting) {
+        screenFactor = std::max(1, factor);
+        screen.reset(
+                screenFactor > 1 ?
+                        new surrogate(dim, nobj, ncon, forgetting) : nullptr);
+    }
+
     mat getPopulation() {
          return popX.leftCols(popsize);
     }
@@ -559,7 +593,7 @@ public:
         popX = mat(dim, 2 * popsize);
         popY = mat(nobj + ncon, 2 * popsize);
         for (int p = 0; p < popsize; p++) {
-            popX.col(p) = fitfun->sample(*rs);
+            popX.col(p) = fitfun->sample(rs);
             popY.col(p) = constant(nobj + ncon, DBL_MAX);
         }
         next_size = 2 * popsize;
@@ -606,6 +640,9 @@ public:
         return popsize;
     }
 
+    // population buffer shared with the caller, see pop_buffer
+    pop_buffer buffer;
+
 private:
     long runid;
     Fitness *fitfun;
@@ -628,7 +665,7 @@ private:
     double dis_c;
     double pro_m;
     double dis_m;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox rs;
     mat popX;
     mat popY;
     mat nX;
@@ -644,6 +681,8 @@ private:
     double max_mutate;
     int log_period;
     bool *isInt;
+    std::unique_ptr<surrogate> screen;
+    int screenFactor = 1;
 };
 }
 
@@ -667,6 +706,7 @@ void optimizeMODE_C(long runid, callback_type func, callback_type log, int dim,
         useIsInt |= ints[i];
     }
     Fitness fitfun(func, noop_callback_par, dim, nobj + ncon, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     MoDeOptimizer opt(runid, &fitfun, log, dim, nobj, ncon, seed, popsize,
             maxEvals, F, CR, pro_c, dis_c, pro_m, dis_m, nsga_update,
             pareto_update, min_mutate, max_mutate,
@@ -718,41 +758,64 @@ void askMODE_C(uintptr_t ptr, double* xs) {
     MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
     int n = opt->getDim();
     int popsize = opt->getPopsize();
-    mat pop = opt->askAll();
-    Fitness* fitfun = opt->getFitfun();
-    for (int p = 0; p < popsize; p++) {
-        vec x = pop.col(p);
-        for (int i = 0; i < n; i++)
-            xs[p * n + i] = x[i];
-    }
+    Eigen::Map<mat>(xs, n, popsize) = opt->askAll();
+}
+
+// activates surrogate pre-screening for ask/tell in DE mode: each trial
+// vector returned by askMODE_C is the least dominated predicted of factor
+// trials, predicted constraint violations come last. Useful for expensive
+// objectives, factor <= 1 disables it. forgetting in (0, 1] down weights
+// older evaluations.
+void enableScreeningMODE_C(uintptr_t ptr, int factor, double forgetting) {
+    MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
+    opt->enableScreening(factor, forgetting);
 }
 
 int tellMODE_C(uintptr_t ptr, double* ys) {
     MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
     int popsize = opt->getPopsize();
-    int nobj = opt->getNobj();
-    mat vals(nobj, popsize);
-    for (int p = 0; p < popsize; p++) {
-        vec y(nobj);
-        for (int i = 0; i < nobj; i++)
-            y[i] = ys[p * nobj + i];
-        vals.col(p) = y;
-    }
-    return opt->tellAll(vals);
+    int nobj = opt->getNobj() + opt->getNcon();
+    return opt->tellAll(Eigen::Map<const mat>(ys, nobj, popsize));
 }
 
 int tellMODE_switchC(uintptr_t ptr, double* ys, bool nsga_update, double pareto_update) {
     MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
     int popsize = opt->getPopsize();
-    int nobj = opt->getNobj();
-    mat vals(nobj, popsize);
-    for (int p = 0; p < popsize; p++) {
-        vec y(nobj);
-        for (int i = 0; i < nobj; i++)
-            y[i] = ys[p * nobj + i];
-        vals.col(p) = y;
-    }
-    return opt->tellAll(vals, nsga_update, pareto_update);
+    int nobj = opt->getNobj() + opt->getNcon();
+    return opt->tellAll(Eigen::Map<const mat>(ys, nobj, popsize),
+            nsga_update, pareto_update);
+}
+
+// maps the population buffer of the optimizer, see pop_buffer. askBufferMODE_C
+// writes the next population to xs, tellBufferMODE_C reads the function
+// values from ys, so the caller maps the buffer once and passes no data.
+void bufferMODE_C(uintptr_t ptr, double** xs, double** ys) {
+    MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(),
+            opt->getNobj() + opt->getNcon());
+    *xs = opt->buffer.xs();
+    *ys = opt->buffer.ys();
+}
+
+void askBufferMODE_C(uintptr_t ptr) {
+    MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(),
+            opt->getNobj() + opt->getNcon());
+    askMODE_C(ptr, opt->buffer.xs());
+}
+
+int tellBufferMODE_C(uintptr_t ptr) {
+    MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
+    return tellMODE_C(ptr, opt->buffer.ys());
+}
+
+// initializes the first n individuals, xs has layout n x dim, ys
+// n x (nobj + ncon). Used to warm start from the best records of an
+// evaluation log, see readEvalLog_C.
+void initPopulationMODE_C(uintptr_t ptr, int n, double* xs, double* ys) {
+    MoDeOptimizer *opt = (MoDeOptimizer*) ptr;
+    opt->setPopulation(Eigen::Map<mat>(xs, opt->getDim(), n),
+            Eigen::Map<mat>(ys, opt->getNobj() + opt->getNcon(), n));
 }
 
 int populationMODE_C(uintptr_t ptr, double* xs) {
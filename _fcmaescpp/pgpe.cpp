@@ -8,7 +8,6 @@
 //
 // Requires Eigen version >= 3.4 because new slicing capabilities are used, see
 // https://eigen.tuxfamily.org/dox-devel/group__TutorialSlicingIndexing.html
-// requires https://github.com/bab2min/EigenRand for random number generation.
 //
 // Supports only ADAM based mean/baseline update.
 
@@ -21,7 +20,6 @@
 #include <random>
 #include <queue>
 #include <tuple>
-#include <EigenRand/EigenRand>
 #include "evaluator.h"
 
 using namespace std;
@@ -115,7 +113,7 @@ public:
         // stop criteria
         stop = 0;
         //std::random_device rd;
-        rs = new Eigen::Rand::P8_mt19937_64(seed_);
+        rs = philox(seed_);
         optimizer = new ADAM(guess_, b1_, b2_, eps_, center_learning_rate_,
                 decay_coef_);
         center = fitfun->encode(guess_);
@@ -130,7 +128,6 @@ public:
     }
 
     ~PGPEOptimizer() {
-        delete rs;
         delete optimizer;
     }
 
@@ -182,7 +179,7 @@ public:
 
     mat ask(const vec &stdev, const vec &center) { // undecoded
         int n = popsize / 2;
-        scaled_noises = normal(dim, n, *rs).array()
+        scaled_noises = normal(dim, n, rs).array()
                 * stdev.replicate(1, n).array();
         mat x = mat(dim, popsize);
         mat x1 = center.replicate(1, n) + scaled_noises;
@@ -206,7 +203,7 @@ public:
         }
     }
 
-    mat ask_decode() {
+    const mat& ask_decode() {
         // generate popsize offspring.
         mat xs = ask(stdev, center);
         for (int p = 0; p < popsize; p++)
@@ -215,7 +212,7 @@ public:
         return popX;
     }
 
-    int tell(vec ys) {
+    int tell(const Eigen::Ref<const vec> &ys) {
         popY = process_scores(-ys); // negate values since we minimize
         double bY = -popY.maxCoeff();
         if (bestY > bY) {
@@ -272,6 +269,9 @@ public:
         return popsize;
     }
 
+    // population buffer shared with the caller, see pop_buffer
+    pop_buffer buffer;
+
 private:
     long runid;
     Fitness *fitfun;
@@ -285,7 +285,7 @@ private:
     double bestY;
     vec bestX;
     int stop;
-    Eigen::Rand::P8_mt19937_64 *rs;
+    philox rs;
     mat popX;
     mat scaled_noises;
     vec popY;
@@ -328,6 +328,7 @@ void optimizePGPE_C(int64_t runid, callback_parallel func_par, int dim,
         normalize = false;
     }
     Fitness fitfun(noop_callback, func_par, n, 1, lower_limit, upper_limit);
+    fitfun.setRunid(runid);
     fitfun.setNormalize(normalize);
 
     PGPEOptimizer opt(runid, &fitfun, dim, seed, popsize, guess, inputSigma,
@@ -398,25 +399,37 @@ void askPGPE_C(uintptr_t ptr, double *xs) {
     PGPEOptimizer *opt = (PGPEOptimizer*) ptr;
     int n = opt->getDim();
     int popsize = opt->getPopsize();
-    mat popX = opt->ask_decode();
-    Fitness *fitfun = opt->getFitfun();
-    for (int p = 0; p < popsize; p++) {
-        vec x = popX.col(p);
-        for (int i = 0; i < n; i++)
-            xs[p * n + i] = x[i];
-    }
+    Eigen::Map<mat>(xs, n, popsize) = opt->ask_decode();
 }
 
 int tellPGPE_C(uintptr_t ptr, double *ys) { //, double* xs) {
     PGPEOptimizer *opt = (PGPEOptimizer*) ptr;
     int popsize = opt->getPopsize();
-    vec vals(popsize);
-    for (int i = 0; i < popsize; i++)
-        vals[i] = ys[i];
-    opt->tell(vals);
+    opt->tell(Eigen::Map<const vec>(ys, popsize));
     return opt->getStop();
 }
 
+// maps the population buffer of the optimizer, see pop_buffer. askBufferPGPE_C
+// writes the next population to xs, tellBufferPGPE_C reads the function
+// values from ys, so the caller maps the buffer once and passes no data.
+void bufferPGPE_C(uintptr_t ptr, double** xs, double** ys) {
+    PGPEOptimizer *opt = (PGPEOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    *xs = opt->buffer.xs();
+    *ys = opt->buffer.ys();
+}
+
+void askBufferPGPE_C(uintptr_t ptr) {
+    PGPEOptimizer *opt = (PGPEOptimizer*) ptr;
+    opt->buffer.init(opt->getDim(), opt->getPopsize(), 1);
+    askPGPE_C(ptr, opt->buffer.xs());
+}
+
+int tellBufferPGPE_C(uintptr_t ptr) {
+    PGPEOptimizer *opt = (PGPEOptimizer*) ptr;
+    return tellPGPE_C(ptr, opt->buffer.ys());
+}
+
 int populationPGPE_C(uintptr_t ptr, double *xs) {
     PGPEOptimizer *opt = (PGPEOptimizer*) ptr;
     int dim = opt->getDim();
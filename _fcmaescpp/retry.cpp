@@ -0,0 +1,144 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// Native parallel optimization retry, see retry.h. retryMinimize_C executes
+// numRetries single threaded optimization runs on the shared thread pool
+// and collects their results in a retry_store. Compared to the process
+// based loop of fcmaes/retry.py there is no per run Python overhead, which
+// matters for many short runs. Each run derives its random initial guess,
+// sigma and optimizer seed from the philox substream of its run index, so
+// the results don't depend on thread scheduling.
+// The objective is called concurrently from several threads. A Python
+// objective is serialized by the GIL, use it for objectives releasing the
+// GIL or implemented natively (numba cfunc).
+
+#include <stdint.h>
+#include <vector>
+#include "parallel.h"
+#include "philox.h"
+#include "retry.h"
+
+typedef bool (*callback_type)(int, const double*, double*);
+typedef void (*callback_parallel)(int, int, double*, double*);
+
+extern "C" {
+void optimizeACMA_C(long runid, callback_type func, callback_parallel func_par,
+        int dim, double *init, double *lower, double *upper, double *sigma,
+        int maxEvals, double stopfitness, double stopTolHistFun, int mu,
+        int popsize, double accuracy, long seed, bool normalize,
+        bool use_delayed_update, int update_gap, int workers, double *res);
+void optimizeDE_C(long runid, callback_type func, int dim, int seed,
+        double *lower, double *upper, double *init, double *sigma,
+        double minSigma, bool *ints, int maxEvals, double keep,
+        double stopfitness, int popsize, double F, double CR,
+        double min_mutate, double max_mutate, int workers, double *res);
+void optimizeBite_C(long runid, callback_type func, int dim, int seed,
+        double *init, double *lower, double *upper, int maxEvals,
+        double stopfitness, int M, int popsize, int stall_iterations,
+        double *res);
+}
+
+namespace {
+
+// objective of the run executed by the current thread, CMA-ES evaluates
+// its population via a callback_parallel.
+thread_local callback_type runFunc;
+
+void serial_par(int popsize, int dim, double *xs, double *ys) {
+    for (int p = 0; p < popsize; p++)
+        runFunc(dim, xs + p * dim, ys + p);
+}
+
+// single optimization run, res receives x, y, evaluations, iterations, stop.
+void retryRun(long runid, callback_type func, int dim, double *lower,
+        double *upper, const retry_config &cfg, philox &rs, double *res) {
+    std::vector<double> guess(dim), sigma(dim);
+    bool ints[dim];
+    for (int i = 0; i < dim; i++) {
+        guess[i] = lower[i] + rs.uniform() * (upper[i] - lower[i]);
+        ints[i] = false;
+    }
+    std::fill(sigma.begin(), sigma.end(), 0.05 + 0.05 * rs.uniform());
+    int seed = (int) (rs() >> 33);
+    int popsize = cfg.popsize;
+    runFunc = func;
+    switch (cfg.optimizer) {
+    case RETRY_DE:
+        optimizeDE_C(runid, func, dim, seed, lower, upper, guess.data(),
+                sigma.data(), 0, ints, cfg.maxEvals, 200, cfg.stopFitness,
+                popsize, 0.5, 0.9, 0, 0, 1, res);
+        break;
+    case RETRY_ACMA:
+        optimizeACMA_C(runid, func, serial_par, dim, guess.data(), lower, upper,
+                sigma.data(), cfg.maxEvals, cfg.stopFitness, -1, popsize / 2,
+                popsize, 1.0, seed, true, false, -1, 1, res);
+        break;
+    case RETRY_DE_ACMA: {
+        // share of the DE evaluations in [0.1, 0.5], like optimizer.de_cma.
+        double deShare = 0.1 + 0.4 * rs.uniform();
+        int deEvals = (int) (deShare * cfg.maxEvals);
+        std::vector<double> deRes(dim + 4);
+        optimizeDE_C(runid, func, dim, seed, lower, upper, guess.data(),
+                sigma.data(), 0, ints, deEvals, 200, cfg.stopFitness, popsize,
+                0.5, 0.9, 0, 0, 1, deRes.data());
+        optimizeACMA_C(runid, func, serial_par, dim, deRes.data(), lower, upper,
+                sigma.data(), cfg.maxEvals - deEvals, cfg.stopFitness, -1,
+                popsize / 2, popsize, 1.0, seed + 1, true, false, -1, 1, res);
+        if (deRes[dim] < res[dim])
+            std::copy(deRes.begin(), deRes.begin() + dim + 1, res);
+        res[dim + 1] += deRes[dim + 1];
+        break;
+    }
+    case RETRY_BITE:
+        // BiteOpt determines its population size itself.
+        optimizeBite_C(runid, func, dim, seed, guess.data(), lower, upper,
+                cfg.maxEvals, cfg.stopFitness, 1, 0, 0, res);
+        break;
+    default:
+        res[dim] = DBL_MAX;
+        res[dim + 1] = 0;
+    }
+}
+
+}
+
+extern "C" {
+
+// Executes cfg->numRetries optimization runs in parallel using at most
+// cfg->workers threads and returns the number of stored solutions. The best
+// results sorted by value are written to xs (capacity x dim) and ys
+// (capacity), res receives the best x, its value, the overall number of
+// evaluations, the number of runs and the mean and standard deviation of
+// the results below cfg->valueLimit (dim + 5 values).
+// No new runs are started after cfg->stopFitness is reached.
+int retryMinimize_C(long runid, callback_type func, int dim, double *lower,
+        double *upper, const retry_config *cfg, double *xs, double *ys,
+        double *res) {
+    retry_store store(dim, cfg->capacity);
+    philox rs(cfg->seed);
+    thread_pool::instance().parallel_for(cfg->numRetries, cfg->workers,
+            [&](int i) {
+                if (store.bestY() <= cfg->stopFitness)
+                    return;
+                philox rsi = rs.substream(i);
+                std::vector<double> r(dim + 4);
+                retryRun(runid + i, func, dim, lower, upper, *cfg, rsi,
+                        r.data());
+                store.add(r[dim], r.data(), (long) r[dim + 1],
+                        cfg->valueLimit);
+            });
+    int n = store.sort();
+    std::copy(store.xs(), store.xs() + (long) n * dim, xs);
+    std::copy(store.ys(), store.ys() + n, ys);
+    std::copy(store.bestX(), store.bestX() + dim, res);
+    res[dim] = store.bestY();
+    res[dim + 1] = store.evals();
+    res[dim + 2] = store.runs();
+    res[dim + 3] = store.mean();
+    res[dim + 4] = store.sdev();
+    return n;
+}
+
+}
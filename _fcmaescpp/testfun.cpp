@@ -0,0 +1,216 @@
+// Copyright (c) Dietmar Wolz.
+//
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory.
+//
+// Exports the test functions of testfun.h as callback_type
+// bool fooC(int dim, const double* x, double* y) and as callback_parallel
+// void fooBatchC(int popsize, int dim, double* xs, double* ys), so they can be
+// passed directly to the native optimizers. Multi objective functions write
+// nobj values per solution, ys has layout popsize x nobj. ZDT functions have
+// 2, DTLZ functions 3 objectives.
+// Batch variants evaluate the population in the calling thread, they are meant
+// as cheap, reproducible workload for throughput measurements.
+
+#include <vector>
+#include "testfun.h"
+
+using namespace testfun;
+
+namespace {
+
+template<class F>
+void batch(int popsize, int dim, const double *xs, double *ys, F f) {
+    for (int p = 0; p < popsize; p++)
+        ys[p] = f(dim, xs + (size_t) p * dim);
+}
+
+template<class F>
+void batchMo(int popsize, int dim, int nobj, const double *xs, double *ys,
+        F f) {
+    for (int p = 0; p < popsize; p++)
+        f(dim, xs + (size_t) p * dim, ys + (size_t) p * nobj);
+}
+
+const std::vector<double>& cachedElliWeights(int dim) {
+    static thread_local std::vector<double> w;
+    if ((int) w.size() != dim)
+        testfun::elliWeights(dim, w);
+    return w;
+}
+
+double elliW(int dim, const double *x) {
+    return elli(dim, x, cachedElliWeights(dim).data());
+}
+
+template<void (*F)(int, int, const double*, double*)>
+void dtlz3obj(int dim, const double *x, double *y) {
+    F(dim, 3, x, y);
+}
+
+}
+
+extern "C" {
+
+bool sphereC(int dim, const double *x, double *y) {
+    y[0] = sphere(dim, x);
+    return false;
+}
+
+void sphereBatchC(int popsize, int dim, double *xs, double *ys) {
+    batch(popsize, dim, xs, ys, sphere);
+}
+
+bool elliC(int dim, const double *x, double *y) {
+    y[0] = elliW(dim, x);
+    return false;
+}
+
+void elliBatchC(int popsize, int dim, double *xs, double *ys) {
+    batch(popsize, dim, xs, ys, elliW);
+}
+
+bool rosenC(int dim, const double *x, double *y) {
+    y[0] = rosen(dim, x);
+    return false;
+}
+
+void rosenBatchC(int popsize, int dim, double *xs, double *ys) {
+    batch(popsize, dim, xs, ys, rosen);
+}
+
+bool rastriginC(int dim, const double *x, double *y) {
+    y[0] = rastrigin(dim, x);
+    return false;
+}
+
+void rastriginBatchC(int popsize, int dim, double *xs, double *ys) {
+    batch(popsize, dim, xs, ys, rastrigin);
+}
+
+bool ackleyC(int dim, const double *x, double *y) {
+    y[0] = ackley(dim, x);
+    return false;
+}
+
+void ackleyBatchC(int popsize, int dim, double *xs, double *ys) {
+    batch(popsize, dim, xs, ys, ackley);
+}
+
+bool zdt1C(int dim, const double *x, double *y) {
+    zdt1(dim, x, y);
+    return false;
+}
+
+void zdt1BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 2, xs, ys, zdt1);
+}
+
+bool zdt2C(int dim, const double *x, double *y) {
+    zdt2(dim, x, y);
+    return false;
+}
+
+void zdt2BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 2, xs, ys, zdt2);
+}
+
+bool zdt3C(int dim, const double *x, double *y) {
+    zdt3(dim, x, y);
+    return false;
+}
+
+void zdt3BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 2, xs, ys, zdt3);
+}
+
+bool zdt4C(int dim, const double *x, double *y) {
+    zdt4(dim, x, y);
+    return false;
+}
+
+void zdt4BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 2, xs, ys, zdt4);
+}
+
+bool zdt5C(int dim, const double *x, double *y) {
+    zdt5(dim, x, y);
+    return false;
+}
+
+void zdt5BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 2, xs, ys, zdt5);
+}
+
+bool zdt6C(int dim, const double *x, double *y) {
+    zdt6(dim, x, y);
+    return false;
+}
+
+void zdt6BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 2, xs, ys, zdt6);
+}
+
+bool dtlz1C(int dim, const double *x, double *y) {
+    dtlz1(dim, 3, x, y);
+    return false;
+}
+
+void dtlz1BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 3, xs, ys, dtlz3obj<dtlz1>);
+}
+
+bool dtlz2C(int dim, const double *x, double *y) {
+    dtlz2(dim, 3, x, y);
+    return false;
+}
+
+void dtlz2BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 3, xs, ys, dtlz3obj<dtlz2>);
+}
+
+bool dtlz3C(int dim, const double *x, double *y) {
+    dtlz3(dim, 3, x, y);
+    return false;
+}
+
+void dtlz3BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 3, xs, ys, dtlz3obj<dtlz3>);
+}
+
+bool dtlz4C(int dim, const double *x, double *y) {
+    dtlz4(dim, 3, x, y);
+    return false;
+}
+
+void dtlz4BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 3, xs, ys, dtlz3obj<dtlz4>);
+}
+
+bool dtlz5C(int dim, const double *x, double *y) {
+    dtlz5(dim, 3, x, y);
+    return false;
+}
+
+void dtlz5BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 3, xs, ys, dtlz3obj<dtlz5>);
+}
+
+bool dtlz6C(int dim, const double *x, double *y) {
+    dtlz6(dim, 3, x, y);
+    return false;
+}
+
+void dtlz6BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 3, xs, ys, dtlz3obj<dtlz6>);
+}
+
+bool dtlz7C(int dim, const double *x, double *y) {
+    dtlz7(dim, 3, x, y);
+    return false;
+}
+
+void dtlz7BatchC(int popsize, int dim, double *xs, double *ys) {
+    batchMo(popsize, dim, 3, xs, ys, dtlz3obj<dtlz7>);
+}
+}
@@ -0,0 +1,28 @@
+# Copyright (c) Dietmar Wolz.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory.
+
+# Compares integration steps per second of the dynamic size and the fixed size
+# (compile time dimension) integrators for the ODE models in
+# https://github.com/dietmarwo/fast-cma-es/blob/master/_fcmaescpp/ascent.cpp
+
+import ctypes as ct
+import numpy as np
+from fcmaes.cmaescpp import libcmalib
+
+benchmarkAscent_C = libcmalib.benchmarkAscent_C
+benchmarkAscent_C.argtypes = [ct.c_double, ct.POINTER(ct.c_double)]
+
+names = ['RK4 Damp', 'RK4 F8', 'RK4 PVTwaste', 'Dopri45 PVTwaste']
+
+def main(seconds = 2.0):
+    res = np.zeros(8)
+    benchmarkAscent_C(seconds, res.ctypes.data_as(ct.POINTER(ct.c_double)))
+    for i, name in enumerate(names):
+        dyn, fixed = res[2*i], res[2*i+1]
+        print("{0:<18} dynamic = {1:.3g} fixed = {2:.3g} steps/sec speedup = {3:.2f}"
+              .format(name, dyn, fixed, fixed / dyn))
+
+if __name__ == '__main__':
+    main()
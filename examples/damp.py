@@ -35,11 +35,16 @@ def integrate(I, t):
 # C-based integration    
 def integrate_C(y, dt, alpha, step):
     try:
-        array_type = ct.c_double * y.size     
-        ry = integrateDamp_C(array_type(*y), alpha, dt, step)
-        y = np.array(np.fromiter(ry, dtype=np.float64, count=y.size))
-        freemem(ry)
-        return y
+        if not batch_C: # older native library, result is allocated natively
+            array_type = ct.c_double * y.size     
+            ry = integrateDamp_C(array_type(*y), alpha, dt, step)
+            y = np.array(np.fromiter(ry, dtype=np.float64, count=y.size))
+            freemem(ry)
+            return y
+        ys = np.array(y, dtype=np.float64)
+        ys_p = ys.ctypes.data_as(ct.POINTER(ct.c_double))
+        integrateDampBatch_C(1, ys_p, (ct.c_double*1)(alpha), (ct.c_double*1)(dt), step, 1, ys_p)
+        return ys
     except Exception as e:
         return None # fail
 
@@ -132,11 +137,17 @@ def optimize_qd(dim):
     plot_archive(problem, archive)
 
 from fcmaes.cmaescpp import libcmalib
-integrateDamp_C = libcmalib.integrateDamp_C
-integrateDamp_C.argtypes = [ct.POINTER(ct.c_double), ct.c_double, ct.c_double, ct.c_double]
-integrateDamp_C.restype = ct.POINTER(ct.c_double)   
-freemem = libcmalib.free_mem
-freemem.argtypes = [ct.POINTER(ct.c_double)]
+batch_C = hasattr(libcmalib, "integrateDampBatch_C")
+if batch_C:
+    integrateDampBatch_C = libcmalib.integrateDampBatch_C
+    integrateDampBatch_C.argtypes = [ct.c_int, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), 
+                ct.POINTER(ct.c_double), ct.c_double, ct.c_int, ct.POINTER(ct.c_double)]
+else:
+    integrateDamp_C = libcmalib.integrateDamp_C
+    integrateDamp_C.argtypes = [ct.POINTER(ct.c_double), ct.c_double, ct.c_double, ct.c_double]
+    integrateDamp_C.restype = ct.POINTER(ct.c_double)   
+    freemem = libcmalib.free_mem
+    freemem.argtypes = [ct.POINTER(ct.c_double)]
     
 if __name__ == '__main__':    
     dim = 12
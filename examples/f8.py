@@ -71,19 +71,29 @@ def obj_f(X):
     except Exception:
         return 1E10 # fail
 
+# C-based integration, the batch entry point writes into the numpy buffer
+def integrate_C(y, w, dt, step):
+    if not batch_C: # older native library, result is allocated natively
+        array_type = ct.c_double * y.size 
+        ry = integrateF8_C(array_type(*y), w, dt, step)
+        y = np.array(np.fromiter(ry, dtype=np.float64, count=y.size))
+        freemem(ry)
+        return y
+    ys = np.array(y, dtype=np.float64)
+    ys_p = ys.ctypes.data_as(ct.POINTER(ct.c_double))
+    integrateF8Batch_C(1, ys_p, (ct.c_double*1)(w), (ct.c_double*1)(dt), step, 1, ys_p)
+    return ys
+
 def obj_f_c(X):
     try:
         y = np.asarray([0.4655, 0., 0.])
-        array_type = ct.c_double * y.size 
         n = len(X)     
         for i in range(n):
             if X[i] == 0:
                 continue
             #  bang-bang type switches starting with w(t) = 1.
             w = (i + 1) % 2
-            ry = integrateF8_C(array_type(*y), w, X[i], 0.1)
-            y = np.array(np.fromiter(ry, dtype=np.float64, count=y.size))
-            freemem(ry)
+            y = integrate_C(y, w, X[i], 0.1)
 
         val0 = np.sum(X)
         penalty = np.sum(np.abs(y))
@@ -166,11 +176,17 @@ def test_gclde_parallel_eval(problem):
     return ret
     
 
-integrateF8_C = libcmalib.integrateF8_C
-integrateF8_C.argtypes = [ct.POINTER(ct.c_double), ct.c_double, ct.c_double, ct.c_double]
-integrateF8_C.restype = ct.POINTER(ct.c_double)   
-freemem = libcmalib.free_mem
-freemem.argtypes = [ct.POINTER(ct.c_double)]
+batch_C = hasattr(libcmalib, "integrateF8Batch_C")
+if batch_C:
+    integrateF8Batch_C = libcmalib.integrateF8Batch_C
+    integrateF8Batch_C.argtypes = [ct.c_int, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), 
+                ct.POINTER(ct.c_double), ct.c_double, ct.c_int, ct.POINTER(ct.c_double)]
+else:
+    integrateF8_C = libcmalib.integrateF8_C
+    integrateF8_C.argtypes = [ct.POINTER(ct.c_double), ct.c_double, ct.c_double, ct.c_double]
+    integrateF8_C.restype = ct.POINTER(ct.c_double)   
+    freemem = libcmalib.free_mem
+    freemem.argtypes = [ct.POINTER(ct.c_double)]
 
 if __name__ == '__main__':
     
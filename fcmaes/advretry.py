@@ -11,6 +11,7 @@ import math
 import threadpoolctl
 import _pickle as cPickle
 import bz2
+import itertools
 import ctypes as ct
 import numpy as np
 from numpy.linalg import norm
@@ -22,6 +23,7 @@ from scipy.optimize import OptimizeResult, Bounds
 
 from fcmaes.retry import _convertBounds, plot
 from fcmaes.optimizer import Optimizer, dtime, fitting, de_cma, logger
+from fcmaes.evaluator import libcmalib, _bind
 
 import logging
 from typing import Optional, Callable, List
@@ -165,7 +167,15 @@ def minimize_plot(name: str,
  
 class Store(object):
     """thread safe storage for optimization retry results; 
-    delivers boundary and initial step size vectors for advanced retry crossover operation."""
+    delivers boundary and initial step size vectors for advanced retry crossover operation.
+    Holds the settings and statistics common to both implementations, Store(...) creates
+    a NativeStore if the native library exports it and the platform supports shared 
+    memory (POSIX), otherwise a PyStore."""
+    
+    def __new__(cls, *args, **kwargs):
+        if cls is Store:
+            cls = NativeStore if native_store else PyStore
+        return super().__new__(cls)
          
     def __init__(self, 
                  fun: Callable[[ArrayLike], float], # fitness function
@@ -196,22 +206,7 @@ class Store(object):
         self.max_eval_fac = max_eval_fac
         self.check_interval = check_interval       
         self.dim = len(self.lower)
-        self.random = Random()
         self.t0 = time.perf_counter()
-    
-        #shared between processes
-        self.add_mutex = mp.Lock()    
-        self.check_mutex = mp.Lock()                     
-        self.xs = mp.RawArray(ct.c_double, capacity * self.dim)
-        self.ys = mp.RawArray(ct.c_double, capacity)                  
-        self.eval_fac = mp.RawValue(ct.c_double, 1)
-        self.count_evals = mp.RawValue(ct.c_long, 0)   
-        self.count_runs = mp.RawValue(ct.c_int, 0) 
-        self.num_stored = mp.RawValue(ct.c_int, 0) 
-        self.num_sorted = mp.RawValue(ct.c_int, 0)  
-        self.best_y = mp.RawValue(ct.c_double, np.inf) 
-        self.worst_y = mp.RawValue(ct.c_double, np.inf)  
-        self.best_x = mp.RawArray(ct.c_double, self.dim)
         self.statistic_num = statistic_num
         self.datafile = datafile
  
@@ -222,6 +217,11 @@ class Store(object):
             self.si = mp.RawValue(ct.c_int, 0)
             self.sevals = mp.RawValue(ct.c_long, 0)
             self.bval = mp.RawValue(ct.c_double, np.inf)
+        self._create_entries()
+
+    def _create_entries(self):
+        """creates the entries shared between processes."""
+        raise NotImplementedError('use NativeStore or PyStore')
 
     # register improvement - time and value
     def wrapper(self, x: ArrayLike) -> float:
@@ -249,25 +249,6 @@ class Store(object):
     def load(self, name: str):
         data = cPickle.load(bz2.BZ2File(name + '.pbz2', 'rb'))
         self.set_data(data)
-  
-    def get_data(self) -> List:
-        data = []
-        data.append(self.get_xs())
-        data.append(self.get_ys())
-        data.append(self.get_x_best())
-        data.append(self.get_y_best())
-        data.append(self.num_stored.value)
-        return data
-        
-    def set_data(self, data: ArrayLike):
-        xs = data[0]
-        ys = data[1]
-        for i in range(len(ys)):
-            self.replace(i, ys[i], xs[i])
-        self.best_x[:] = data[2][:]
-        self.best_y.value = data[3]
-        self.num_stored.value = data[4]
-        self.sort()
                
     def get_improvements(self) -> np.ndarray:
         return np.array(list(zip(self.time[:self.si.value], self.val[:self.si.value])))
@@ -287,7 +268,212 @@ class Store(object):
                 val = vs[ti]
             stats.append(val)
         return stats
+                 
+    def distance(self, xprev: np.ndarray, x: np.ndarray) -> float: 
+        """distance between entries in store."""
+        return norm((x - xprev) / self.delta) / math.sqrt(self.dim)
+
+    def get_x(self, pid: int) -> np.ndarray:
+        return self.get_xs()[pid]
+
+    def get_y(self, pid: int) -> float:
+        return self.get_ys()[pid]
+
+class NativeStore(Store):
+    """Thin wrapper around the native concurrent store of advstore.h living in shared 
+    memory: each worker process appends its results to its own insertion buffer, 
+    a single compaction step merges them into the sorted entries. Requires a 
+    POSIX platform (shm_open)."""
+
+    def _create_entries(self):
+        _unlink_stale_stores()
+        self.name = '/' + _store_prefix + '{0}_{1}'.format(os.getpid(), next(_store_ids))
+        array_type = ct.c_double * self.dim
+        self.ptr = createAdvStore_C(self.name.encode('utf-8'), self.dim, self.capacity, 
+                                    max(2, mp.cpu_count()), 
+                                    array_type(*self.lower), array_type(*self.upper),
+                                    Random().getrandbits(63))
+        if not self.ptr:
+            raise ValueError('cannot create shared memory store ' + self.name)
+        self.owner = os.getpid()
+        self.slot_pid = None
+
+    def __getstate__(self):
+        """spawned worker processes map the store by name."""
+        state = self.__dict__.copy()
+        del state['ptr']
+        return state
+    
+    def __setstate__(self, state):
+        self.__dict__.update(state)
+        self.ptr = attachAdvStore_C(self.name.encode('utf-8'))
+        if not self.ptr:
+            raise ValueError('cannot attach shared memory store ' + self.name)
+
+    def __del__(self):
+        if getattr(self, 'ptr', None):
+            closeAdvStore_C(self.ptr, os.getpid() == self.owner)
+            self.ptr = None
+  
+    def get_data(self) -> List:
+        data = []
+        xs, ys = self._data()
+        data.append(xs)
+        data.append(ys)
+        data.append(self.get_x_best())
+        data.append(self.get_y_best())
+        data.append(len(ys))
+        return data
+        
+    def set_data(self, data: ArrayLike):
+        n = data[4]
+        xs = np.ascontiguousarray(data[0][:n], dtype=np.float64)
+        ys = np.ascontiguousarray(data[1][:n], dtype=np.float64)
+        best_x = np.ascontiguousarray(data[2], dtype=np.float64)
+        setDataAdvStore_C(self.ptr, n, xs.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                          ys.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                          best_x.ctypes.data_as(ct.POINTER(ct.c_double)), data[3])
                                     
+    def eval_num(self, max_evals: int) -> int:
+        return int(evalFacAdvStore_C(self.ptr) * max_evals)
+                                               
+    def limits(self) -> Tuple[float, np.ndarray, np.ndarray, np.ndarray, np.ndarray]: 
+        """guess, boundaries and initial step size for crossover operation."""
+        x1 = np.empty(self.dim)
+        lower = np.empty(self.dim)
+        upper = np.empty(self.dim)
+        sdev = np.empty(self.dim)
+        y0 = limitsAdvStore_C(self.ptr, x1.ctypes.data_as(ct.POINTER(ct.c_double)),
+                              lower.ctypes.data_as(ct.POINTER(ct.c_double)),
+                              upper.ctypes.data_as(ct.POINTER(ct.c_double)),
+                              sdev.ctypes.data_as(ct.POINTER(ct.c_double)))
+        if y0 >= sys.float_info.max:
+            return np.inf, None, None, None, None
+        return y0, x1, lower, upper, sdev
+        
+    def crossover(self) -> Tuple[int,int]: # Choose two good entries for recombination
+        """indices of store entries to be used for crossover operation."""
+        ij = (ct.c_int * 2)()
+        if crossoverAdvStore_C(self.ptr, ij) == 0:
+            return -1, -1
+        return ij[0], ij[1]
+
+    def sort(self) -> int: 
+        """merges all added results into the sorted entries, keep only the 90% best 
+        to make room for new ones; skip entries having similar x values than their 
+        neighbors to preserve diversity"""
+        return sortAdvStore_C(self.ptr)
+
+    def add_result(self, y: float, xs: np.ndarray, evals: int, limit: Optional[float] = np.inf):
+        """registers an optimization result at the store."""
+        if self.slot_pid != os.getpid(): # insertion buffer of this process
+            self.slot = slotAdvStore_C(self.ptr)
+            self.slot_pid = os.getpid()
+        x = np.ascontiguousarray(xs, dtype=np.float64)
+        if addAdvStore_C(self.ptr, self.slot, y, x.ctypes.data_as(ct.POINTER(ct.c_double)),
+                         evals, limit):
+            self.dump()
+            if not self.datafile is None:
+                self.save(self.datafile)
+      
+    def _data(self) -> Tuple[np.ndarray, np.ndarray]:
+        xs = np.empty((self.capacity, self.dim))
+        ys = np.empty(self.capacity)
+        n = dataAdvStore_C(self.ptr, xs.ctypes.data_as(ct.POINTER(ct.c_double)),
+                           ys.ctypes.data_as(ct.POINTER(ct.c_double)))
+        return xs[:n], ys[:n]
+
+    def get_xs(self) -> np.ndarray:
+        return self._data()[0]
+
+    def get_x_best(self) -> np.ndarray:
+        x = np.empty(self.dim)
+        bestAdvStore_C(self.ptr, x.ctypes.data_as(ct.POINTER(ct.c_double)))
+        return x
+
+    def get_ys(self) -> np.ndarray:
+        return self._data()[1]
+
+    def get_y_best(self) -> float:
+        y = bestAdvStore_C(self.ptr, None)
+        return np.inf if y >= sys.float_info.max else y
+
+    def get_count_evals(self) -> int:
+        return evalsAdvStore_C(self.ptr)
+  
+    def get_count_runs(self) -> int:
+        return runsAdvStore_C(self.ptr)
+
+    def get_runs_compare_incr(self, limit: float) -> bool:
+        """trigger sorting after check_interval calls. """
+        return nextRunAdvStore_C(self.ptr, int(limit), self.check_interval, 
+                                 self.max_eval_fac, self.eval_fac_incr) != 0
+
+    def dump(self):
+        """logs the current status of the store if logger defined."""
+        if self.logger is None:
+            return
+        Ys = self.get_ys()
+        vals = []
+        for i in range(min(20, len(Ys))):
+            vals.append(round(Ys[i],2))     
+        dt = dtime(self.t0)+.000001  
+        evals = self.get_count_evals()          
+        message = '{0} {1} {2} {3} {4:.6f} {5:.2f} {6} {7} {8!s} {9!s}'.format(
+            dt, int(evals / dt), self.get_count_runs(), evals, 
+            self.get_y_best(), Ys[-1] if len(Ys) > 0 else np.inf, len(Ys), 
+            int(evalFacAdvStore_C(self.ptr)), vals, list(self.get_x_best()))
+        self.logger.info(message)
+   
+class PyStore(Store):
+    """Store keeping its entries in multiprocessing raw arrays guarded by a lock. 
+    Used if the native store is not available."""
+         
+    def _create_entries(self):
+        self.random = Random()
+
+        #shared between processes
+        self.add_mutex = mp.Lock()    
+        self.check_mutex = mp.Lock()                     
+        self.xs = mp.RawArray(ct.c_double, self.capacity * self.dim)
+        self.ys = mp.RawArray(ct.c_double, self.capacity)                  
+        self.eval_fac = mp.RawValue(ct.c_double, 1)
+        self.count_evals = mp.RawValue(ct.c_long, 0)   
+        self.count_runs = mp.RawValue(ct.c_int, 0) 
+        self.num_stored = mp.RawValue(ct.c_int, 0) 
+        self.num_sorted = mp.RawValue(ct.c_int, 0)  
+        self.best_y = mp.RawValue(ct.c_double, np.inf) 
+        self.worst_y = mp.RawValue(ct.c_double, np.inf)  
+        self.best_x = mp.RawArray(ct.c_double, self.dim)
+
+    def __getstate__(self):
+        return self.__dict__
+    
+    def __setstate__(self, state):
+        self.__dict__.update(state)
+
+    def __del__(self):
+        pass
+
+    def get_data(self) -> List:
+        data = []
+        data.append(self.get_xs())
+        data.append(self.get_ys())
+        data.append(self.get_x_best())
+        data.append(self.get_y_best())
+        data.append(self.num_stored.value)
+        return data
+        
+    def set_data(self, data: ArrayLike):
+        xs = data[0]
+        ys = data[1]
+        for i in range(len(ys)):
+            self.replace(i, ys[i], xs[i])
+        self.best_x[:] = data[2][:]
+        self.best_y.value = data[3]
+        self.num_stored.value = data[4]
+        self.sort()
+
     def eval_num(self, max_evals: int) -> int:
         return int(self.eval_fac.value * max_evals)
                                                
@@ -309,16 +495,12 @@ class Store(object):
         upper = np.minimum(self.upper, x0 + delta_bound)
         sdev = np.clip(diff_fac * deltax / self.delta, 0.001, 0.5)        
         return y0, x1, lower, upper, sdev
-                 
-    def distance(self, xprev: np.ndarray, x: np.ndarray) -> float: 
-        """distance between entries in store."""
-        return norm((x - xprev) / self.delta) / math.sqrt(self.dim)
-        
+
     def replace(self, i: int, y: float, xs: np.ndarray):
         """replace entry in store."""
         self.set_y(i, y)
         self.set_x(i, xs)
-        
+
     def crossover(self) -> Tuple[int,int]: # Choose two good entries for recombination
         """indices of store entries to be used for crossover operation."""
         n = self.num_sorted.value
@@ -364,7 +546,7 @@ class Store(object):
         self.num_sorted.value = numStored  
         self.num_stored.value = numStored     
         self.worst_y.value = self.get_y(numStored-1)
-        return numStored        
+        return numStored
 
     def add_result(self, y: float, xs: np.ndarray, evals: int, limit: Optional[float] = np.inf):
         """registers an optimization result at the store."""
@@ -383,7 +565,7 @@ class Store(object):
                 ns = self.num_stored.value
                 self.num_stored.value = ns + 1
                 self.replace(ns, y, xs)
-      
+
     def get_x(self, pid: int) -> np.ndarray:
         return self.xs[pid*self.dim:(pid+1)*self.dim]
 
@@ -441,7 +623,7 @@ class Store(object):
             self.best_y.value, self.worst_y.value, self.num_stored.value, int(self.eval_fac.value), 
             vals, self.best_x[:])
         self.logger.info(message)
-   
+
 def _retry_loop(pid, rgs, store, optimize, value_limit, stop_fitness = -np.inf):    
     fun = store.wrapper if store.statistic_num > 0 else store.fun
     #reinitialize logging config for windows -  multi threading fix
@@ -449,7 +631,7 @@ def _retry_loop(pid, rgs, store, optimize, value_limit, stop_fitness = -np.inf):
         store.logger = logger()
     
     with threadpoolctl.threadpool_limits(limits=1, user_api="blas"):    
-        while store.get_runs_compare_incr(store.num_retries) and store.best_y.value > stop_fitness:               
+        while store.get_runs_compare_incr(store.num_retries) and store.get_y_best() > stop_fitness:               
             if _crossover(fun, store, optimize, rgs[pid]):
                 continue
             try:
@@ -476,3 +658,54 @@ def _crossover(fun, store, optimize, rg):
     except:
         return False   
     return True
+
+# distinguishes the shared memory segments of the stores of a process
+_store_ids = itertools.count()
+
+# shared memory segments of native stores are named <prefix><owner pid>_<id>
+_store_prefix = 'fcmaes_adv_'
+
+def _unlink_stale_stores(shm_dir = '/dev/shm'):
+    """removes the segments of stores whose owner process died without closing 
+    them (crashed or killed), their names are visible in shm_dir on Linux."""
+    if not os.path.isdir(shm_dir):
+        return
+    for name in os.listdir(shm_dir):
+        if not name.startswith(_store_prefix):
+            continue
+        try:
+            pid = int(name[len(_store_prefix):].split('_')[0])
+            os.kill(pid, 0)
+        except ProcessLookupError: # owner is dead
+            try:
+                os.unlink(os.path.join(shm_dir, name))
+            except OSError:
+                pass
+        except (ValueError, OSError): # foreign name or process of another user
+            pass
+
+# the native store needs shm_open and a native library exporting it 
+native_store = not libcmalib is None and os.name == 'posix' and \
+    hasattr(libcmalib, "createAdvStore_C")
+
+if not libcmalib is None: 
+    
+    createAdvStore_C = _bind("createAdvStore_C", [ct.c_char_p, ct.c_int, ct.c_int, ct.c_int,
+                                                 ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), ct.c_long], ct.c_void_p)
+    attachAdvStore_C = _bind("attachAdvStore_C", [ct.c_char_p], ct.c_void_p)
+    closeAdvStore_C = _bind("closeAdvStore_C", [ct.c_void_p, ct.c_bool])
+    slotAdvStore_C = _bind("slotAdvStore_C", [ct.c_void_p], ct.c_int)
+    addAdvStore_C = _bind("addAdvStore_C", [ct.c_void_p, ct.c_int, ct.c_double, ct.POINTER(ct.c_double),
+                                           ct.c_long, ct.c_double], ct.c_int)
+    sortAdvStore_C = _bind("sortAdvStore_C", [ct.c_void_p], ct.c_int)
+    nextRunAdvStore_C = _bind("nextRunAdvStore_C", [ct.c_void_p, ct.c_int, ct.c_int, ct.c_double, ct.c_double], ct.c_int)
+    evalFacAdvStore_C = _bind("evalFacAdvStore_C", [ct.c_void_p], ct.c_double)
+    evalsAdvStore_C = _bind("evalsAdvStore_C", [ct.c_void_p], ct.c_long)
+    runsAdvStore_C = _bind("runsAdvStore_C", [ct.c_void_p], ct.c_int)
+    bestAdvStore_C = _bind("bestAdvStore_C", [ct.c_void_p, ct.POINTER(ct.c_double)], ct.c_double)
+    dataAdvStore_C = _bind("dataAdvStore_C", [ct.c_void_p, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)], ct.c_int)
+    setDataAdvStore_C = _bind("setDataAdvStore_C", [ct.c_void_p, ct.c_int, ct.POINTER(ct.c_double),
+                                                   ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), ct.c_double])
+    crossoverAdvStore_C = _bind("crossoverAdvStore_C", [ct.c_void_p, ct.POINTER(ct.c_int)], ct.c_int)
+    limitsAdvStore_C = _bind("limitsAdvStore_C", [ct.c_void_p, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double),
+                                                 ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)], ct.c_double)
@@ -7,35 +7,58 @@ import sys
 import math
 import os
 import ctypes as ct
+import numpy as np
 from scipy.optimize import Bounds
 from fcmaes.decpp import libcmalib
+from fcmaes.evaluator import _bind
+
+astro_map = {}
+astro_batch_map = {}
 
 if not libcmalib is None: 
     
-    astro_map = {  
-        "messengerfullC": libcmalib.messengerfullC,
-        "messengerC": libcmalib.messengerC,
-        "gtoc1C": libcmalib.gtoc1C,
-        "cassini1C": libcmalib.cassini1C,
-        "cassini1minlpC": libcmalib.cassini1minlpC,
-        "cassini2C": libcmalib.cassini2C,
-        "rosettaC": libcmalib.rosettaC,
-        "sagasC": libcmalib.sagasC,
-        "tandemC": libcmalib.tandemC,
-        "tandemCu": libcmalib.tandemCu,
-        "cassini2minlpC": libcmalib.cassini2minlpC,
-    }
+    # objectives not exported by the native library are skipped
+    for name in ["messengerfullC", "messengerC", "gtoc1C", "cassini1C",
+                 "cassini1minlpC", "cassini2C", "rosettaC", "sagasC",
+                 "tandemC", "tandemCu", "cassini2minlpC"]:
+        if hasattr(libcmalib, name):
+            astro_map[name] = getattr(libcmalib, name)
+
+    # variants based on the JPL low precision ephemerides (gtop.cpp), their
+    # values deviate from the GTOP reference. The batch variants evaluate a 
+    # whole population in parallel
+    for name in ["messengerfullLpC", "gtoc1LpC", "cassini1LpC", "cassini2LpC", 
+                 "rosettaLpC", "sagasLpC"]:
+        if hasattr(libcmalib, name):
+            astro_map[name] = getattr(libcmalib, name)
+        batch = name[:-1] + "BatchC"
+        if hasattr(libcmalib, batch):
+            astro_batch_map[name] = getattr(libcmalib, batch)
+            astro_batch_map[name].argtypes = [ct.c_int, ct.c_int, 
+                    ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)]
 
-    freemem = libcmalib.free_mem
-    freemem.argtypes = [ct.POINTER(ct.c_double)]    
+    lambertBatch_C = _bind("lambertBatch_C", [ct.c_int, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double),
+                                             ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), ct.POINTER(ct.c_int), 
+                                             ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), ct.c_int], ct.c_int)
+
+    if hasattr(libcmalib, "free_mem"):
+        freemem = libcmalib.free_mem
+        freemem.argtypes = [ct.POINTER(ct.c_double)]    
     
 class Astrofun(object):
-    """Provides access to ESAs GTOP optimization test functions."""
-    def __init__(self, name, fun_c, lower, upper):    
+    """Provides access to ESAs GTOP optimization test functions.
+    lp = True selects the variant based on the JPL low precision ephemerides,
+    its values deviate from the GTOP reference."""
+    def __init__(self, name, fun_c, lower, upper, lp = False):    
+        if lp:
+            name += ' lp'
+            fun_c = fun_c[:-1] + 'LpC'
         self.name = name 
         self.fun_c = fun_c 
         self.bounds = Bounds(lower, upper)
         self.fun = python_fun(fun_c, self.bounds)
+        if fun_c in astro_batch_map:
+            self.batch_fun = python_batch_fun(fun_c)
 
 for func in astro_map:
     astro_map[func].argtypes = [ct.c_int, ct.POINTER(ct.c_double)]           
@@ -43,10 +66,10 @@ for func in astro_map:
 
 class MessFull(object):
     """ see https://www.esa.int/gsp/ACT/projects/gtop/messenger_full/ """
-    def __init__(self):    
+    def __init__(self, lp = False):    
         Astrofun.__init__(self, 'messenger full', "messengerfullC", 
                            [1900.0, 3.0,    0.0, 0.0,  100.0, 100.0, 100.0, 100.0, 100.0, 100.0,  0.01, 0.01, 0.01, 0.01, 0.01, 0.01,  1.1, 1.1, 1.05, 1.05, 1.05,  -math.pi, -math.pi, -math.pi, -math.pi, -math.pi],
-                           [2200.0, 4.05, 1.0, 1.0,  500.0, 500.0, 500.0, 500.0, 500.0, 550.0,  0.99, 0.99, 0.99, 0.99, 0.99, 0.99,  6.0,   6.0,    6.0,    6.0,    6.0,  math.pi,  math.pi,  math.pi,  math.pi,  math.pi]
+                           [2200.0, 4.05, 1.0, 1.0,  500.0, 500.0, 500.0, 500.0, 500.0, 550.0,  0.99, 0.99, 0.99, 0.99, 0.99, 0.99,  6.0,   6.0,    6.0,    6.0,    6.0,  math.pi,  math.pi,  math.pi,  math.pi,  math.pi], lp
         )
      
 class Messenger(object):
@@ -61,10 +84,10 @@ class Messenger(object):
 class Gtoc1(object):
     """ see https://www.esa.int/gsp/ACT/projects/gtop/gtoc1/ """
     
-    def __init__(self):    
+    def __init__(self, lp = False):    
         Astrofun.__init__(self, 'GTOC1', "gtoc1C", 
                            [3000.,14.,14.,14.,14.,100.,366.,300.],
-                           [10000.,2000.,2000.,2000.,2000.,9000.,9000.,9000.]       
+                           [10000.,2000.,2000.,2000.,2000.,9000.,9000.,9000.], lp       
                            )
         self.gfun = self.fun
         self.fun = self.gtoc1       
@@ -75,37 +98,37 @@ class Gtoc1(object):
 class Cassini1(object):
     """ see https://www.esa.int/gsp/ACT/projects/gtop/cassini1/ """
     
-    def __init__(self):    
+    def __init__(self, lp = False):    
         Astrofun.__init__(self, 'Cassini1', "cassini1C", 
                            [-1000.,30.,100.,30.,400.,1000.],
-                           [0.,400.,470.,400.,2000.,6000.]       
+                           [0.,400.,470.,400.,2000.,6000.], lp       
         )
 
 class Cassini2(object):
     """ see https://www.esa.int/gsp/ACT/projects/gtop/cassini2/ """
     
-    def __init__(self):    
+    def __init__(self, lp = False):    
         Astrofun.__init__(self, 'Cassini2', "cassini2C", 
             [-1000,3,0,0,100,100,30,400,800,0.01,0.01,0.01,0.01,0.01,1.05,1.05,1.15,1.7, -math.pi, -math.pi, -math.pi, -math.pi],
-            [0,5,1,1,400,500,300,1600,2200,0.9,0.9,0.9,0.9,0.9,6,6,6.5,291,math.pi,  math.pi,  math.pi,  math.pi]
+            [0,5,1,1,400,500,300,1600,2200,0.9,0.9,0.9,0.9,0.9,6,6,6.5,291,math.pi,  math.pi,  math.pi,  math.pi], lp
         )
 
 class Rosetta(object):
     """ see https://www.esa.int/gsp/ACT/projects/gtop/rosetta/ """
     
-    def __init__(self):    
+    def __init__(self, lp = False):    
         Astrofun.__init__(self, 'Rosetta', "rosettaC", 
             [1460,3,0,0,300,150,150,300,700,0.01,0.01,0.01,0.01,0.01,1.05,1.05,1.05,1.05, -math.pi, -math.pi, -math.pi, -math.pi],
-            [1825,5,1,1,500,800,800,800,1850,0.9,0.9,0.9,0.9,0.9,9,9,9,9,math.pi,  math.pi,  math.pi,  math.pi]
+            [1825,5,1,1,500,800,800,800,1850,0.9,0.9,0.9,0.9,0.9,9,9,9,9,math.pi,  math.pi,  math.pi,  math.pi], lp
         )
 
 class Sagas(object):
     """ see https://www.esa.int/gsp/ACT/projects/gtop/sagas/ """
     
-    def __init__(self):    
+    def __init__(self, lp = False):    
         Astrofun.__init__(self, 'Sagas', "sagasC", 
             [7000,0,0,0,50,300,0.01,0.01,1.05,8, -math.pi, -math.pi],
-            [9100,7,1,1,2000,2000,0.9,0.9,7,500, math.pi,  math.pi]
+            [9100,7,1,1,2000,2000,0.9,0.9,7,500, math.pi,  math.pi], lp
         )
 
 class Tandem(object):
@@ -268,3 +291,38 @@ class python_fun(object):
             val = 1E10
         return val 
 
+def lambert_batch(r1, r2, tof, mu, revs = None, workers = 0):
+    """Solves n prograde Lambert problems natively.
+    r1, r2: (n,3) positions, tof: n transfer times, mu: n gravity parameters
+    or a scalar. revs: n revolution numbers, N > 0 / -N select the left / right 
+    branch of the N revolution solutions, default is single revolution.
+    Returns the (n,3) velocities v1, v2, NaN for problems without solution."""
+    r1 = np.ascontiguousarray(r1, dtype=np.float64)
+    r2 = np.ascontiguousarray(r2, dtype=np.float64)
+    n = len(r1)
+    tof = np.ascontiguousarray(np.broadcast_to(tof, n), dtype=np.float64)
+    mu = np.ascontiguousarray(np.broadcast_to(mu, n), dtype=np.float64)
+    revs = np.zeros(n, dtype=np.int32) if revs is None else \
+        np.ascontiguousarray(revs, dtype=np.int32)
+    v1 = np.empty((n, 3))
+    v2 = np.empty((n, 3))
+    dp = lambda a: a.ctypes.data_as(ct.POINTER(ct.c_double))
+    lambertBatch_C(n, dp(r1), dp(r2), dp(tof), dp(mu), 
+                   revs.ctypes.data_as(ct.POINTER(ct.c_int)), dp(v1), dp(v2), workers)
+    return v1, v2
+
+class python_batch_fun(object):
+    """Evaluates a population xs (popsize x dim) natively in parallel."""
+
+    def __init__(self, cfun):
+        self.cfun = cfun
+    
+    def __call__(self, xs):
+        xs = np.ascontiguousarray(xs, dtype=np.float64)
+        popsize, dim = xs.shape
+        ys = np.empty(popsize)
+        astro_batch_map[self.cfun](popsize, dim, 
+                xs.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                ys.ctypes.data_as(ct.POINTER(ct.c_double)))
+        ys[~np.isfinite(ys)] = 1E10
+        return ys
@@ -15,10 +15,10 @@ import ctypes as ct
 import numpy as np
 from numpy.random import MT19937, Generator
 from scipy.optimize import OptimizeResult, Bounds
-from fcmaes.evaluator import _check_bounds, _get_bounds, mo_call_back_type, callback_so, callback_par, call_back_par, parallel, libcmalib
+from fcmaes.evaluator import _check_bounds, _get_bounds, mo_call_back_type, callback_so, callback_par, call_back_par, parallel, libcmalib, _ask_many, _tell_many, _map_buffer, _bind
 
 import logging
-from typing import Optional, Callable, Union
+from typing import Optional, Callable, Union, Sequence, List, Tuple
 from numpy.typing import ArrayLike
 
 os.environ['MKL_DEBUG_CPU_TYPE'] = '5'
@@ -253,6 +253,29 @@ class ACMA_C:
             print (ex)
             return -1 
         
+    def screening(self, factor: Optional[int] = 4, forgetting: Optional[float] = 0.9):
+        """For expensive objectives: ask samples factor * popsize candidates and 
+        returns the popsize with the best values predicted by a quadratic surrogate
+        model of the told function values. The model is updated incrementally, 
+        forgetting in (0, 1] down weights older evaluations. factor <= 1 disables 
+        screening."""
+        enableScreeningACMA_C(self.ptr, factor, forgetting)
+
+    def buffer(self) -> Tuple[np.ndarray, np.ndarray]:
+        """Maps the population buffer owned by the optimizer as numpy arrays 
+        xs, shape (popsize, dim) and ys, shape (popsize,). Map it once, then
+        ask_buffer writes the next population into xs and tell_buffer reads the 
+        function values from ys, no data is copied or converted."""
+        return _map_buffer(bufferACMA_C, self, self.popsize, self.dim, 1)
+
+    def ask_buffer(self):
+        """Writes the next population into the xs array of buffer()."""
+        askBufferACMA_C(self.ptr)
+
+    def tell_buffer(self) -> int:
+        """Tells the function values stored in the ys array of buffer()."""
+        return tellBufferACMA_C(self.ptr)
+
     def population(self) -> np.array:
         try:
             popsize = self.popsize
@@ -283,6 +306,22 @@ class ACMA_C:
             res = OptimizeResult(x=None, fun=sys.float_info.max, nfev=0, nit=0, status=-1, success=False)
         return res
 
+def ask_many(optimizers: Sequence[ACMA_C], 
+             workers: Optional[int] = 0) -> List[np.ndarray]:
+    """Asks many ACMA_C instances using a single native call, the optimizers
+    are processed in parallel by at most workers threads, 0 means all cores.
+    Saves the per instance call overhead if hundreds of optimizers are 
+    driven together. Returns one (popsize, dim) array per optimizer."""
+    return _ask_many(askManyACMA_C, optimizers, workers)
+
+def tell_many(optimizers: Sequence[ACMA_C], 
+              ys: Sequence[ArrayLike], 
+              workers: Optional[int] = 0) -> np.ndarray:
+    """Tells many ACMA_C instances the function values of their last 
+    population using a single native call. Returns the stop criteria
+    of the optimizers."""
+    return _tell_many(tellManyACMA_C, optimizers, ys, workers)
+
 if not libcmalib is None: 
 
     optimizeACMA_C = libcmalib.optimizeACMA_C
@@ -310,6 +349,8 @@ if not libcmalib is None:
     tellACMA_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
     tellACMA_C.restype = ct.c_int
     
+    enableScreeningACMA_C = _bind("enableScreeningACMA_C", [ct.c_void_p, ct.c_int, ct.c_double])
+
     tellXACMA_C = libcmalib.tellXACMA_C
     tellXACMA_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)]
     tellXACMA_C.restype = ct.c_int
@@ -319,3 +360,11 @@ if not libcmalib is None:
     
     resultACMA_C = libcmalib.resultACMA_C
     resultACMA_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
+    
+    askManyACMA_C = _bind("askManyACMA_C", [ct.POINTER(ct.c_void_p), ct.c_int, ct.POINTER(ct.c_double), ct.c_int])
+    tellManyACMA_C = _bind("tellManyACMA_C", [ct.POINTER(ct.c_void_p), ct.c_int, ct.POINTER(ct.c_double),
+                                             ct.POINTER(ct.c_int), ct.c_int])
+    bufferACMA_C = _bind("bufferACMA_C", [ct.c_void_p, ct.POINTER(ct.POINTER(ct.c_double)),
+                                         ct.POINTER(ct.POINTER(ct.c_double))])
+    askBufferACMA_C = _bind("askBufferACMA_C", [ct.c_void_p])
+    tellBufferACMA_C = _bind("tellBufferACMA_C", [ct.c_void_p], ct.c_int)
@@ -15,10 +15,10 @@ import ctypes as ct
 import numpy as np
 from numpy.random import MT19937, Generator
 from scipy.optimize import OptimizeResult, Bounds
-from fcmaes.evaluator import _check_bounds, _get_bounds, callback_par, parallel, call_back_par, libcmalib
+from fcmaes.evaluator import _check_bounds, _get_bounds, callback_par, parallel, call_back_par, libcmalib, _ask_many, _tell_many, _map_buffer, _bind
 
 import logging
-from typing import Optional, Callable, Union
+from typing import Optional, Callable, Union, Sequence, List, Tuple
 from numpy.typing import ArrayLike
 
 os.environ['MKL_DEBUG_CPU_TYPE'] = '5'
@@ -211,6 +211,21 @@ class CRFMNES_C:
             print (ex)
             return -1        
 
+    def buffer(self) -> Tuple[np.ndarray, np.ndarray]:
+        """Maps the population buffer owned by the optimizer as numpy arrays 
+        xs, shape (popsize, dim) and ys, shape (popsize,). Map it once, then
+        ask_buffer writes the next population into xs and tell_buffer reads the 
+        function values from ys, no data is copied or converted."""
+        return _map_buffer(bufferCRFMNES_C, self, self.popsize, self.dim, 1)
+
+    def ask_buffer(self):
+        """Writes the next population into the xs array of buffer()."""
+        askBufferCRFMNES_C(self.ptr)
+
+    def tell_buffer(self) -> int:
+        """Tells the function values stored in the ys array of buffer()."""
+        return tellBufferCRFMNES_C(self.ptr)
+
     def population(self) -> np.ndarray:
         try:
             lamb = self.popsize
@@ -241,6 +256,22 @@ class CRFMNES_C:
             res = OptimizeResult(x=None, fun=sys.float_info.max, nfev=0, nit=0, status=-1, success=False)
         return res
 
+def ask_many(optimizers: Sequence[CRFMNES_C], 
+             workers: Optional[int] = 0) -> List[np.ndarray]:
+    """Asks many CRFMNES_C instances using a single native call, the optimizers
+    are processed in parallel by at most workers threads, 0 means all cores.
+    Saves the per instance call overhead if hundreds of optimizers are 
+    driven together. Returns one (popsize, dim) array per optimizer."""
+    return _ask_many(askManyCRFMNES_C, optimizers, workers)
+
+def tell_many(optimizers: Sequence[CRFMNES_C], 
+              ys: Sequence[ArrayLike], 
+              workers: Optional[int] = 0) -> np.ndarray:
+    """Tells many CRFMNES_C instances the function values of their last 
+    population using a single native call. Returns the stop criteria
+    of the optimizers."""
+    return _tell_many(tellManyCRFMNES_C, optimizers, ys, workers)
+
 if not libcmalib is None: 
 
     optimizeCRFMNES_C = libcmalib.optimizeCRFMNES_C
@@ -274,3 +305,11 @@ if not libcmalib is None:
     
     resultCRFMNES_C = libcmalib.resultCRFMNES_C
     resultCRFMNES_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
+    
+    askManyCRFMNES_C = _bind("askManyCRFMNES_C", [ct.POINTER(ct.c_void_p), ct.c_int, ct.POINTER(ct.c_double), ct.c_int])
+    tellManyCRFMNES_C = _bind("tellManyCRFMNES_C", [ct.POINTER(ct.c_void_p), ct.c_int, ct.POINTER(ct.c_double),
+                                                   ct.POINTER(ct.c_int), ct.c_int])
+    bufferCRFMNES_C = _bind("bufferCRFMNES_C", [ct.c_void_p, ct.POINTER(ct.POINTER(ct.c_double)),
+                                               ct.POINTER(ct.POINTER(ct.c_double))])
+    askBufferCRFMNES_C = _bind("askBufferCRFMNES_C", [ct.c_void_p])
+    tellBufferCRFMNES_C = _bind("tellBufferCRFMNES_C", [ct.c_void_p], ct.c_int)
@@ -23,11 +23,11 @@ import ctypes as ct
 import numpy as np
 from numpy.random import MT19937, Generator
 from scipy.optimize import OptimizeResult, Bounds
-from fcmaes.evaluator import mo_call_back_type, callback_so, libcmalib
+from fcmaes.evaluator import mo_call_back_type, callback_so, libcmalib, _ask_many, _tell_many, _map_buffer, _bind
 from fcmaes.de import _check_bounds
 
 import logging
-from typing import Optional, Callable, Tuple, Union
+from typing import Optional, Callable, Tuple, Union, Sequence, List
 from numpy.typing import ArrayLike
 
 os.environ['MKL_DEBUG_CPU_TYPE'] = '5'
@@ -230,6 +230,38 @@ class DE_C:
             print (ex)
             return -1        
 
+    def buffer(self) -> Tuple[np.ndarray, np.ndarray]:
+        """Maps the population buffer owned by the optimizer as numpy arrays 
+        xs, shape (popsize, dim) and ys, shape (popsize,). Map it once, then
+        ask_buffer writes the next population into xs and tell_buffer reads the 
+        function values from ys, no data is copied or converted."""
+        return _map_buffer(bufferDE_C, self, self.popsize, self.dim, 1)
+
+    def ask_buffer(self):
+        """Writes the next population into the xs array of buffer()."""
+        askBufferDE_C(self.ptr)
+
+    def tell_buffer(self) -> int:
+        """Tells the function values stored in the ys array of buffer()."""
+        return tellBufferDE_C(self.ptr)
+
+    def screening(self, factor: Optional[int] = 4, forgetting: Optional[float] = 0.9):
+        """For expensive objectives: each trial vector returned by ask is the best
+        of factor trials predicted by a quadratic surrogate model of the told 
+        function values. forgetting in (0, 1] down weights older evaluations.
+        factor <= 1 disables screening."""
+        enableScreeningDE_C(self.ptr, factor, forgetting)
+
+    def init_population(self, xs: ArrayLike, ys: ArrayLike):
+        """Replaces the initial population by already evaluated solutions, 
+        for instance read from an evaluation log, see fcmaes.evallog. 
+        Call it before the first ask."""
+        xs = np.ascontiguousarray(xs, dtype=np.float64)
+        ys = np.ascontiguousarray(ys, dtype=np.float64)
+        initPopulationDE_C(self.ptr, len(ys), 
+                           xs.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                           ys.ctypes.data_as(ct.POINTER(ct.c_double)))
+
     def population(self) -> np.array:
         try:
             popsize = self.popsize
@@ -260,6 +292,22 @@ class DE_C:
             res = OptimizeResult(x=None, fun=sys.float_info.max, nfev=0, nit=0, status=-1, success=False)
         return res
 
+def ask_many(optimizers: Sequence[DE_C], 
+             workers: Optional[int] = 0) -> List[np.ndarray]:
+    """Asks many DE_C instances using a single native call, the optimizers
+    are processed in parallel by at most workers threads, 0 means all cores.
+    Saves the per instance call overhead if hundreds of optimizers are 
+    driven together. Returns one (popsize, dim) array per optimizer."""
+    return _ask_many(askManyDE_C, optimizers, workers)
+
+def tell_many(optimizers: Sequence[DE_C], 
+              ys: Sequence[ArrayLike], 
+              workers: Optional[int] = 0) -> np.ndarray:
+    """Tells many DE_C instances the function values of their last 
+    population using a single native call. Returns the stop criteria
+    of the optimizers."""
+    return _tell_many(tellManyDE_C, optimizers, ys, workers)
+
 if not libcmalib is None: 
     
     optimizeDE_C = libcmalib.optimizeDE_C
@@ -291,9 +339,20 @@ if not libcmalib is None:
     tellDE_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
     tellDE_C.restype = ct.c_int
     
+    enableScreeningDE_C = _bind("enableScreeningDE_C", [ct.c_void_p, ct.c_int, ct.c_double])
+    
     populationDE_C = libcmalib.populationDE_C
     populationDE_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
     
     resultDE_C = libcmalib.resultDE_C
     resultDE_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
-
+    
+    askManyDE_C = _bind("askManyDE_C", [ct.POINTER(ct.c_void_p), ct.c_int, ct.POINTER(ct.c_double), ct.c_int])
+    tellManyDE_C = _bind("tellManyDE_C", [ct.POINTER(ct.c_void_p), ct.c_int, ct.POINTER(ct.c_double),
+                                         ct.POINTER(ct.c_int), ct.c_int])
+    bufferDE_C = _bind("bufferDE_C", [ct.c_void_p, ct.POINTER(ct.POINTER(ct.c_double)),
+                                     ct.POINTER(ct.POINTER(ct.c_double))])
+    askBufferDE_C = _bind("askBufferDE_C", [ct.c_void_p])
+    tellBufferDE_C = _bind("tellBufferDE_C", [ct.c_void_p], ct.c_int)
+    initPopulationDE_C = _bind("initPopulationDE_C", [ct.c_void_p, ct.c_int, ct.POINTER(ct.c_double),
+                                                     ct.POINTER(ct.c_double)])
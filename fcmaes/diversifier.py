@@ -203,9 +203,7 @@ def apply_advretry(fitness: Callable[[ArrayLike], float],
     yds = [qd_fitness(x) for x in xs]
     descs = np.array([yd[1] for yd in yds])
     ys = np.array([yd[0] for yd in yds])
-    niches = archive.index_of_niches(descs)
-    for i in range(len(ys)):
-        archive.set(niches[i], (ys[i], descs[i]), xs[i])
+    archive.update(xs, ys, descs)
     archive.argsort()
     if not logger is None:
         ys = np.sort(archive.get_ys())[:min(100, archive.capacity)] # best fitness values
@@ -248,8 +246,6 @@ def run_minimize_(archive, fitness, bounds, rg, opt_params, p, workers, evals, m
             else:        
                 minimize_(archive, fitness, bounds, rg, evals, max_evals, opt_params) 
 
-from fcmaes.mapelites import variation_,  iso_dd_
-                
 def run_map_elites_(archive, fitness, bounds, rg, evals, max_evals, opt_params = {}):    
     popsize = opt_params.get('popsize', 32)  
     use_sbx = opt_params.get('use_sbx', True)     
@@ -260,18 +256,14 @@ def run_map_elites_(archive, fitness, bounds, rg, evals, max_evals, opt_params =
     select_n = archive.capacity
     while evals.value < max_evals:              
         if use_sbx:
-            pop = archive.random_xs(select_n, popsize, rg)
-            xs = variation_(pop, bounds.lb, bounds.ub, rg, dis_c, dis_m)
+            xs = archive.sbx_xs(select_n, popsize, bounds.lb, bounds.ub, rg, dis_c, dis_m)
         else:
-            x1 = archive.random_xs(select_n, popsize, rg)
-            x2 = archive.random_xs(select_n, popsize, rg)
-            xs = iso_dd_(x1, x2, bounds.lb, bounds.ub, rg, iso_sigma, line_sigma)    
+            xs = archive.iso_dd_xs(select_n, popsize, bounds.lb, bounds.ub, rg, 
+                                   iso_sigma, line_sigma)    
         yds = [fitness(x) for x in xs]
         evals.value += popsize
-        descs = np.array([yd[1] for yd in yds])
-        niches = archive.index_of_niches(descs)
-        for i in range(len(yds)):
-            archive.set(niches[i], yds[i], xs[i])
+        ys = np.fromiter((yd[0] for yd in yds), dtype=float)
+        archive.update(xs, ys, np.array([yd[1] for yd in yds]))
         archive.argsort()   
         select_n = archive.get_occupied()  
 
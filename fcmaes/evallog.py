@@ -0,0 +1,129 @@
+# Copyright (c) Dietmar Wolz.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory.
+
+"""Native evaluation log.
+
+    While an EvalLog is active all native optimizers (optimize*_C / minimize
+    in the *cpp modules evaluating the objective function via Fitness) append
+    each evaluation as fixed width binary record (evaluation number, run id, x, y,
+    timestamp) to a memory mapped file. Appending is lock free, a thread reserves
+    a block of records at once. Processes forked while a log is active, like the
+    workers of retry or advretry, append to the same log. Recording doesn't slow 
+    down the optimization, the log can be used to audit runs, train surrogates 
+    or to warm start new optimizations:
+
+    with EvalLog('de.log', dim) as log:
+        decpp.minimize(fun, bounds=bounds, max_evaluations=50000)
+    xs, ys = read('de.log', dim, 31)
+    es = decpp.DE_C(bounds=bounds, popsize=31)
+    es.init_population(xs, ys)
+
+    For multi objective problems use nobj = number of objectives + constraints
+    when opening the log. Evaluations via Python ask/tell are not recorded, the
+    optimizer doesn't see the function values before tell.
+    Requires a POSIX platform (mmap)."""
+
+import ctypes as ct
+import numpy as np
+from fcmaes.evaluator import libcmalib, _bind
+
+from typing import Optional, Tuple
+from numpy.typing import ArrayLike
+
+class EvalLog:
+
+    def __init__(self, path: str, dim: int, nobj: Optional[int] = 1):
+        """Opens the log at path, an existing log of the same dim and nobj is continued."""
+        self.ptr = None
+        self.ptr = openEvalLog_C(path.encode('utf-8'), dim, nobj)
+        if not self.ptr:
+            raise ValueError('cannot open evaluation log ' + path)
+        self.path = path
+        self.dim = dim
+        self.nobj = nobj
+
+    def activate(self):
+        """Optimizers started afterwards record their evaluations."""
+        activateEvalLog_C(self.ptr)
+
+    def deactivate(self):
+        activateEvalLog_C(None)
+
+    def slots(self) -> int:
+        """Number of record slots, including not yet used ones."""
+        return slotsEvalLog_C(self.ptr)
+
+    def close(self):
+        """The file is closed after all optimizers using it are finished."""
+        if self.ptr:
+            closeEvalLog_C(self.ptr)
+            self.ptr = None
+
+    def __enter__(self):
+        self.activate()
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+def read(path: str,
+         dim: int,
+         n: int,
+         nobj: Optional[int] = 1,
+         ncon: Optional[int] = 0) -> Tuple[np.ndarray, np.ndarray]:
+    """Returns the n best records of a log, xs shape (k, dim), ys shape (k,) for
+    a single objective, else (k, nobj + ncon), k <= n. For multiple objectives
+    the first non-dominated fronts are returned. Constraint violating records
+    come last."""
+    ny = nobj + ncon
+    xs = np.empty((n, dim))
+    ys = np.empty((n, ny))
+    k = readEvalLog_C(path.encode('utf-8'), dim, nobj, ncon, n,
+                      xs.ctypes.data_as(ct.POINTER(ct.c_double)),
+                      ys.ctypes.data_as(ct.POINTER(ct.c_double)))
+    if k < 0:
+        raise ValueError(path + ' is no evaluation log of matching dimension')
+    if ny == 1:
+        return xs[:k], ys[:k,0]
+    return xs[:k], ys[:k]
+
+def acma_start(path: str, dim: int,
+               popsize: Optional[int] = 31) -> Tuple[np.ndarray, np.ndarray]:
+    """Returns x0 and input_sigma for cmaescpp.minimize / ACMA_C derived from the
+    best popsize/2 records of a single objective log: their weighted mean
+    and standard deviation."""
+    mu = max(2, popsize // 2)
+    xs, ys = read(path, dim, mu)
+    if len(ys) == 0:
+        raise ValueError('empty evaluation log ' + path)
+    weights = np.log(mu + 0.5) - np.log(np.arange(1, len(ys) + 1))
+    weights /= np.sum(weights)
+    x0 = weights @ xs
+    sigma = np.sqrt(weights @ (xs - x0)**2)
+    return x0, np.maximum(sigma, 1E-9)
+
+def load(path: str) -> Tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+    """Returns all records of a log: run ids, evaluation numbers, xs, ys and
+    timestamps (seconds since the epoch)."""
+    header = np.fromfile(path, dtype=np.int32, count=8)
+    dim, ny = header[3], header[4]
+    data = np.fromfile(path, dtype=np.float64, offset=64).reshape(-1, 3 + dim + ny)
+    evals = data[:,0].view(np.int64)
+    used = evals != 0
+    data = data[used]
+    return data[:,1].view(np.int64), evals[used], data[:,2:2+dim], \
+            data[:,2+dim:2+dim+ny], data[:,-1]
+
+if not libcmalib is None:
+
+    openEvalLog_C = _bind("openEvalLog_C", [ct.c_char_p, ct.c_int, ct.c_int], ct.c_void_p)
+    activateEvalLog_C = _bind("activateEvalLog_C", [ct.c_void_p])
+    slotsEvalLog_C = _bind("slotsEvalLog_C", [ct.c_void_p], ct.c_long)
+    closeEvalLog_C = _bind("closeEvalLog_C", [ct.c_void_p])
+    readEvalLog_C = _bind("readEvalLog_C", [ct.c_char_p, ct.c_int, ct.c_int, ct.c_int, ct.c_int,
+                                           ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)], ct.c_int)
@@ -312,6 +312,73 @@ class callback_par(object):
         except Exception as ex:
             print (ex)
 
+def _unsupported(name: str):
+    """Replaces the binding of a function the loaded native library doesn't 
+    export, calling it raises an error naming the missing function."""
+    def fail(*args):
+        raise NotImplementedError(name + ' is not exported by the native library '
+                                  'in fcmaes/lib, rebuild it from _fcmaescpp')
+    return fail
+
+def _bind(name: str, argtypes: list, restype = None):
+    """Binds the function name of the native library setting its argument and
+    result types. If the library doesn't export it, the returned function 
+    raises an error naming it, see _unsupported."""
+    if not hasattr(libcmalib, name):
+        return _unsupported(name)
+    fun = getattr(libcmalib, name)
+    fun.argtypes = argtypes
+    if not restype is None: # else the ctypes default int
+        fun.restype = restype
+    return fun
+
+def _ask_many(ask_many_c, optimizers, workers: int) -> list:
+    """Asks many native ask/tell optimizers using a single call of the batched
+    C function ask_many_c. Returns one (popsize, dim) array per optimizer."""
+    n = len(optimizers)
+    sizes = [opt.popsize*opt.dim for opt in optimizers]
+    ptrs = (ct.c_void_p * n)(*[opt.ptr for opt in optimizers])
+    res = np.empty(sum(sizes))
+    ask_many_c(ptrs, n, res.ctypes.data_as(ct.POINTER(ct.c_double)), workers)
+    xs = np.split(res, np.cumsum(sizes)[:-1])
+    return [x.reshape(opt.popsize, opt.dim) for x, opt in zip(xs, optimizers)]
+
+def _tell_many(tell_many_c, optimizers, ys, workers: int) -> np.ndarray:
+    """Tells many native ask/tell optimizers their function values using a 
+    single call of the batched C function tell_many_c. Returns the stop 
+    criteria of the optimizers. Raises ValueError if ys doesn't contain popsize 
+    values for each optimizer."""
+    n = len(optimizers)
+    if len(ys) != n:
+        raise ValueError('got ' + str(len(ys)) + ' value arrays for ' + 
+                         str(n) + ' optimizers')
+    ys = [np.asarray(y, dtype=np.float64).ravel() for y in ys]
+    for i, (y, opt) in enumerate(zip(ys, optimizers)):
+        if len(y) != opt.popsize:
+            raise ValueError('optimizer ' + str(i) + ' expects ' + str(opt.popsize) + 
+                             ' values, got ' + str(len(y)))
+    ptrs = (ct.c_void_p * n)(*[opt.ptr for opt in optimizers])
+    yall = np.concatenate(ys)
+    stops = np.zeros(n, dtype=np.int32)
+    tell_many_c(ptrs, n, yall.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                stops.ctypes.data_as(ct.POINTER(ct.c_int)), workers)
+    return stops
+
+def _map_buffer(buffer_c, owner, popsize: int, dim: int, nobj: int) -> Tuple[np.ndarray, np.ndarray]:
+    """Maps the population buffer owned by the native ask/tell optimizer of 
+    the Python wrapper owner as numpy arrays xs, shape (popsize, dim) and ys, 
+    shape (popsize,) or (popsize, nobj). The arrays reference owner, so the 
+    native optimizer isn't destroyed while they are in use."""
+    xs = ct.POINTER(ct.c_double)()
+    ys = ct.POINTER(ct.c_double)()
+    buffer_c(owner.ptr, ct.byref(xs), ct.byref(ys))
+    def as_array(p, shape):
+        a = ct.cast(p, ct.POINTER(ct.c_double * int(np.prod(shape)))).contents
+        a._owner = owner # the numpy array keeps a alive, a keeps the owner 
+        return np.ctypeslib.as_array(a).reshape(shape)
+    yshape = (popsize,) if nobj == 1 else (popsize, nobj)
+    return as_array(xs, (popsize, dim)), as_array(ys, yshape)
+
 basepath = os.path.dirname(os.path.abspath(__file__))
 
 try: 
@@ -43,8 +43,11 @@ are rejected. Restricted solution box bounds are used derived from statistics ma
 during the addition of new solution candidates. 
 
 7) The QD-archive uses shared memory to reduce inter-process communication overhead.
+If the native library is available, niche lookup, insertion of solution batches and the
+SBX and Iso+LineDD variation operators are performed natively, see _fcmaescpp/include/archive.h.
 """
 
+import os
 import numpy as np
 from numpy.random import Generator, MT19937, SeedSequence
 from multiprocessing import Process
@@ -55,6 +58,7 @@ from scipy.optimize import Bounds
 from pathlib import Path
 from fcmaes.optimizer import dtime, logger
 from fcmaes import cmaescpp
+from fcmaes.evaluator import libcmalib, _bind
 from numpy.random import default_rng
 import ctypes as ct
 from time import perf_counter
@@ -197,8 +201,10 @@ def set_KDTree(archive: Archive,
 
     if centers is None: # cache centers 
         centers = get_centers_(niche_num, len(qd_bounds.lb), samples_per_niche)
-    archive.kdt = KDTree(centers, leaf_size=30, metric='euclidean')  
-    archive.centers = centers         
+    if not native_archive: # else the native archive builds its own tree
+        archive.kdt = KDTree(centers, leaf_size=30, metric='euclidean')  
+    archive.centers = centers
+    archive.release_native()         
 
 def load_archive(name: str, 
                  bounds: Bounds, 
@@ -257,17 +263,13 @@ def run_map_elites_(archive, fitness, bounds, rg,
     with threadpoolctl.threadpool_limits(limits=1, user_api="blas"):
         for _ in range(generations):                
             if use_sbx:
-                pop = archive.random_xs(select_n, chunk_size, rg)
-                xs = variation_(pop, bounds.lb, bounds.ub, rg, dis_c, dis_m)
+                xs = archive.sbx_xs(select_n, chunk_size, bounds.lb, bounds.ub, rg, dis_c, dis_m)
             else:
-                x1 = archive.random_xs(select_n, chunk_size, rg)
-                x2 = archive.random_xs(select_n, chunk_size, rg)
-                xs = iso_dd_(x1, x2, bounds.lb, bounds.ub, rg, iso_sigma, line_sigma)    
+                xs = archive.iso_dd_xs(select_n, chunk_size, bounds.lb, bounds.ub, rg, 
+                                       iso_sigma, line_sigma)    
             yds = [fitness(x) for x in xs]
-            descs = np.array([yd[1] for yd in yds])
-            niches = archive.index_of_niches(descs)
-            for i in range(len(yds)):
-                archive.set(niches[i], yds[i], xs[i]) 
+            ys = np.fromiter((yd[0] for yd in yds), dtype=float)
+            archive.update(xs, ys, np.array([yd[1] for yd in yds]))
             archive.argsort()   
             select_n = archive.get_occupied()            
     
@@ -301,20 +303,13 @@ def optimize_cma_(archive, fitness, bounds, rg, cma_params):
 def update_archive(archive: Archive, xs: np.ndarray, 
                    fitness: Callable[[ArrayLike], Tuple[float, np.ndarray]]):
     # evaluate population, update archive and determine ranking
-    popsize = len(xs) 
     yds = [fitness(x) for x in xs]
     descs = np.array([yd[1] for yd in yds])
-    niches = archive.index_of_niches(descs)
     # real values
     ys = np.fromiter((yd[0] for yd in yds), dtype=float)
-    oldys = np.fromiter((archive.get_y(niches[i]) for i in range(popsize)), dtype=float)
-    improvement = ys - oldys
-    neg = np.argwhere(improvement < 0)
-    if len(neg) > 0:
-        neg = neg.reshape((len(neg)))
-        # update archive for all real improvements
-        for i in neg:
-            archive.set(niches[i], yds[i], xs[i])
+    # update archive for all real improvements
+    _, improvement = archive.update(xs, ys, descs)
+    if (improvement < 0).any():
         # prioritize empty niches
         empty = (improvement == -np.inf) # these need to be sorted according to fitness
         occupied = np.logical_not(empty)
@@ -357,6 +352,8 @@ class Archive(object):
         self.counts = mp.RawArray(ct.c_long, self.capacity) # count
         self.occupied = mp.RawValue(ct.c_long, 0)
         self.stats = mp.RawArray(ct.c_double, self.capacity * self.dim * 4 if self.use_stats else 0)
+        self.locks = mp.RawArray(ct.c_int, self.capacity) # niche locks of the native archive
+        self.release_native()
         for i in range(self.capacity):
             self.counts[i] = 0
             self.set_y(i, np.inf)  
@@ -380,11 +377,8 @@ class Archive(object):
    
     def join(self, archive: Archive):    
         ys, ds, xs = archive.get_occupied_data()
-        niches = archive.index_of_niches(ds)
-        yds = np.array([(y, d) for y, d in zip(ys, ds)])
-        for i in range(len(ys)):
-            archive.set(niches[i], yds[i], xs[i]) 
-        archive.argsort()   
+        self.update(xs, ys, ds)
+        self.argsort()   
 
     def fname(self, name): 
         """Archive file name."""
@@ -421,8 +415,65 @@ class Archive(object):
         self.capacity = xs.shape[0]
         set_KDTree(self, self.get_cs(), None, None, None)
     
+    def __del__(self):
+        self.release_native()
+
+    def release_native(self):
+        """Deletes the native archive of this process, it is recreated on demand."""
+        if getattr(self, 'native_pid', None) == os.getpid():
+            destroyArchive_C(self.native)
+        self.native_pid = None
+
+    def _native(self) -> int:
+        """Native archive of this process, created on first use. Bound to the
+        shared memory arrays as mapped in this process."""
+        if self.native_pid != os.getpid():
+            cs = np.ascontiguousarray(self.get_cs(), dtype=np.float64)
+            self.native = initArchive_C(self.dim, self.qd_dim, self.capacity, 
+                        cs.ctypes.data_as(ct.POINTER(ct.c_double)),
+                        _as_ptr(self.desc_lb), _as_ptr(self.desc_scale))
+            bindArchive_C(self.native, self.xs, self.ds, self.ys, self.counts, 
+                          ct.byref(self.occupied), self.stats if self.use_stats else None, 
+                          self.locks)
+            self.native_pid = os.getpid()
+        return self.native
+    
     def index_of_niches(self, ds):
-        return self.kdt.query(self.encode_d(ds), k=1, sort_results=False)[1].T[0] 
+        if not native_archive:
+            return self.kdt.query(self.encode_d(ds), k=1, sort_results=False)[1].T[0]
+        ds = np.ascontiguousarray(ds, dtype=np.float64)
+        niches = np.empty(len(ds), dtype=np.int32)
+        nichesArchive_C(self._native(), len(ds), self.qd_dim, 
+                        ds.ctypes.data_as(ct.POINTER(ct.c_double)),
+                        niches.ctypes.data_as(ct.POINTER(ct.c_int)))
+        return niches
+    
+    def update(self, 
+               xs: ArrayLike, 
+               ys: ArrayLike, 
+               ds: ArrayLike) -> Tuple[np.ndarray, np.ndarray]:
+        """Adds a batch of solutions, each replaces the elite of its niche if it is better.
+        Returns the niche of each solution and its value minus the previous niche value."""
+        n = len(ys)
+        if not native_archive:
+            niches = self.index_of_niches(ds)
+            improvement = np.empty(n)
+            for i in range(n):
+                improvement[i] = ys[i] - self.get_y(niches[i])
+                self.set(niches[i], (ys[i], ds[i]), xs[i])
+            return niches, improvement
+        xs = np.ascontiguousarray(xs, dtype=np.float64)
+        ys = np.ascontiguousarray(ys, dtype=np.float64)
+        ds = np.ascontiguousarray(ds, dtype=np.float64)
+        niches = np.empty(n, dtype=np.int32)
+        improvement = np.empty(n)
+        updateArchive_C(self._native(), n, self.dim, self.qd_dim, 
+                        xs.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                        ys.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                        ds.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                        niches.ctypes.data_as(ct.POINTER(ct.c_int)),
+                        improvement.ctypes.data_as(ct.POINTER(ct.c_double)))
+        return niches, improvement
         
     def in_niche_filter(self, 
                         fit: Callable[[ArrayLike], float], 
@@ -436,8 +487,11 @@ class Archive(object):
             x: np.ndarray):
         """Adds a solution to the archive if it improves the corresponding niche.
         Updates solution.""" 
-        self.update_stats(i, x)
         y, d = yd
+        if native_archive:
+            setArchive_C(self._native(), i, _as_ptr(x), y, _as_ptr(d))
+            return
+        self.update_stats(i, x)
         # register improvement
         yold = self.get_y(i)
         if y < yold:
@@ -583,13 +637,57 @@ class Archive(object):
             selection = np.fromiter((self.si[i] for i in selection), dtype=int)
         return self.get_xs()[selection]
     
+    def sbx_xs(self, best_n: int, n: int, lower: ArrayLike, upper: ArrayLike, 
+               rg: Generator, dis_c: Optional[float] = 20, dis_m: Optional[float] = 20, 
+               out: Optional[np.ndarray] = None) -> np.ndarray:
+        """Generates n offspring of random parents from the best_n niches using 
+        SBX (Simulated Binary Crossover) and mutation. Natively parent selection,
+        variation and clipping are performed in one pass writing to out."""
+        if not native_sbx:
+            return variation_(self.random_xs(best_n, n, rg), lower, upper, rg, dis_c, dis_m)
+        out = self._offspring(n, out)
+        sbxArchive_C(self._native(), n, best_n, self._selection(best_n), 
+                     _as_ptr(lower), _as_ptr(upper), dis_c, dis_m, 
+                     int(rg.integers(0, 2**62)), out.ctypes.data_as(ct.POINTER(ct.c_double)))
+        return out
+
+    def iso_dd_xs(self, best_n: int, n: int, lower: ArrayLike, upper: ArrayLike, 
+                  rg: Generator, iso_sigma: Optional[float] = 0.01, 
+                  line_sigma: Optional[float] = 0.2, 
+                  out: Optional[np.ndarray] = None) -> np.ndarray:
+        """Generates n offspring of random parents from the best_n niches using Iso+LineDD.
+        Natively parent selection, variation and clipping are performed in one pass 
+        writing to out."""
+        if not native_iso_dd:
+            x1 = self.random_xs(best_n, n, rg)
+            x2 = self.random_xs(best_n, n, rg)
+            return iso_dd_(x1, x2, lower, upper, rg, iso_sigma, line_sigma)
+        out = self._offspring(n, out)
+        isoDDArchive_C(self._native(), n, best_n, self._selection(best_n), 
+                       _as_ptr(lower), _as_ptr(upper), iso_sigma, line_sigma, 
+                       int(rg.integers(0, 2**62)), out.ctypes.data_as(ct.POINTER(ct.c_double)))
+        return out
+    
+    def _offspring(self, n, out):
+        if out is None:
+            return np.empty((n, self.dim))
+        if out.shape != (n, self.dim) or out.dtype != np.float64 or not out.flags.c_contiguous:
+            raise ValueError('out needs to be a C contiguous float64 array of shape (n, dim)')
+        return out
+        
+    def _selection(self, best_n):
+        """niches sorted by value if only the best_n should be selected."""
+        if best_n < self.capacity:
+            return self.si.ctypes.data_as(ct.POINTER(ct.c_int))
+        return None
+            
     def random_xs_one(self, best_n: int, rg: Generator) -> Tuple[np.ndarray, float, int]:
         i = int(rg.random()*best_n)
         return self.get_x(i), self.get_y(i),  i
         
     def argsort(self) -> np.ndarray:
         """Sorts the archive according to its niche values.""" 
-        self.si = np.argsort(self.get_ys())
+        self.si = np.argsort(self.get_ys()).astype(np.int32)
         return self.si
             
     def dump(self, n: Optional[int] = None):
@@ -672,6 +770,10 @@ class in_niche_filter(object):
         else:
             return np.inf
 
+def _as_ptr(a):
+    a = np.ascontiguousarray(a, dtype=np.float64)
+    return a.ctypes.data_as(ct.POINTER(ct.c_double))
+
 def variation_(pop, lower, upper, rg, dis_c = 20, dis_m = 20):
     """Generate offspring individuals using SBX (Simulated Binary Crossover) and mutation."""
     dis_c *= 0.5 + 0.5*rg.random() # vary spread factors randomly 
@@ -715,16 +817,91 @@ def iso_dd_(x1, x2, lower, upper, rg, iso_sigma = 0.01, line_sigma = 0.2):
 def get_centers_(niche_num, dim, samples_per_niche):
         p = Path('voronoi_cache')
         p.mkdir(exist_ok=True)
-        fname = f'centers_{niche_num}_{dim}_{samples_per_niche}.npz'
-        files = p.glob(fname)
-        for file in files: # if cached just load
-            with np.load(file) as data:
-                return data['cs']
+        name = f'centers_{niche_num}_{dim}_{samples_per_niche}'
+        fname = p / (name + '.raw') 
+        if fname.exists() and fname.stat().st_size == niche_num * dim * 8: # if cached just map
+            return np.memmap(fname, dtype=np.float64, mode='r', shape=(niche_num, dim))
+        npz = p / (name + '.npz')
+        if npz.exists(): # old cache format
+            with np.load(npz) as data:
+                centers = data['cs']
         else:
             descs = rng.uniform(0, 1, (niche_num*samples_per_niche, dim))
             # Applies KMeans to the random samples determine the centers of each niche."""
-            k_means = KMeans(init='k-means++', n_clusters=niche_num, n_init=1, verbose=1)
-            k_means.fit(descs)
-            centers = k_means.cluster_centers_
-            np.savez_compressed(f'voronoi_cache/centers_{niche_num}_{dim}_{samples_per_niche}', cs=centers)
-            return centers
+            centers = kmeans(descs, niche_num)
+        # concurrent processes may compute the same centers, never map a partial file
+        tmp = p / f'{name}.{os.getpid()}.tmp'
+        np.ascontiguousarray(centers, dtype=np.float64).tofile(tmp)
+        os.replace(tmp, fname)
+        return centers
+
+def kmeans(xs: ArrayLike, 
+           k: int, 
+           iterations: Optional[int] = 20, 
+           batch: Optional[int] = None, 
+           workers: Optional[int] = None) -> np.ndarray:
+    """Computes k cluster centers of the points xs. 
+    Natively k-means++ seeding followed by mini-batch Lloyd iterations.
+     
+    Parameters
+    ----------
+    xs : ndarray, shape (n,m)
+        Points to cluster.
+    k : int
+        Number of centers.
+    iterations : int, optional
+        Number of mini-batch Lloyd iterations.
+    batch : int, optional
+        Number of random points per iteration, default 2*k. 
+        batch >= n means standard Lloyd iterations.
+    workers : int, optional
+        Number of threads, default all cores.
+         
+    Returns
+    -------
+    centers : ndarray, shape (k,m)"""
+    
+    if not native_kmeans:
+        k_means = KMeans(init='k-means++', n_clusters=k, n_init=1, verbose=1)
+        k_means.fit(xs)
+        return k_means.cluster_centers_
+    xs = np.ascontiguousarray(xs, dtype=np.float64)
+    n, dim = xs.shape
+    if batch is None:
+        batch = 2*k
+    centers = np.empty((min(k, n), dim))
+    kmeans_C(n, dim, xs.ctypes.data_as(ct.POINTER(ct.c_double)), k, iterations, 
+             batch, int(rng.integers(0, 2**62)), 0 if workers is None else workers, 
+             centers.ctypes.data_as(ct.POINTER(ct.c_double)))
+    return centers
+
+# older native libraries lack the archive functions, then the KDTree, sklearn KMeans
+# and the Python variation operators are used
+native_archive = not libcmalib is None and hasattr(libcmalib, "initArchive_C")
+native_kmeans = not libcmalib is None and hasattr(libcmalib, "kmeans_C")
+native_sbx = native_archive and hasattr(libcmalib, "sbxArchive_C")
+native_iso_dd = native_archive and hasattr(libcmalib, "isoDDArchive_C")
+
+if not libcmalib is None: 
+    
+    initArchive_C = _bind("initArchive_C", [ct.c_int, ct.c_int, ct.c_int, ct.POINTER(ct.c_double),
+                                           ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)], ct.c_void_p)
+    destroyArchive_C = _bind("destroyArchive_C", [ct.c_void_p])
+    bindArchive_C = _bind("bindArchive_C", [ct.c_void_p, ct.POINTER(ct.c_double), ct.POINTER(ct.c_double),
+                                           ct.POINTER(ct.c_double), ct.POINTER(ct.c_long), ct.POINTER(ct.c_long),
+                                           ct.POINTER(ct.c_double), ct.POINTER(ct.c_int)])
+    nichesArchive_C = _bind("nichesArchive_C", [ct.c_void_p, ct.c_int, ct.c_int, ct.POINTER(ct.c_double),
+                                               ct.POINTER(ct.c_int)])
+    setArchive_C = _bind("setArchive_C", [ct.c_void_p, ct.c_int, ct.POINTER(ct.c_double), ct.c_double,
+                                         ct.POINTER(ct.c_double)])
+    updateArchive_C = _bind("updateArchive_C", [ct.c_void_p, ct.c_int, ct.c_int, ct.c_int, ct.POINTER(ct.c_double),
+                                               ct.POINTER(ct.c_double), ct.POINTER(ct.c_double),
+                                               ct.POINTER(ct.c_int), ct.POINTER(ct.c_double)], ct.c_int)
+    sbxArchive_C = _bind("sbxArchive_C", [ct.c_void_p, ct.c_int, ct.c_int, ct.POINTER(ct.c_int),
+                                         ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), ct.c_double,
+                                         ct.c_double, ct.c_long, ct.POINTER(ct.c_double)])
+    isoDDArchive_C = _bind("isoDDArchive_C", [ct.c_void_p, ct.c_int, ct.c_int, ct.POINTER(ct.c_int),
+                                             ct.POINTER(ct.c_double), ct.POINTER(ct.c_double), ct.c_double,
+                                             ct.c_double, ct.c_long, ct.POINTER(ct.c_double)])
+    kmeans_C = _bind("kmeans_C", [ct.c_int, ct.c_int, ct.POINTER(ct.c_double), ct.c_int, ct.c_int,
+                                 ct.c_int, ct.c_long, ct.c_int, ct.POINTER(ct.c_double)])
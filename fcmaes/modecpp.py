@@ -54,7 +54,7 @@ from fcmaes import mode, moretry
 from fcmaes.mode import _filter, store
 from numpy.random import Generator, MT19937, SeedSequence
 from fcmaes.optimizer import dtime
-from fcmaes.evaluator import mo_call_back_type, callback_mo, parallel_mo, libcmalib
+from fcmaes.evaluator import mo_call_back_type, callback_mo, parallel_mo, libcmalib, _map_buffer, _bind
 from fcmaes.de import _check_bounds
 
 import logging
@@ -449,6 +449,39 @@ class MODE_C:
             print (ex)
             return -1        
  
+    def buffer(self) -> Tuple[np.ndarray, np.ndarray]:
+        """Maps the population buffer owned by the optimizer as numpy arrays 
+        xs, shape (popsize, dim) and ys, shape (popsize, nobj + ncon). Map it 
+        once, then ask_buffer writes the next population into xs and tell_buffer
+        reads the function values from ys, no data is copied or converted."""
+        return _map_buffer(bufferMODE_C, self, self.popsize, self.dim, self.nobj + self.ncon)
+
+    def ask_buffer(self):
+        """Writes the next population into the xs array of buffer()."""
+        askBufferMODE_C(self.ptr)
+
+    def tell_buffer(self) -> int:
+        """Tells the function values stored in the ys array of buffer()."""
+        return tellBufferMODE_C(self.ptr)
+
+    def screening(self, factor: Optional[int] = 4, forgetting: Optional[float] = 0.9):
+        """For expensive objectives, DE population update only: each trial vector
+        returned by ask is the least dominated of factor trials predicted by a 
+        quadratic surrogate model of the told objective and constraint values.
+        forgetting in (0, 1] down weights older evaluations. factor <= 1 disables 
+        screening."""
+        enableScreeningMODE_C(self.ptr, factor, forgetting)
+
+    def init_population(self, xs: ArrayLike, ys: ArrayLike):
+        """Replaces the initial population by already evaluated solutions, 
+        ys contains objectives and constraints, shape (n, nobj + ncon). 
+        See fcmaes.evallog. Call it before the first ask."""
+        xs = np.ascontiguousarray(xs, dtype=np.float64)
+        ys = np.ascontiguousarray(ys, dtype=np.float64)
+        initPopulationMODE_C(self.ptr, len(ys), 
+                             xs.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                             ys.ctypes.data_as(ct.POINTER(ct.c_double)))
+
     def population(self) -> np.ndarray:
         try:
             lamb = self.popsize
@@ -512,7 +545,14 @@ if not libcmalib is None:
     tellMODE_switchC.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double), ct.c_bool, ct.c_double]
     tellMODE_switchC.restype = ct.c_int
     
+    enableScreeningMODE_C = _bind("enableScreeningMODE_C", [ct.c_void_p, ct.c_int, ct.c_double])
+    
     populationMODE_C = libcmalib.populationMODE_C
     populationMODE_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
-
-
+    
+    bufferMODE_C = _bind("bufferMODE_C", [ct.c_void_p, ct.POINTER(ct.POINTER(ct.c_double)),
+                                         ct.POINTER(ct.POINTER(ct.c_double))])
+    askBufferMODE_C = _bind("askBufferMODE_C", [ct.c_void_p])
+    tellBufferMODE_C = _bind("tellBufferMODE_C", [ct.c_void_p], ct.c_int)
+    initPopulationMODE_C = _bind("initPopulationMODE_C", [ct.c_void_p, ct.c_int, ct.POINTER(ct.c_double),
+                                                         ct.POINTER(ct.c_double)])
@@ -15,10 +15,10 @@ import ctypes as ct
 import numpy as np
 from numpy.random import MT19937, Generator
 from scipy.optimize import OptimizeResult, Bounds
-from fcmaes.evaluator import _check_bounds, _get_bounds, callback_par, parallel, call_back_par, libcmalib
+from fcmaes.evaluator import _check_bounds, _get_bounds, callback_par, parallel, call_back_par, libcmalib, _map_buffer, _bind
 
 import logging
-from typing import Optional, Callable, Union
+from typing import Optional, Callable, Union, Tuple
 from numpy.typing import ArrayLike
 
 os.environ['MKL_DEBUG_CPU_TYPE'] = '5'
@@ -273,6 +273,21 @@ class PGPE_C:
             print (ex)
             return -1        
 
+    def buffer(self) -> Tuple[np.ndarray, np.ndarray]:
+        """Maps the population buffer owned by the optimizer as numpy arrays 
+        xs, shape (popsize, dim) and ys, shape (popsize,). Map it once, then
+        ask_buffer writes the next population into xs and tell_buffer reads the 
+        function values from ys, no data is copied or converted."""
+        return _map_buffer(bufferPGPE_C, self, self.popsize, self.dim, 1)
+
+    def ask_buffer(self):
+        """Writes the next population into the xs array of buffer()."""
+        askBufferPGPE_C(self.ptr)
+
+    def tell_buffer(self) -> int:
+        """Tells the function values stored in the ys array of buffer()."""
+        return tellBufferPGPE_C(self.ptr)
+
     def population(self) -> np.array:
         try:
             lamb = self.popsize
@@ -339,3 +354,8 @@ if not libcmalib is None:
     
     resultPGPE_C = libcmalib.resultPGPE_C
     resultPGPE_C.argtypes = [ct.c_void_p, ct.POINTER(ct.c_double)]
+    
+    bufferPGPE_C = _bind("bufferPGPE_C", [ct.c_void_p, ct.POINTER(ct.POINTER(ct.c_double)),
+                                         ct.POINTER(ct.POINTER(ct.c_double))])
+    askBufferPGPE_C = _bind("askBufferPGPE_C", [ct.c_void_p])
+    tellBufferPGPE_C = _bind("tellBufferPGPE_C", [ct.c_void_p], ct.c_int)
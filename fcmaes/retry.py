@@ -18,6 +18,7 @@ from scipy.optimize import OptimizeResult, Bounds
 import multiprocessing as mp
 from multiprocessing import Process
 from fcmaes.optimizer import de_cma, dtime, logger
+from fcmaes.evaluator import mo_call_back_type, callback_so, libcmalib, _bind
 
 import logging
 from typing import Optional, Callable, List
@@ -118,6 +119,64 @@ def retry(store: Store,
     return OptimizeResult(x=store.get_x_best(), fun=store.get_y_best(), 
                           nfev=store.get_count_evals(), success=True)
 
+# optimizers supported by minimize_native, see retry.h
+NATIVE_OPTIMIZERS = {'de': 0, 'cma': 1, 'de_cma': 2, 'bite': 3}
+
+class RetryConfig(ct.Structure):
+    """Mirrors retry_config of retry.h."""
+    _fields_ = [('optimizer', ct.c_int),
+                ('num_retries', ct.c_int),
+                ('max_evaluations', ct.c_int),
+                ('popsize', ct.c_int),
+                ('stop_fitness', ct.c_double),
+                ('value_limit', ct.c_double),
+                ('capacity', ct.c_int),
+                ('workers', ct.c_int),
+                ('seed', ct.c_long)]
+
+def minimize_native(fun: Callable[[ArrayLike], float], 
+                    bounds: Bounds, 
+                    optimizer: Optional[str] = 'de_cma',
+                    value_limit: Optional[float] = np.inf,
+                    num_retries: Optional[int] = 1024,
+                    workers: Optional[int] = mp.cpu_count(),
+                    popsize: Optional[int] = 31, 
+                    max_evaluations: Optional[int] = 50000, 
+                    capacity: Optional[int] = 500,
+                    stop_fitness: Optional[float] = -np.inf,
+                    rg: Optional[Generator] = Generator(MT19937()),
+                    runid: Optional[int] = 0) -> OptimizeResult:   
+    """Parallel optimization retry like minimize, but the retry loop, the 
+    optimizers and the result store are executed natively on a thread pool. 
+    Much less overhead for many short runs. optimizer is one of 'de', 'cma', 
+    'de_cma' or 'bite'. fun is called concurrently from several threads, a 
+    Python fun is serialized by the GIL. So use it for objectives releasing 
+    the GIL, for instance a numba cfunc or a function calling native code. 
+    Returns additionally the stored solutions sorted by value, attributes xs 
+    and ys, and the mean and standard deviation of the results below 
+    value_limit, attributes mean and sdev."""
+    
+    lower, upper = _convertBounds(bounds)
+    dim = len(lower)
+    capacity = max(2, capacity)
+    cfg = RetryConfig(NATIVE_OPTIMIZERS[optimizer], num_retries, max_evaluations, 
+                      popsize, stop_fitness, value_limit, capacity, 
+                      0 if workers is None else workers, 
+                      int(rg.uniform(0, 2**32 - 1)))
+    array_type = ct.c_double * dim 
+    c_callback = mo_call_back_type(callback_so(fun, dim))
+    xs = np.empty((capacity, dim))
+    ys = np.empty(capacity)
+    res = np.empty(dim+5)
+    n = retryMinimize_C(runid, c_callback, dim, array_type(*lower), array_type(*upper), 
+                        ct.byref(cfg), 
+                        xs.ctypes.data_as(ct.POINTER(ct.c_double)),
+                        ys.ctypes.data_as(ct.POINTER(ct.c_double)),
+                        res.ctypes.data_as(ct.POINTER(ct.c_double)))
+    return OptimizeResult(x=res[:dim], fun=res[dim], nfev=int(res[dim+1]), 
+                          nit=int(res[dim+2]), mean=res[dim+3], sdev=res[dim+4],
+                          xs=xs[:n], ys=ys[:n], success=True)
+
 def minimize_plot(name: str, 
                   optimizer: Optimizer, 
                   fun: Callable[[ArrayLike], float], 
@@ -442,3 +501,10 @@ def _convertBounds(bounds):
                          'real valued (min, max) pairs for each value'
                          ' in x')
     return limits[0], limits[1]
+
+if not libcmalib is None: 
+    
+    retryMinimize_C = _bind("retryMinimize_C", [ct.c_long, mo_call_back_type, ct.c_int,
+                                               ct.POINTER(ct.c_double), ct.POINTER(ct.c_double),
+                                               ct.POINTER(RetryConfig), ct.POINTER(ct.c_double),
+                                               ct.POINTER(ct.c_double), ct.POINTER(ct.c_double)], ct.c_int)
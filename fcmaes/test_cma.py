@@ -3,11 +3,17 @@
 # This source code is licensed under the MIT license found in the
 # LICENSE file in the root directory.
 
+import os
+import tempfile
+import gc
+import weakref
 import multiprocessing as mp
 import numpy as np
+from numpy.random import Generator, MT19937
 from scipy.optimize import OptimizeResult
+from sklearn.cluster import KMeans
 from fcmaes.testfun import Wrapper, Rosen, Rastrigin, Eggholder
-from fcmaes import cmaes, de, decpp, cmaescpp, gcldecpp, retry, advretry
+from fcmaes import cmaes, de, decpp, cmaescpp, gcldecpp, retry, advretry, evallog, astro, mapelites
 from fcmaes.optimizer import de_cma_py
 
 def almost_equal(X1, X2, eps = 1E-5):
@@ -392,4 +398,215 @@ def test_eggholder_advanced_retry_python():
     assert(ret.nfev == wrapper.get_count()) # wrong number of function calls returned
     assert(almost_equal(ret.x, wrapper.get_best_x())) # wrong best X returned
     assert(almost_equal(ret.fun, wrapper.get_best_y())) # wrong best y returned
- 
\ No newline at end of file
+ 
+def _evallog_run(runid, max_eval):
+    testfun = Rosen(2)
+    # odd runs are terminated by the callback, later evaluations must not be logged
+    is_terminate = (lambda x, y: y < 1.0) if runid % 2 == 1 else None
+    decpp.minimize(testfun.fun, 2, testfun.bounds, max_evaluations = max_eval, 
+                   popsize = 8, runid = runid, is_terminate = is_terminate)
+    
+def test_evallog_processes():
+    if not hasattr(os, 'fork'):
+        return # the evaluation log requires a POSIX platform
+    testfun = Rosen(2)
+    max_eval = 2000
+    runs = 4
+    path = os.path.join(tempfile.mkdtemp(), 'eval.log')
+    # processes forked while the log is active append to the same log
+    with evallog.EvalLog(path, 2) as log:
+        ctx = mp.get_context('fork')
+        procs = [ctx.Process(target=_evallog_run, args=(runid, max_eval)) 
+                 for runid in range(1, runs + 1)]
+        for p in procs:
+            p.start()
+        _evallog_run(0, max_eval)
+        for p in procs:
+            p.join()
+    runids, evals, xs, ys, _ = evallog.load(path)
+    os.remove(path)
+    assert(set(runids) == set(range(runs + 1))) # records of a process are missing
+    for runid in range(runs + 1):
+        run_evals = np.sort(evals[runids == runid])
+        # records overwritten by another process
+        assert(np.array_equal(run_evals, np.arange(1, len(run_evals) + 1)))
+        assert(max_eval + 16 >= len(run_evals)) # too much records
+    # records mixed up by concurrent writes
+    assert(np.allclose(ys[:,0], [testfun.fun(x) for x in xs]))
+
+def test_buffer_owner():
+    dim = 5
+    testfun = Rosen(dim)
+    es = cmaescpp.ACMA_C(dim, testfun.bounds, popsize = 16)
+    xs, ys = es.buffer()
+    owner = weakref.ref(es)
+    del es
+    gc.collect()
+    # the mapped arrays keep the native optimizer alive
+    assert(not owner() is None) 
+    es = owner()
+    for _ in range(10):
+        es.ask_buffer()
+        ys[:] = [testfun.fun(x) for x in xs]
+        es.tell_buffer()
+    del es, xs, ys
+    gc.collect()
+    assert(owner() is None) # optimizer leaked
+
+def _store_run(store, seed, num):
+    rg = np.random.default_rng(seed)
+    for i in range(num):
+        x = rg.uniform(store.lower, store.upper)
+        store.add_result(np.sum(x**2), x, 10)
+        if i % 7 == 0: # compaction concurrent to adding
+            store.sort()
+        i1, i2 = store.crossover()
+        assert(i1 < 0 or 0 <= i1 < i2 < store.capacity) # invalid crossover pair
+        y0, _, lower, upper, _ = store.limits()
+        if np.isfinite(y0):
+            assert(np.all(store.lower <= lower) and np.all(lower <= upper) 
+                   and np.all(upper <= store.upper)) # invalid crossover limits
+
+def test_native_store_processes():
+    if not advretry.native_store:
+        return # the native store requires a POSIX platform and a native library exporting it
+    dim = 3
+    bounds = Rosen(dim).bounds
+    workers = 4
+    num = 500
+    ctx = mp.get_context('fork')
+    # a crashed owner leaves its shared memory segment behind
+    crashed = ctx.Process(target=lambda: (advretry.Store(None, bounds), os._exit(0)))
+    crashed.start()
+    crashed.join()
+    def leaked():
+        shm = '/dev/shm'
+        return [n for n in (os.listdir(shm) if os.path.isdir(shm) else []) 
+                if n.startswith('fcmaes_adv_' + str(crashed.pid) + '_')]
+    if os.path.isdir('/dev/shm'):
+        assert(len(leaked()) > 0)
+    store = advretry.Store(None, bounds, capacity = 50)
+    assert(isinstance(store, advretry.NativeStore))
+    assert(len(leaked()) == 0) # stale segment not removed
+    procs = [ctx.Process(target=_store_run, args=(store, seed, num)) 
+             for seed in range(1, workers + 1)]
+    for p in procs:
+        p.start()
+    _store_run(store, 0, num)
+    for p in procs:
+        p.join()
+        assert(p.exitcode == 0) # failed assertion in a worker 
+    store.sort()
+    xs, ys = store.get_xs(), store.get_ys()
+    assert(store.get_count_evals() == 10 * num * (workers + 1)) # lost evaluations
+    assert(0 < len(ys) <= store.capacity)
+    assert(np.all(np.diff(ys) >= 0)) # entries not sorted
+    assert(np.allclose(ys, np.sum(xs**2, axis=1))) # entries mixed up by concurrent writes
+    # best of all added results
+    best = min(np.sum(np.random.default_rng(seed).uniform(
+        store.lower, store.upper, (num, dim))**2, axis=1).min() 
+        for seed in range(workers + 1))
+    assert(almost_equal(store.get_y_best(), best)) 
+    assert(almost_equal(ys[0], best)) 
+    assert(almost_equal(np.sum(store.get_x_best()**2), best)) 
+
+def test_tell_many_sizes():
+    dim = 5
+    optimizers = [cmaescpp.ACMA_C(dim, Rosen(dim).bounds, popsize = 8) for _ in range(3)]
+    for ys in [np.zeros((2, 8)), [np.zeros(8), np.zeros(8), np.zeros(7)]]:
+        try:
+            cmaescpp.tell_many(optimizers, ys)
+            assert(False) # wrong number of values not detected
+        except ValueError:
+            pass
+
+def _kepler_tof(r1, v1, r2, mu, revs):
+    """time of flight from r1 to r2 after revs full revolutions on the ellipse 
+    through r1 with velocity v1."""
+    a = 1 / (2 / np.linalg.norm(r1) - v1 @ v1 / mu)
+    h = np.cross(r1, v1)
+    e = np.cross(v1, h) / mu - r1 / np.linalg.norm(r1)
+    ecc = np.linalg.norm(e)
+    def mean_anomaly(r):
+        nu = np.arctan2(h @ np.cross(e, r) / np.linalg.norm(h), e @ r)
+        E = 2 * np.arctan(np.sqrt((1 - ecc) / (1 + ecc)) * np.tan(nu / 2))
+        return E - ecc * np.sin(E)
+    dm = (mean_anomaly(r2) - mean_anomaly(r1)) % (2 * np.pi)
+    return (dm + 2 * np.pi * revs) * np.sqrt(a**3 / mu)
+
+def test_lambert():
+    if not hasattr(astro.libcmalib, 'lambertBatch_C'):
+        return # the native library lacks the Lambert solver
+    # circular orbit mu = 1, r = 1: the angle is the time of flight
+    th = 1.0
+    r1 = np.array([[1, 0, 0]] * 2, dtype=float)
+    r2 = np.array([[np.cos(th), np.sin(th), 0]] * 2)
+    v1, v2 = astro.lambert_batch(r1, r2, [th, th + 2*np.pi], 1, [0, -1])
+    assert(np.allclose(v1, [0, 1, 0])) 
+    assert(np.allclose(v2, [-np.sin(th), np.cos(th), 0])) 
+    # single revolution and both branches of the one revolution solutions,
+    # the minimal time of flight of one revolution is 10.088
+    r1 = np.array([[1, 0, 0]] * 5, dtype=float)
+    r2 = np.array([[0, 1.5, 0]] * 5)
+    tof = np.array([2, 12, 12, 9, 9])
+    revs = np.array([0, 1, -1, 1, -1])
+    v1, v2 = astro.lambert_batch(r1, r2, tof, 1, revs)
+    for i in range(3):
+        assert(almost_equal(_kepler_tof(r1[i], v1[i], r2[i], 1, abs(revs[i])), tof[i])) 
+        assert(np.allclose(np.cross(r1[i], v1[i]), np.cross(r2[i], v2[i]))) # angular momentum
+        assert(almost_equal(v1[i] @ v1[i] / 2 - 1, v2[i] @ v2[i] / 2 - 1 / 1.5)) # energy
+    assert(not np.allclose(v1[1], v1[2])) # branches not distinguished 
+    assert(np.all(np.isnan(v1[3:])) and np.all(np.isnan(v2[3:]))) # no solution 
+
+def test_retry_native_workers():
+    if not hasattr(retry.libcmalib, 'retryMinimize_C'):
+        return # the native library lacks the native retry
+    dim = 3
+    testfun = Rosen(dim)
+    limit = 1E-2
+    rets = []
+    for workers in [1, 4]:
+        wrapper = Wrapper(testfun.fun, dim)
+        ret = retry.minimize_native(wrapper.eval, testfun.bounds, num_retries = 32, 
+                                    workers = workers, popsize = 16, max_evaluations = 800,
+                                    value_limit = limit, capacity = 64, 
+                                    rg = Generator(MT19937(42)))
+        assert(ret.nfev == wrapper.get_count()) # wrong number of function calls returned
+        assert(ret.nit == 32) # wrong number of runs
+        assert(len(ret.ys) > 0 and np.all(ret.ys < limit)) # value limit ignored
+        assert(np.all(np.diff(ret.ys) >= 0)) # results not sorted
+        assert(ret.fun == ret.ys[0] and np.array_equal(ret.x, ret.xs[0])) # wrong best result
+        assert(np.allclose(ret.ys, [testfun.fun(x) for x in ret.xs])) # results mixed up
+        # the store keeps all results below the limit, their statistics 
+        assert(almost_equal(ret.mean, np.mean(ret.ys))) 
+        assert(almost_equal(ret.sdev, np.std(ret.ys))) 
+        rets.append(ret)
+    # each run is seeded by its index, the results don't depend on the workers
+    assert(rets[0].nfev == rets[1].nfev)
+    assert(np.array_equal(rets[0].ys, rets[1].ys))
+    assert(np.array_equal(rets[0].xs, rets[1].xs))
+
+def _quantization_error(xs, centers):
+    d2 = ((xs[:, None, :] - centers[None, :, :])**2).sum(axis=2)
+    return np.mean(d2.min(axis=1))
+
+def test_kmeans():
+    if not mapelites.native_kmeans:
+        return # the native library lacks kmeans, sklearn is used 
+    rg = np.random.default_rng(0)
+    xs = rg.uniform(size=(2000, 3))
+    k = 32
+    ref = _quantization_error(xs, KMeans(n_clusters=k, n_init=1, 
+                                         random_state=0).fit(xs).cluster_centers_)
+    centers = mapelites.kmeans(xs, k)
+    assert(centers.shape == (k, 3) and np.all(np.isfinite(centers)))
+    # mini-batch iterations are close to the full Lloyd iterations of sklearn
+    assert(_quantization_error(xs, centers) < 1.3 * ref) 
+    centers = mapelites.kmeans(xs, k, batch = len(xs))
+    assert(_quantization_error(xs, centers) < 1.1 * ref) 
+    # at most n centers
+    centers = mapelites.kmeans(xs[:10], 20)
+    assert(centers.shape == (10, 3) and np.all(np.isfinite(centers)))
+    # duplicate points leave clusters empty 
+    centers = mapelites.kmeans(np.repeat(xs[:5], 20, axis=0), 10)
+    assert(len(centers) <= 10 and np.all(np.isfinite(centers)))
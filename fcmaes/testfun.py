@@ -9,6 +9,7 @@ import numpy as np
 import ctypes as ct
 import multiprocessing as mp
 from scipy.optimize import Bounds
+from fcmaes.evaluator import libcmalib, mo_call_back_type, call_back_par
 
 class Wrapper(object):
     """thread safe wrapper for objective function monitoring evaluation count and optimization result."""
@@ -75,6 +76,51 @@ class RastriginMean(object):
         fun = lambda x: _rastrigin_mean(x, n)
         _testfun.__init__(self, 'rastrigin_mean', fun, [-5.12]*dim, [5.12]*dim)
 
+class NativeFun(object):
+    """Test function implemented natively, see _fcmaescpp/include/testfun.h.
+    name: sphere, elli, rosen, rastrigin, ackley (1 objective), 
+    zdt1 - zdt6 (2 objectives), dtlz1 - dtlz7 (3 objectives).
+    c_fun and c_batch_fun are the native callbacks (callback_type and 
+    callback_parallel), no Python code is executed when the optimizers use them."""
+    
+    nobjs = {'zdt': 2, 'dtlz': 3}
+    
+    def __init__(self, name, dim):
+        self.name = name
+        self.dim = dim
+        self.nobj = next((n for p, n in NativeFun.nobjs.items() 
+                          if name.startswith(p)), 1)
+        if name.startswith('zdt4'):
+            lower = [0] + [-5]*(dim-1)
+            upper = [1] + [5]*(dim-1)
+        elif self.nobj > 1:
+            lower = [0]*dim
+            upper = [1]*dim
+        elif name == 'rastrigin':
+            lower = [-5.12]*dim
+            upper = [5.12]*dim
+        else:
+            lower = [-5]*dim
+            upper = [5]*dim
+        self.bounds = Bounds(lower, upper)
+        self.c_fun = ct.cast(getattr(libcmalib, name + 'C'), mo_call_back_type)
+        self.c_batch_fun = ct.cast(getattr(libcmalib, name + 'BatchC'), call_back_par)
+    
+    def __call__(self, x):
+        x = np.ascontiguousarray(x, dtype=np.float64)
+        y = np.empty(self.nobj)
+        self.c_fun(len(x), x.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                   y.ctypes.data_as(ct.POINTER(ct.c_double)))
+        return y if self.nobj > 1 else y[0]
+
+    def batch(self, xs):
+        xs = np.ascontiguousarray(xs, dtype=np.float64)
+        popsize, dim = xs.shape
+        ys = np.empty((popsize, self.nobj))
+        self.c_batch_fun(popsize, dim, xs.ctypes.data_as(ct.POINTER(ct.c_double)), 
+                         ys.ctypes.data_as(ct.POINTER(ct.c_double)))
+        return ys if self.nobj > 1 else ys[:,0]
+
 class _testfun(object):
     def __init__(self, name, fun, lower, upper):    
         self.name = name 